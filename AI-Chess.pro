@@ -15,20 +15,85 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Search statistics (node counts, cutoffs, phase timings) printed as JSON
+# after each AI move. Uncomment to compile the counters in.
+#DEFINES += SEARCH_STATS
+
+# Timeline of engine and GUI phases dumped as Chrome trace-event JSON on
+# exit. Set AI_CHESS_TRACE_MARKERS to also emit ftrace markers for perf.
+#DEFINES += SEARCH_TRACE
+
 SOURCES += \
+    batcheval.cpp \
+    bench.cpp \
     chessboard.cpp \
+    chessengine.cpp \
     chessgui.cpp \
     chesspiece.cpp \
+    cluster.cpp \
+    endgame.cpp \
+    evalparams.cpp \
+    explorer.cpp \
+    gamehistory.cpp \
+    learning.cpp \
     main.cpp \
     move.cpp \
-    stack.cpp
+    movecache.cpp \
+    movegen.cpp \
+    movepicker.cpp \
+    multipv.cpp \
+    paramlist.cpp \
+    pawnhash.cpp \
+    pgn.cpp \
+    ponder.cpp \
+    recorder.cpp \
+    san.cpp \
+    searchparams.cpp \
+    searchstats.cpp \
+    selfplay.cpp \
+    server.cpp \
+    stack.cpp \
+    threadpool.cpp \
+    tracer.cpp \
+    trainingdata.cpp \
+    transposition.cpp \
+    tuner.cpp \
+    zobrist.cpp
 
 HEADERS += \
+    batcheval.h \
+    bench.h \
     chessboard.h \
+    chessengine.h \
     chessgui.h \
     chesspiece.h \
+    cluster.h \
+    endgame.h \
+    evaldefaults.h \
+    evalparams.h \
+    explorer.h \
+    gamehistory.h \
+    learning.h \
     move.h \
-    stack.h
+    movecache.h \
+    movegen.h \
+    movepicker.h \
+    paramlist.h \
+    pawnhash.h \
+    pgn.h \
+    ponder.h \
+    recorder.h \
+    searchparams.h \
+    searchstats.h \
+    selfplay.h \
+    server.h \
+    stack.h \
+    threadpool.h \
+    tracer.h \
+    trainingdata.h \
+    transposition.h \
+    tuner.h \
+    zobrist.h
 
 FORMS += \
     chessgui.ui
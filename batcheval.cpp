@@ -0,0 +1,231 @@
+/*
+ * Batch Evaluator - scores large position sets on all cores
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "batcheval.h"
+#include "chesspiece.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+#define BATCH_TYPES_PER_SIDE 6
+#define BATCH_LINE_LENGTH    256
+
+/*---------------------------------------------------------------------------*/
+// weight index of each piece type, kings are never exchanged
+const int8_t materialIndex[BATCH_TYPES_PER_SIDE] = {
+    EVAL_BISHOP, -1, EVAL_KNIGHT, EVAL_PAWN, EVAL_QUEEN, EVAL_ROOK
+};
+
+/*---------------------------------------------------------------------------*/
+BatchEvaluator::BatchEvaluator(unsigned threadCount)
+{
+    if(threadCount == 0){
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    this->threadCount = threadCount;
+    this->seconds = 0.0;
+    this->evaluated = 0;
+    this->invalid = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+void BatchEvaluator::evaluate(const packedPosition_t *positions, \
+                              size_t count, int32_t *scores, int depth)
+{
+    std::chrono::steady_clock::time_point start = \
+            std::chrono::steady_clock::now();
+
+    // whole blocks for each worker, the last one takes the rest
+    size_t blocks = (count + BATCH_BLOCK_SIZE - 1) / BATCH_BLOCK_SIZE;
+    size_t perThread = (blocks + threadCount - 1) / threadCount * \
+            BATCH_BLOCK_SIZE;
+
+    std::vector<std::thread> workers;
+    std::vector<size_t> invalids(threadCount, 0);
+    for(unsigned i = 0; i < threadCount; i++){
+        size_t begin = i * perThread;
+        if(begin >= count){
+            break;
+        }
+
+        size_t length = std::min(perThread, count - begin);
+        workers.push_back(std::thread(evaluateRange, positions + begin, \
+                                      length, scores + begin, depth, \
+                                      &invalids[i]));
+    }
+
+    for(size_t i = 0; i < workers.size(); i++){
+        workers[i].join();
+    }
+
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() \
+                                            - start).count();
+    evaluated = count;
+    invalid = 0;
+    for(size_t i = 0; i < invalids.size(); i++){
+        invalid += invalids[i];
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+double BatchEvaluator::positionsPerSecond() const
+{
+    return seconds > 0.0 ? evaluated / seconds : 0.0;
+}
+
+/*---------------------------------------------------------------------------*/
+double BatchEvaluator::lastSeconds() const
+{
+    return seconds;
+}
+
+/*---------------------------------------------------------------------------*/
+size_t BatchEvaluator::invalidPositions() const
+{
+    return invalid;
+}
+
+/*---------------------------------------------------------------------------*/
+void BatchEvaluator::materialBlock(const packedPosition_t *positions, \
+                                   size_t count, int32_t *material, \
+                                   const EvalParams &params)
+{
+    // piece counts of the block, one row for each kind
+    int16_t counts[BATCH_PIECE_KINDS][BATCH_BLOCK_SIZE];
+    memset(counts, 0, sizeof(counts));
+
+    for(size_t i = 0; i < count; i++){
+        uint8_t pieceCount = __builtin_popcountll(\
+                    positions[i].board.occupancy);
+        pieceCount = std::min<uint8_t>(pieceCount, TOTAL_PIECE_NUM);
+        for(uint8_t j = 0; j < pieceCount; j++){
+            uint8_t code = (positions[i].board.pieces[j / 2] >> \
+                            ((j % 2) * PACKED_NIBBLE_BITS)) & \
+                    PACKED_NIBBLE_MASK;
+            uint8_t type = code & PACKED_CODE_TYPE_MASK;
+            if(type < BATCH_TYPES_PER_SIDE){
+                counts[(code >> PACKED_CODE_SIDE_SHIFT) * \
+                        BATCH_TYPES_PER_SIDE + type][i]++;
+            }
+        }
+    }
+
+    // straight multiply-add over the block, vectorised by the compiler
+    for(size_t i = 0; i < count; i++){
+        material[i] = 0;
+    }
+    for(uint8_t kind = 0; kind < BATCH_PIECE_KINDS; kind++){
+        int8_t index = materialIndex[kind % BATCH_TYPES_PER_SIDE];
+        if(index < 0){
+            continue;
+        }
+
+        // kinds of black come first
+        int32_t weight = params.weights[index];
+        if(kind < BATCH_TYPES_PER_SIDE){
+            weight = -weight;
+        }
+        const int16_t *row = counts[kind];
+        for(size_t i = 0; i < count; i++){
+            material[i] += row[i] * weight;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void BatchEvaluator::evaluateRange(const packedPosition_t *positions, \
+                                   size_t count, int32_t *scores, int depth, \
+                                   size_t *invalid)
+{
+    ChessEngine engine(BATCH_TT_SIZE_MB);
+    int32_t material[BATCH_BLOCK_SIZE];
+
+    for(size_t begin = 0; begin < count; begin += BATCH_BLOCK_SIZE){
+        size_t length = std::min<size_t>(BATCH_BLOCK_SIZE, count - begin);
+        if(depth == 0){
+            materialBlock(positions + begin, length, material, \
+                          engine.getEvalParams());
+        }
+
+        for(size_t i = 0; i < length; i++){
+            if(!engine.unpackPosition(&positions[begin + i])){
+                scores[begin + i] = 0;
+                (*invalid)++;
+                continue;
+            }
+
+            if(depth == 0 && engine.isKnownEnding()){
+                // rated by the rules of the ending, as in the search
+                scores[begin + i] = engine.getRating();
+            } else if(depth == 0){
+                int32_t sum = material[i] + engine.positionalRating();
+                scores[begin + i] = positions[begin + i].side ? sum : -sum;
+            } else{
+                // positions are independent, nothing carries over
+                engine.clearTranspositionTable();
+                scores[begin + i] = engine.search(depth);
+            }
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+int batchEvalMain(int argc, char *argv[])
+{
+    int depth = 0;
+    unsigned threads = 0;
+    const char *path = nullptr;
+
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "-d") == 0 && i + 1 < argc){
+            depth = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc){
+            threads = atoi(argv[++i]);
+        } else{
+            path = argv[i];
+        }
+    }
+
+    FILE *file = path ? fopen(path, "r") : nullptr;
+    if(file == nullptr){
+        fprintf(stderr, "usage: eval [-d depth] [-t threads] file\n");
+        return 1;
+    }
+
+    std::vector<packedPosition_t> positions;
+    char line[BATCH_LINE_LENGTH];
+    while(fgets(line, sizeof(line), file) != nullptr){
+        packedPosition_t position;
+        if(line[0] == '\n' || line[0] == '#'){
+            continue;
+        }
+        if(!ChessEngine::fenToPosition(line, &position)){
+            memset(&position, 0, sizeof(position)); // scored as invalid
+        }
+        positions.push_back(position);
+    }
+    fclose(file);
+
+    std::vector<int32_t> scores(positions.size());
+    BatchEvaluator evaluator(threads);
+    evaluator.evaluate(positions.data(), positions.size(), scores.data(), \
+                       depth);
+
+    for(size_t i = 0; i < scores.size(); i++){
+        printf("%d\n", scores[i]);
+    }
+    fprintf(stderr, "%zu positions, %zu invalid, %.3f s, %.0f positions/s\n", \
+            positions.size(), evaluator.invalidPositions(), \
+            evaluator.lastSeconds(), evaluator.positionsPerSecond());
+
+    return 0;
+}
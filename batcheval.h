@@ -0,0 +1,54 @@
+/*
+ * Batch Evaluator - scores large position sets on all cores
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef BATCHEVAL_H
+#define BATCHEVAL_H
+
+#include "chessengine.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/*---------------------------------------------------------------------------*/
+#define BATCH_BLOCK_SIZE  256 // positions decoded together
+#define BATCH_PIECE_KINDS 12  // side * 6 + piece type
+#define BATCH_TT_SIZE_MB  1   // each worker has its own table
+
+/*---------------------------------------------------------------------------*/
+// material of a block is summed in structure of arrays layout, the
+// positional terms and the searches run on one engine per worker thread
+class BatchEvaluator
+{
+public:
+    explicit BatchEvaluator(unsigned threadCount = 0); // 0 uses all cores
+
+    // scores are in rating units relative to the side to move, static
+    // evaluation when depth is 0. invalid positions score 0
+    void evaluate(const packedPosition_t *positions, size_t count, \
+                  int32_t *scores, int depth = 0);
+
+    double positionsPerSecond() const;
+    double lastSeconds() const;
+    size_t invalidPositions() const;
+
+    static void materialBlock(const packedPosition_t *positions, \
+                              size_t count, int32_t *material, \
+                              const EvalParams &params);
+private:
+    static void evaluateRange(const packedPosition_t *positions, \
+                              size_t count, int32_t *scores, int depth, \
+                              size_t *invalid);
+
+    unsigned threadCount;
+    double seconds;
+    size_t evaluated;
+    size_t invalid;
+};
+
+/*---------------------------------------------------------------------------*/
+// "eval [-d depth] [-t threads] file", one FEN per line
+int batchEvalMain(int argc, char *argv[]);
+
+#endif // BATCHEVAL_H
@@ -0,0 +1,281 @@
+/*
+ * Bench - fixed position searches with a node count signature
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "bench.h"
+#include "chessengine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*---------------------------------------------------------------------------*/
+#define BENCH_LINE_LENGTH 64
+
+/*---------------------------------------------------------------------------*/
+// openings, middlegames, endgames and a few known endings. changing the
+// list changes the signature, baselines have to be written again
+static const char *benchPositions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w",
+    "2K5/p7/7P/5pR1/8/5k2/r7/8 w",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w",
+    "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w",
+    "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w",
+    "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b",
+    "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w",
+    "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w",
+    "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w",
+    "5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w",
+    "4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w",
+    "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w",
+    "3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b",
+    "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w",
+    "8/8/8/8/5kp1/P7/8/1K1N4 w",
+    "8/8/8/5N2/8/p7/8/2NK3k w",
+    "8/3k4/8/8/8/4B3/4KB2/2B5 w",
+    "8/8/1P6/5pr1/8/4R3/7k/2K5 w",
+    "8/2p4P/8/kr6/6R1/8/8/1K6 w",
+    "8/8/3P3k/8/1p6/8/1P6/1K3n2 b",
+    "8/R7/2q5/8/6k1/8/1P5p/K6R w",
+    "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b",
+    "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w",
+    "8/8/8/8/8/5k2/6p1/6K1 w",
+    "7k/7P/5K2/8/3B4/8/8/8 b",
+    "8/8/8/4k3/8/8/8/KQ6 w",
+    "8/8/3k4/8/8/8/8/KBN5 w",
+    "k7/8/P7/8/8/8/8/K1B5 w",
+    "8/5k2/8/8/4b3/8/PP1B4/K7 w",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w",
+    "rnbqkb1r/pp1p1ppp/4pn2/2p5/2PP4/2N5/PP2PPPP/R1BQKBNR w",
+};
+
+#define BENCH_POSITION_NUM \
+    (sizeof(benchPositions) / sizeof(benchPositions[0]))
+
+/*---------------------------------------------------------------------------*/
+void runBench(int depth, benchResult_t *result, bool verbose)
+{
+    result->depth = depth;
+    result->nodes = 0;
+    result->positionNodes.clear();
+
+    ChessEngine engine(BENCH_TT_SIZE_MB);
+    std::chrono::steady_clock::time_point start = \
+            std::chrono::steady_clock::now();
+
+    for(size_t i = 0; i < BENCH_POSITION_NUM; i++){
+        packedPosition_t position;
+        if(!ChessEngine::fenToPosition(benchPositions[i], &position) || \
+           !engine.unpackPosition(&position)){
+            fprintf(stderr, "bench position %zu is invalid\n", i + 1);
+            result->positionNodes.push_back(0);
+            continue;
+        }
+
+        engine.clearTranspositionTable();
+        engine.search(depth);
+        uint64_t nodes = engine.getNodeCount();
+        result->positionNodes.push_back(nodes);
+        result->nodes += nodes;
+
+        if(verbose){
+            char san[SAN_MAX_LENGTH];
+            engine.moveToSan(engine.getBestMove(), san);
+            printf("position %zu/%zu nodes %llu bestmove %s\n", i + 1, \
+                   BENCH_POSITION_NUM, (unsigned long long)nodes, san);
+        }
+    }
+
+    result->elapsedMs = std::chrono::duration_cast<\
+            std::chrono::milliseconds>(std::chrono::steady_clock::now() - \
+                                       start).count();
+}
+
+/*---------------------------------------------------------------------------*/
+uint64_t benchNps(const benchResult_t &result)
+{
+    return result.nodes * 1000 / std::max<uint64_t>(result.elapsedMs, 1);
+}
+
+/*---------------------------------------------------------------------------*/
+static bool writeBaseline(const char *path, const benchResult_t &result)
+{
+    FILE *file = fopen(path, "w");
+    if(file == nullptr){
+        return false;
+    }
+
+    fprintf(file, "depth %d\nnodes %llu\nnps %llu\n", result.depth, \
+            (unsigned long long)result.nodes, \
+            (unsigned long long)benchNps(result));
+    for(size_t i = 0; i < result.positionNodes.size(); i++){
+        fprintf(file, "position %zu %llu\n", i + 1, \
+                (unsigned long long)result.positionNodes[i]);
+    }
+
+    return fclose(file) == 0;
+}
+
+/*---------------------------------------------------------------------------*/
+static bool readBaseline(const char *path, benchResult_t *baseline, \
+                         uint64_t *nps)
+{
+    FILE *file = fopen(path, "r");
+    if(file == nullptr){
+        return false;
+    }
+
+    baseline->depth = 0;
+    baseline->nodes = 0;
+    baseline->positionNodes.clear();
+    *nps = 0;
+
+    char line[BENCH_LINE_LENGTH];
+    while(fgets(line, sizeof(line), file) != nullptr){
+        unsigned long long value, index;
+        if(sscanf(line, "depth %llu", &value) == 1){
+            baseline->depth = value;
+        } else if(sscanf(line, "nodes %llu", &value) == 1){
+            baseline->nodes = value;
+        } else if(sscanf(line, "nps %llu", &value) == 1){
+            *nps = value;
+        } else if(sscanf(line, "position %llu %llu", &index, &value) == 2 \
+                  && index == baseline->positionNodes.size() + 1){
+            baseline->positionNodes.push_back(value);
+        }
+    }
+    fclose(file);
+
+    return baseline->depth > 0 && *nps > 0;
+}
+
+/*---------------------------------------------------------------------------*/
+// false if the search changed or got slower than the tolerance allows
+static bool compareBaseline(const benchResult_t &result, \
+                            const benchResult_t &baseline, uint64_t nps, \
+                            unsigned tolerance)
+{
+    bool passed = true;
+    if(result.nodes == baseline.nodes){
+        printf("signature matches the baseline\n");
+    } else{
+        printf("signature %llu differs from the baseline %llu\n", \
+               (unsigned long long)result.nodes, \
+               (unsigned long long)baseline.nodes);
+        for(size_t i = 0; i < result.positionNodes.size() && \
+            i < baseline.positionNodes.size(); i++){
+            if(result.positionNodes[i] != baseline.positionNodes[i]){
+                printf("position %zu nodes %llu, baseline %llu\n", i + 1, \
+                       (unsigned long long)result.positionNodes[i], \
+                       (unsigned long long)baseline.positionNodes[i]);
+            }
+        }
+        passed = false;
+    }
+
+    // the node counts may differ, the speed is still comparable
+    double change = 100.0 * ((double)benchNps(result) - nps) / nps;
+    printf("nps %+.1f%% against the baseline %llu\n", change, \
+           (unsigned long long)nps);
+    if(change < -(double)tolerance){
+        printf("slower than the tolerance of %u%%\n", tolerance);
+        passed = false;
+    }
+
+    return passed;
+}
+
+/*---------------------------------------------------------------------------*/
+int benchMain(int argc, char *argv[])
+{
+    int depth = BENCH_DEFAULT_DEPTH;
+    unsigned tolerance = BENCH_DEFAULT_TOLERANCE;
+    const char *outputPath = nullptr;
+    const char *baselinePath = nullptr;
+
+    for(int i = 1; i < argc; i++){
+        bool hasValue = i + 1 < argc;
+        if(strcmp(argv[i], "-d") == 0 && hasValue){
+            depth = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-o") == 0 && hasValue){
+            outputPath = argv[++i];
+        } else if(strcmp(argv[i], "-c") == 0 && hasValue){
+            baselinePath = argv[++i];
+        } else if(strcmp(argv[i], "-t") == 0 && hasValue){
+            tolerance = atoi(argv[++i]);
+        } else{
+            depth = 0;
+            break;
+        }
+    }
+
+    if(depth < 1 || depth > MAX_SEARCH_PLY){
+        fprintf(stderr, "usage: bench [-d depth] [-o baseline] "
+                        "[-c baseline] [-t tolerance]\n");
+        return 1;
+    }
+
+    // the engine takes its weights and search settings from these
+    const char *overrides[] = { SEARCH_PARAMS_ENV, EVAL_PARAMS_ENV, \
+                                EVAL_PARAMS_FILE_ENV };
+    for(size_t i = 0; i < sizeof(overrides) / sizeof(overrides[0]); i++){
+        if(getenv(overrides[i]) != nullptr){
+            fprintf(stderr, "%s is set, the signature is not the one of "
+                            "the defaults\n", overrides[i]);
+        }
+    }
+
+    benchResult_t baseline;
+    uint64_t baselineNps = 0;
+    if(baselinePath != nullptr){
+        if(!readBaseline(baselinePath, &baseline, &baselineNps)){
+            fprintf(stderr, "%s is not a bench baseline\n", baselinePath);
+            return 1;
+        } else if(baseline.depth != depth){
+            fprintf(stderr, "the baseline is of depth %d\n", baseline.depth);
+            return 1;
+        }
+    }
+
+    benchResult_t result;
+    runBench(depth, &result, true);
+    printf("nodes %llu\ntime %llu ms\nnps %llu\n", \
+           (unsigned long long)result.nodes, \
+           (unsigned long long)result.elapsedMs, \
+           (unsigned long long)benchNps(result));
+
+    if(outputPath != nullptr && !writeBaseline(outputPath, result)){
+        perror(outputPath);
+        return 1;
+    }
+    if(baselinePath != nullptr && \
+       !compareBaseline(result, baseline, baselineNps, tolerance)){
+        return 1;
+    }
+
+    return 0;
+}
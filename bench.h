@@ -0,0 +1,36 @@
+/*
+ * Bench - fixed position searches with a node count signature
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstdint>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+#define BENCH_DEFAULT_DEPTH     8
+#define BENCH_TT_SIZE_MB        16
+#define BENCH_DEFAULT_TOLERANCE 10 // percent of the baseline speed
+
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    int depth;
+    uint64_t nodes; // the signature, the same on every machine and build
+    uint64_t elapsedMs;
+    std::vector<uint64_t> positionNodes;
+} benchResult_t;
+
+/*---------------------------------------------------------------------------*/
+// the positions are searched one after another on one engine, the table
+// is cleared before each so each count stands on its own
+void runBench(int depth, benchResult_t *result, bool verbose);
+uint64_t benchNps(const benchResult_t &result);
+
+// "bench [-d depth] [-o baseline] [-c baseline] [-t tolerance]", -o
+// writes the result, -c fails on another signature or on a speed below
+// the baseline by more than tolerance percent
+int benchMain(int argc, char *argv[]);
+
+#endif // BENCH_H
@@ -6,6 +6,8 @@
 #include "chessboard.h"
 #include "chesspiece.h"
 #include "chessgui.h"
+#include "searchstats.h"
+#include "tracer.h"
 
 // for template defination linkage
 #include "stack.cpp"
@@ -16,71 +18,48 @@
 #include <QMessageBox>
 #include <QPushButton>
 
+#include <cstdlib>
+
 /*---------------------------------------------------------------------------*/
 #define CB_EACH_BOX_SIZE           64
 #define CB_SIZE                    (BOARD_MATRIX_SIZE * CB_EACH_BOX_SIZE)
 #define BOX_OFFSET_FOR_IMAGE       2 // for centering image in box
 #define POSSIBLE_MOVEMENT_CIRCLE_R 14
 
-#define AI_SEARCH_DEPTH 5
-
-/* https://chess.stackexchange.com/questions/4113/longest-chess-game-possible
- * -maximum-moves */
-#define MAX_MOVES_IN_A_GAME    6400
-
-// 103: P-(8*4) + R-14 + K-8 + B-14 + Q-27 + K-8
-#define MAX_MOVES_EACH_TURN    103
+#define AI_SEARCH_DEPTH      5
 
 #define CB_BG_COLOR_1      (QColor(255, 178, 102))
 #define CB_BG_COLOR_2      (QColor(255, 128, 0))
 #define CB_SELECTED_COLOR  (QColor(51, 255, 51, 170))
 #define CB_POSSIBLE_COLOR  (QColor(51, 255, 51, 150))
 #define CB_HIT_COLOR       (QColor(51, 255, 51, 135))
+#define CB_BAD_HIT_COLOR   (QColor(255, 190, 30, 135)) // losing exchange
 #define CB_LAST_MOVE_COLOR (QColor(255, 30, 30, 135))
 
 /*---------------------------------------------------------------------------*/
-#define MOVEMENT_NUM   8
-#define POSITION_DEPTH 2
-
-const int8_t knightMovementOffsets[MOVEMENT_NUM][POSITION_DEPTH] = {
-  { -1, -2 },
-  { -2, -1 },
-  { -2, 1 },
-  { -1, 2 },
-  { 1, 2 },
-  { 2, 1 },
-  { 2, -1 },
-  { 1, -2 }
-};
-
-const int8_t kingMovementOffsets[MOVEMENT_NUM][POSITION_DEPTH] = {
-  { -1, -1 },
-  { -1, 0 },
-  { -1, 1 },
-  { 0, -1 },
-  { 0, 1 },
-  { 1, -1 },
-  { 1, 0 },
-  { 1, 1 }
-};
-
 const char boardColumnNames[] = { 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H' };
 
 /*---------------------------------------------------------------------------*/
-ChessBoard::ChessBoard(QWidget *parent) : QWidget(parent)
+ChessBoard::ChessBoard(QWidget *parent)
+    : QWidget(parent)
+    , ponder(transpositionTable)
 {
-    for(uint8_t i = 0; i < BOARD_MATRIX_SIZE; i++){
-        for(uint8_t j = 0; j < BOARD_MATRIX_SIZE; j++){
-            boardInfo[i][j].index = -1;
-        }
-    }
-
-    initilizePieces();
-
-    movePool = new Stack<Move>(MAX_MOVES_IN_A_GAME);
     selectedIndex = -1;
     legalMoveCount = 0;
-    movementSide = SIDE_WHITE;
+
+    if(learning.open(getenv(LEARNING_FILE_ENV))){
+        setLearningFile(&learning);
+        ponder.setLearningFile(&learning);
+    }
+    const char *maxPly = getenv(RECORD_MAX_PLY_ENV);
+    const char *maxNodes = getenv(RECORD_MAX_NODES_ENV);
+    if(recorder.open(getenv(RECORD_FILE_ENV), \
+                     maxPly ? atoi(maxPly) : RECORD_DEFAULT_MAX_PLY, \
+                     maxNodes ? strtoull(maxNodes, nullptr, 10) : \
+                                RECORD_DEFAULT_MAX_NODES)){
+        setTreeRecorder(&recorder);
+        ponder.setTreeRecorder(&recorder);
+    }
 
     setMouseTracking(true);
     setCursor(Qt::PointingHandCursor);
@@ -88,18 +67,18 @@ ChessBoard::ChessBoard(QWidget *parent) : QWidget(parent)
     resize(CB_SIZE, CB_SIZE);
     show();
 }
+
 /*---------------------------------------------------------------------------*/
 ChessBoard::~ChessBoard()
 {
-    if(movePool != nullptr){
-        delete movePool;
-    }
+    // the base engine outlives the members
+    setTreeRecorder(nullptr);
 }
-
 /*---------------------------------------------------------------------------*/
 void ChessBoard::paintEvent(QPaintEvent *event)
 {
     (void)event;
+    TRACE_SCOPE("paintEvent");
     QPainter painter(this);
 
     painter.setRenderHint(QPainter::Antialiasing);
@@ -148,7 +127,8 @@ void ChessBoard::paintEvent(QPaintEvent *event)
                 painter.fillRect(legalMoves[i].to.x * CB_EACH_BOX_SIZE, \
                     (INVERTING_OFFSET - legalMoves[i].to.y) * \
                     CB_EACH_BOX_SIZE, CB_EACH_BOX_SIZE, CB_EACH_BOX_SIZE, \
-                    QBrush(CB_HIT_COLOR));
+                    QBrush(staticExchange(&legalMoves[i]) >= 0 ? \
+                           CB_HIT_COLOR : CB_BAD_HIT_COLOR));
             }
         }
     }
@@ -177,32 +157,6 @@ void ChessBoard::paintEvent(QPaintEvent *event)
     painter.restore();
 }
 
-/*---------------------------------------------------------------------------*/
-void ChessBoard::undoLastMove(bool turnSide)
-{
-    Move move;
-    if(movePool->pop(&move)){
-        int8_t movedPieceIndex = boardInfo[move.to.x][move.to.y].index;
-
-        // move back the piece
-        chessPieces[movedPieceIndex] = move.movedPiece;
-        boardInfo[move.from.x][move.from.y].index = movedPieceIndex;
-
-        // get the eaten piece back if exist
-        if(move.pieceWasEaten){
-            chessPieces[move.eatenPieceIndex].setOnBoard(true);
-            boardInfo[move.to.x][move.to.y].index = move.eatenPieceIndex;
-        } else{
-            boardInfo[move.to.x][move.to.y].index = -1;
-        }
-
-        if(turnSide){
-            // turn the side
-            movementSide = !movementSide;
-        }
-    }
-}
-
 /*---------------------------------------------------------------------------*/
 void ChessBoard::mousePressEvent(QMouseEvent *event)
 {
@@ -224,18 +178,21 @@ void ChessBoard::mousePressEvent(QMouseEvent *event)
     } else{
         for(uint8_t i = 0; i < legalMoveCount; i++){
             if(legalMoves[i].to.x == x && legalMoves[i].to.y == y){
-                makeMove(legalMoves[i]);
-
+                // the piece is asked first, the notation needs it
+                uint8_t promotionType = PIECE_QUEEN;
                 if((legalMoves[i].to.y == 0 || \
                     legalMoves[i].to.y == BOARD_MATRIX_SIZE - 1) && \
                    chessPieces[selectedIndex].type() == PIECE_PAWN){
-                    askForNewPiece();
+                    promotionType = askForNewPiece();
                 }
 
-                ((ChessGui *)parentWidget())->\
-                        setNotation(getNotation(&legalMoves[i]), \
-                                    !movementSide);
-                updatePressures();
+                QString notation = getNotation(&legalMoves[i], \
+                                               promotionType);
+                playMove(legalMoves[i], promotionType);
+
+                ((ChessGui *)parentWidget())->addMove(legalMoves[i], \
+                                                      promotionType, \
+                                                      notation);
                 break;
             }
         }
@@ -252,600 +209,92 @@ void ChessBoard::mousePressEvent(QMouseEvent *event)
 }
 
 /*---------------------------------------------------------------------------*/
-void ChessBoard::initilizePieces()
-{
-    uint8_t x = 0, y = INVERTING_OFFSET, offset = 0;
-
-    // black other pieces
-    boardInfo[x][y].index = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_ROOK, SIDE_BLACK);
-    boardInfo[x][y].index = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_KNIGHT, SIDE_BLACK);
-    boardInfo[x][y].index = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_BISHOP, SIDE_BLACK);
-    boardInfo[x][y].index = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_QUEEN, SIDE_BLACK);
-    boardInfo[x][y].index = offset;
-
-    blackKingIndex = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_KING, SIDE_BLACK);
-
-    boardInfo[x][y].index = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_BISHOP, SIDE_BLACK);
-    boardInfo[x][y].index = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_KNIGHT, SIDE_BLACK);
-    boardInfo[x][y].index = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_ROOK, SIDE_BLACK);
-
-    // black pawns
-    x = 0;
-    y--;
-    for(int i = 0; i < BOARD_MATRIX_SIZE; i++){
-        boardInfo[x][y].index = offset;
-        chessPieces[offset++].setPieceInfo(x++, y, PIECE_PAWN, SIDE_BLACK);
-    }
-
-    // white pawns
-    x = 0;
-    y = 1;
-    for(int i = 0; i < BOARD_MATRIX_SIZE; i++){
-        boardInfo[x][y].index = offset;
-        chessPieces[offset++].setPieceInfo(x++, y, PIECE_PAWN, SIDE_WHITE);
-    }
-
-    // white other pieces
-    x = 0;
-    y--;
-
-    boardInfo[x][y].index = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_ROOK, SIDE_WHITE);
-    boardInfo[x][y].index = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_KNIGHT, SIDE_WHITE);
-    boardInfo[x][y].index = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_BISHOP, SIDE_WHITE);
-    boardInfo[x][y].index = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_QUEEN, SIDE_WHITE);
-    boardInfo[x][y].index = offset;
-
-    whiteKingIndex = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_KING, SIDE_WHITE);
-
-    boardInfo[x][y].index = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_BISHOP, SIDE_WHITE);
-    boardInfo[x][y].index = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_KNIGHT, SIDE_WHITE);
-    boardInfo[x][y].index = offset;
-    chessPieces[offset++].setPieceInfo(x++, y, PIECE_ROOK, SIDE_WHITE);
-}
-
-/*---------------------------------------------------------------------------*/
-void ChessBoard::updatePressures(uint8_t (*pressures)[BOARD_MATRIX_SIZE])
+void ChessBoard::makeAIMove()
 {
-    if(pressures == nullptr){
-        for(uint8_t i = 0; i < BOARD_MATRIX_SIZE; i++){
-            for(uint8_t j = 0; j < BOARD_MATRIX_SIZE; j++){
-                boardInfo[i][j].pressure = 0;
-            }
-        }
-    } else{
-        for(uint8_t i = 0; i < BOARD_MATRIX_SIZE; i++){
-            for(uint8_t j = 0; j < BOARD_MATRIX_SIZE; j++){
-                pressures[i][j] = 0;
-            }
-        }
-    }
+    TRACE_SCOPE("makeAIMove");
 
+    // nothing to search, the game is already over
     Move moves[MAX_MOVES_EACH_TURN];
-
-    // change movement side for getting other side's moving list
-    movementSide = !movementSide;
-    uint8_t moveCount = getAllMoves(moves, true);
-    movementSide = !movementSide; // set back
-
-    if(pressures == nullptr){
-        for(uint8_t i = 0; i < moveCount; i++){
-                boardInfo[moves[i].to.x][moves[i].to.y].pressure++;
-        }
-    } else{
-        for(uint8_t i = 0; i < moveCount; i++){
-                pressures[moves[i].to.x][moves[i].to.y]++;
-        }
-    }
-}
-
-/*---------------------------------------------------------------------------*/
-bool ChessBoard::isKingUnderPressure(uint8_t (*pressures)[BOARD_MATRIX_SIZE])
-{
-    uint8_t kingIndex = whiteKingIndex;
-    if(movementSide == SIDE_BLACK){
-        kingIndex = blackKingIndex;
+    if(getAllMoves(moves) == 0 || isDrawByRule()){
+        gameOver();
+        return;
     }
 
-    if(pressures == nullptr){
-        if(boardInfo[chessPieces[kingIndex].x()]\
-                [chessPieces[kingIndex].y()].pressure != 0){
-            return true;
-        }
+    if(ponder.matches(positionKey())){
+        // the predicted move was played, its search is already running
+        bestMove = ponder.wait();
     } else{
-        if(pressures[chessPieces[kingIndex].x()]\
-                [chessPieces[kingIndex].y()] != 0){
-            return true;
-        }
-    }
+        // a missed prediction still leaves its entries in the table
+        ponder.stop();
 
-    return false;
-}
+        threadSearchStats().clear();
+        search(AI_SEARCH_DEPTH);
 
-/*---------------------------------------------------------------------------*/
-bool ChessBoard::checkKingPressure(Move *move)
-{
-    uint8_t pressures[BOARD_MATRIX_SIZE][BOARD_MATRIX_SIZE];
-
-    makeMove(*move, false);
-    updatePressures(pressures); // set pressures after move
-    undoLastMove(false);
-
-    // check the move is removing the pressure
-    if(isKingUnderPressure(pressures)){
-        return false; // still under pressure
+#ifdef SEARCH_STATS
+        qDebug().noquote() << threadSearchStats().toJson();
+#endif
     }
 
-    return true; // no pressure
-}
+    QString notation = getNotation(&bestMove, PIECE_QUEEN);
+    Move played = bestMove;
+    playMove(played);
 
-/*---------------------------------------------------------------------------*/
-uint8_t ChessBoard::getAllMoves(Move *moves, bool pressureChecking)
-{
-    uint8_t halfNum = TOTAL_PIECE_NUM / 2;
-    // black pieces in first half
-    uint8_t startIndex = 0, endIndex = halfNum;
-    uint8_t moveCount = 0;
-
-    // white pieces in second half
-    if(movementSide == SIDE_WHITE){
-        startIndex += halfNum;
-        endIndex += halfNum;
-    }
-
-    // prepare legal moves for each piece
-    for(uint8_t i = startIndex; i < endIndex; i++){
-        if(chessPieces[i].onBoard()){
-            moveCount += prepareLegalMoves(chessPieces[i], &moves[moveCount], \
-                                           pressureChecking);
-        }
-    }
-
-    return moveCount;
-}
-
-/*---------------------------------------------------------------------------*/
-uint8_t ChessBoard::prepareLegalMoves(ChessPiece piece, Move *moves, \
-                                      bool pressureChecking)
-{
-    uint8_t moveCount = 0;
-    switch (piece.type()){
-        case PIECE_BISHOP:
-            moveCount = fillCrossMoves(piece, moves, pressureChecking);
-            break;
-        case PIECE_KING:
-        {
-            int8_t x = piece.x();
-            int8_t y = piece.y();
-
-            for(uint8_t i = 0; i < MOVEMENT_NUM; i++){
-                int8_t newX = x + kingMovementOffsets[i][0];
-                int8_t newY = y + kingMovementOffsets[i][1];
-
-                if(newX >= 0 && newX < BOARD_MATRIX_SIZE && \
-                        newY >= 0 && newY < BOARD_MATRIX_SIZE){
-                    int8_t index = boardInfo[newX][newY].index;
-
-                    if(index == -1 || pressureChecking || \
-                            chessPieces[index].side() != piece.side()){
-                        if(boardInfo[newX][newY].pressure == 0){
-                            moves[moveCount++].setPositions(x, y, newX, newY);
-                        }
-                    }
-                }
-            }
-
-            // TODO: Add castling movement.
-        }
-            break;
-        case PIECE_KNIGHT:
-        {
-            int8_t x = piece.x();
-            int8_t y = piece.y();
-
-            for(uint8_t i = 0; i < MOVEMENT_NUM; i++){
-                int8_t newX = x + knightMovementOffsets[i][0];
-                int8_t newY = y + knightMovementOffsets[i][1];
-
-                if(newX >= 0 && newX < BOARD_MATRIX_SIZE && \
-                        newY >= 0 && newY < BOARD_MATRIX_SIZE){
-                    int8_t index = boardInfo[newX][newY].index;
-
-                    if(index == -1 || pressureChecking || \
-                            chessPieces[index].side() != piece.side()){
-                        moves[moveCount++].setPositions(x, y, newX, newY);
-                    }
-                }
-            }
-        }
-            break;
-        case PIECE_PAWN:
-        {
-            int8_t x = piece.x();
-            int8_t y = piece.y();
-
-            int8_t direction = -1;
-            if(piece.side() == SIDE_WHITE){
-                direction = 1;
-            }
-
-            // 1 box forward
-            int8_t newX = x;
-            int8_t newY = y + direction;
-            if(newY >= 0 && newY < BOARD_MATRIX_SIZE && \
-                    boardInfo[newX][newY].index == -1 && \
-                    !pressureChecking){
-                moves[moveCount++].setPositions(x, y, newX, newY);
-
-                // if reachs here mean 1 box available check 2 box forward too
-                newX = x;
-                newY = y + (2 * direction);
-                if(!piece.isMoved() && newY >= 0 && newY < BOARD_MATRIX_SIZE \
-                        && boardInfo[newX][newY].index == -1 \
-                        && !pressureChecking){
-                    moves[moveCount++].setPositions(x, y, newX, newY);
-
-                    // TODO: mark as 2 box forwarded for be edible
-                }
-            }
-
-            // w-left & b-right eat
-            newX = x - 1;
-            newY = y + direction;
-            if(newY >= 0 && newY < BOARD_MATRIX_SIZE && newX >= 0 && \
-                    (pressureChecking || \
-                    (boardInfo[newX][newY].index != -1 && \
-                    chessPieces[boardInfo[newX][newY].index].side() != \
-                    piece.side()))){
-                moves[moveCount++].setPositions(x, y, newX, newY);
-            }
-
-            // w-right & b-left eat
-            newX = x + 1;
-            if(newY >= 0 && newY < BOARD_MATRIX_SIZE && \
-                    newX < BOARD_MATRIX_SIZE && \
-                    (pressureChecking || \
-                    (boardInfo[newX][newY].index != -1 && \
-                    chessPieces[boardInfo[newX][newY].index].side() != \
-                    piece.side()))){
-                moves[moveCount++].setPositions(x, y, newX, newY);
-            }
-        }
-            break;
-        case PIECE_QUEEN:
-            moveCount = fillCrossMoves(piece, moves, pressureChecking);
-            moveCount += fillStraightMoves(piece, &moves[moveCount], \
-                                           pressureChecking);
-            break;
-        case PIECE_ROOK:
-            moveCount = fillStraightMoves(piece, moves, pressureChecking);
-            break;
-    }
-
-    if(pressureChecking || piece.type() == PIECE_KING){
-        return moveCount;
-    }
-
-    // if reach here eliminate the king pressure moves
-    uint8_t newMoveCount = 0;
-    for(uint8_t i = 0; i < moveCount; i++){
-        if(checkKingPressure(&moves[i])){
-            moves[newMoveCount++] = moves[i];
-        }
-    }
-
-    return newMoveCount;
-}
-
-/*---------------------------------------------------------------------------*/
-uint8_t ChessBoard::fillCrossMoves(ChessPiece piece, Move *moves, \
-                                   bool pressureChecking)
-{
-    uint8_t moveCount = 0;
-    int8_t x = piece.x();
-    int8_t y = piece.y();
-
-    // left up
-    for(int8_t i = x - 1, j = y + 1; \
-        i >= 0 && j < BOARD_MATRIX_SIZE; i--, j++){
-        if(boardInfo[i][j].index != -1){
-            if(pressureChecking || \
-               chessPieces[boardInfo[i][j].index].side() != piece.side()){
-                moves[moveCount++].setPositions(x, y, i, j);
-            }
-            if(!(pressureChecking && \
-               chessPieces[boardInfo[i][j].index].type() == PIECE_KING && \
-               chessPieces[boardInfo[i][j].index].side() != piece.side())){
-                break;
-            }
-        }
-
-        moves[moveCount++].setPositions(x, y, i, j);
-    }
-
-    // left down
-    for(int8_t i = x - 1, j = y - 1; i >= 0 && j >= 0; i--, j--){
-        if(boardInfo[i][j].index != -1){
-            if(pressureChecking || \
-               chessPieces[boardInfo[i][j].index].side() != piece.side()){
-                moves[moveCount++].setPositions(x, y, i, j);
-            }
-            if(!(pressureChecking && \
-               chessPieces[boardInfo[i][j].index].type() == PIECE_KING && \
-               chessPieces[boardInfo[i][j].index].side() != piece.side())){
-                break;
-            }
-        }
-
-        moves[moveCount++].setPositions(x, y, i, j);
-    }
-
-    // right up
-    for(int8_t i = x + 1, j = y + 1; \
-        i < BOARD_MATRIX_SIZE && j < BOARD_MATRIX_SIZE; i++, j++){
-        if(boardInfo[i][j].index != -1){
-            if(pressureChecking || \
-               chessPieces[boardInfo[i][j].index].side() != piece.side()){
-                moves[moveCount++].setPositions(x, y, i, j);
-            }
-            if(!(pressureChecking && \
-               chessPieces[boardInfo[i][j].index].type() == PIECE_KING && \
-               chessPieces[boardInfo[i][j].index].side() != piece.side())){
-                break;
-            }
-        }
-
-        moves[moveCount++].setPositions(x, y, i, j);
-    }
-
-    // right down
-    for(int8_t i = x + 1, j = y - 1; \
-        i < BOARD_MATRIX_SIZE && j >= 0; i++, j--){
-        if(boardInfo[i][j].index != -1){
-            if(pressureChecking || \
-               chessPieces[boardInfo[i][j].index].side() != piece.side()){
-                moves[moveCount++].setPositions(x, y, i, j);
-            }
-            if(!(pressureChecking && \
-               chessPieces[boardInfo[i][j].index].type() == PIECE_KING && \
-               chessPieces[boardInfo[i][j].index].side() != piece.side())){
-                break;
-            }
-        }
-
-        moves[moveCount++].setPositions(x, y, i, j);
-    }
-
-    return moveCount;
-}
-
-/*---------------------------------------------------------------------------*/
-uint8_t ChessBoard::fillStraightMoves(ChessPiece piece, Move *moves, \
-                                      bool pressureChecking)
-{
-    uint8_t moveCount = 0;
-    int8_t x = piece.x();
-    int8_t y = piece.y();
-
-    // up
-    for(int8_t i = x - 1; i >= 0; i--){
-        if(boardInfo[i][y].index != -1){
-            if(pressureChecking || \
-               chessPieces[boardInfo[i][y].index].side() != piece.side()){
-                moves[moveCount++].setPositions(x, y, i, y);
-            }
-            if(!(pressureChecking && \
-               chessPieces[boardInfo[i][y].index].type() == PIECE_KING && \
-               chessPieces[boardInfo[i][y].index].side() != piece.side())){
-                break;
-            }
-        }
-
-        moves[moveCount++].setPositions(x, y, i, y);
-    }
-
-    // down
-    for(int8_t i = x + 1; i < BOARD_MATRIX_SIZE; i++){
-        if(boardInfo[i][y].index != -1){
-            if(pressureChecking || \
-               chessPieces[boardInfo[i][y].index].side() != piece.side()){
-                moves[moveCount++].setPositions(x, y, i, y);
-            }
-            if(!(pressureChecking && \
-               chessPieces[boardInfo[i][y].index].type() == PIECE_KING && \
-               chessPieces[boardInfo[i][y].index].side() != piece.side())){
-                break;
-            }
-        }
-
-        moves[moveCount++].setPositions(x, y, i, y);
-    }
-
-    // left
-    for(int8_t j = y - 1; j >= 0; j--){
-        if(boardInfo[x][j].index != -1){
-            if(pressureChecking || \
-               chessPieces[boardInfo[x][j].index].side() != piece.side()){
-                moves[moveCount++].setPositions(x, y, x, j);
-            }
-            if(!(pressureChecking && \
-               chessPieces[boardInfo[x][j].index].type() == PIECE_KING && \
-               chessPieces[boardInfo[x][j].index].side() != piece.side())){
-                break;
-            }
-        }
-
-        moves[moveCount++].setPositions(x, y, x, j);
-    }
-
-    // right
-    for(int8_t j = y + 1; j < BOARD_MATRIX_SIZE; j++){
-        if(boardInfo[x][j].index != -1){
-            if(pressureChecking || \
-               chessPieces[boardInfo[x][j].index].side() != piece.side()){
-                moves[moveCount++].setPositions(x, y, x, j);
-            }
-            if(!(pressureChecking && \
-               chessPieces[boardInfo[x][j].index].type() == PIECE_KING && \
-               chessPieces[boardInfo[x][j].index].side() != piece.side())){
-                break;
-            }
-        }
+    ((ChessGui *)parentWidget())->addMove(played, PIECE_QUEEN, notation);
+    this->repaint();
 
-        moves[moveCount++].setPositions(x, y, x, j);
+    // mate, stalemate or a draw by rule ends the game before the player
+    // moves
+    if(getAllMoves(moves) == 0 || isDrawByRule()){
+        gameOver();
     }
 
-    return moveCount;
+    startPondering();
 }
 
 /*---------------------------------------------------------------------------*/
- void ChessBoard::makeMove(Move move, bool turnSide)
- {
-     // clear if any piece exist in next box
-     uint8_t currentIndex = boardInfo[move.from.x][move.from.y].index;
-     int8_t nextIndex = boardInfo[move.to.x][move.to.y].index;
-     if(nextIndex >= 0){
-         chessPieces[nextIndex].setOnBoard(false);
-     }
-     move.setMovedPiece(chessPieces[currentIndex]);
-     move.setEatenPieceIndex(nextIndex);
-
-     movePool->push(move);
-
-     // set new position
-     chessPieces[currentIndex].setPosition(move.to.x, move.to.y);
-     boardInfo[move.to.x][move.to.y].index = currentIndex;
-
-     // set old position as not in use
-     boardInfo[move.from.x][move.from.y].index = -1;
-
-     if(turnSide){
-         // turn the side
-         movementSide = !movementSide;
-     }
- }
-
-/*---------------------------------------------------------------------------*/
-void ChessBoard::makeAIMove()
+void ChessBoard::showPly(GameHistory *history, int ply)
 {
-    minimax(AI_SEARCH_DEPTH, INT_MIN, INT_MAX, true);
-    makeMove(bestMove);
-
-    if((bestMove.to.y == 0 || \
-        bestMove.to.y == BOARD_MATRIX_SIZE - 1) && \
-       chessPieces[boardInfo[bestMove.to.x][bestMove.to.y].index].type() == \
-            PIECE_PAWN){
-        chessPieces[boardInfo[bestMove.to.x][bestMove.to.y].index]\
-                .setType(PIECE_QUEEN);
-    }
-
-    ((ChessGui *)parentWidget())->setNotation(getNotation(&bestMove), \
-                                              !movementSide);
+    // the prediction was of another position
+    ponder.stop();
+    selectedIndex = -1;
+    legalMoveCount = 0;
 
-    updatePressures();
+    history->restore(ply, this);
     this->repaint();
-
-    // is king under pressure check game status
-    if(isKingUnderPressure()){
-        Move moves[MAX_MOVES_EACH_TURN];
-        if(getAllMoves(moves, false) == 0){
-            gameOver();
-        }
-    }
 }
 
 /*---------------------------------------------------------------------------*/
-int ChessBoard::getRating(bool maximizing)
+void ChessBoard::startPondering()
 {
-    // TODO: improve board rating calculation.
-    int sum = 0;
-    for(uint8_t i = 0; i < TOTAL_PIECE_NUM; i++){
-        if(chessPieces[i].type() == PIECE_KING){
-            sum += chessPieces[i].point() * (boardInfo[chessPieces[i].x()]\
-                    [chessPieces[i].y()].pressure * 10);
-        } else if(chessPieces[i].onBoard()){
-            sum += chessPieces[i].point();
-        }
-    }
-
-    return maximizing ? sum : (-1 * sum);
+    // the second move of the principal variation is kept in the table,
+    // there is none when the game is over
+    Move predicted;
+    if(!getHashMove(&predicted)){
+        return;
+    }
+
+    // the ponder search sees the repetitions and the fifty move rule of
+    // the game too
+    packedPosition_t position;
+    packPosition(&position);
+    uint64_t keys[KEY_HISTORY_SIZE];
+    uint32_t keyCount = getRuleHistory(keys);
+    ponder.start(&position, keys, keyCount, getHalfmoveClock(), predicted, \
+                 AI_SEARCH_DEPTH);
 }
 
 /*---------------------------------------------------------------------------*/
-int ChessBoard::minimax(int depth, int alpha, int beta, bool maximizing)
+QString ChessBoard::getNotation(Move *move, uint8_t promotionType)
 {
-    if(depth == 0){
-        return getRating(maximizing);
-    }
+    // before the move is made, the board is needed for the notation
+    char san[SAN_MAX_LENGTH];
+    moveToSan(*move, san, promotionType);
 
-    Move moves[MAX_MOVES_EACH_TURN];
-    int moveCount = getAllMoves(moves, false);
-
-    if(moveCount == 0){
-        if(depth == AI_SEARCH_DEPTH){
-            gameOver();
-        }
-        return getRating(maximizing);
-    }
-
-    if(maximizing){
-        for(uint8_t i = 0; i < moveCount; i++){
-            makeMove(moves[i]);
-            int eval = minimax(depth - 1, alpha, beta, false);
-            undoLastMove();
-
-            if(alpha < eval){
-                alpha = eval;
-
-                if(depth == AI_SEARCH_DEPTH){
-                    bestMove = moves[i];
-                }
-            }
-
-            if(beta <= alpha) break;
-        }
-        return alpha;
-    } else{
-        for(uint8_t i = 0; i < moveCount; i++){
-            makeMove(moves[i]);
-            int eval = minimax(depth - 1, alpha, beta, true);
-            undoLastMove();
-
-            beta = (beta > eval) ? eval : beta;
-            if(beta <= alpha) break;
-        }
-        return beta;
-    }
-}
-
-/*---------------------------------------------------------------------------*/
-QString ChessBoard::getNotation(Move *move)
-{
-    // TODO: return full notation
-    QString notation = "";
-    notation.append(boardColumnNames[move->from.x])\
-            .append(QString::number(move->from.y))\
-            .append("-").append(boardColumnNames[move->to.x])\
-            .append(QString::number(move->to.y));
-    return notation;
+    return QString(san);
 }
 
 /*---------------------------------------------------------------------------*/
-void ChessBoard::askForNewPiece()
+uint8_t ChessBoard::askForNewPiece()
 {
     QMessageBox *msgBox = new QMessageBox(this);
     msgBox->setWindowTitle("Select the piece you want!");
@@ -869,18 +318,28 @@ void ChessBoard::askForNewPiece()
     msgBox->exec();
 
     if(msgBox->clickedButton() == rook){
-       chessPieces[selectedIndex].setType(PIECE_ROOK);
+        return PIECE_ROOK;
     } else if(msgBox->clickedButton() == knight){
-        chessPieces[selectedIndex].setType(PIECE_KNIGHT);
+        return PIECE_KNIGHT;
     } else if(msgBox->clickedButton() == bishop){
-        chessPieces[selectedIndex].setType(PIECE_BISHOP);
-    } else{
-        chessPieces[selectedIndex].setType(PIECE_QUEEN);
+        return PIECE_BISHOP;
     }
+
+    return PIECE_QUEEN;
 }
 
 /*---------------------------------------------------------------------------*/
 void ChessBoard::gameOver()
 {
-    qDebug() << (movementSide == SIDE_WHITE ? "Black" : "White") << " won!";
+    // stalemate or a draw by rule
+    int8_t result = PGN_RESULT_DRAW;
+    Move moves[MAX_MOVES_EACH_TURN];
+    if(isInCheck() && getAllMoves(moves) == 0){
+        result = movementSide == SIDE_WHITE ? PGN_RESULT_BLACK : \
+                                              PGN_RESULT_WHITE;
+        qDebug() << (movementSide == SIDE_WHITE ? "Black" : "White") \
+                 << " won!";
+    }
+
+    ((ChessGui *)parentWidget())->setResult(result);
 }
@@ -0,0 +1,1578 @@
+/*
+ * ChessEngine Class - board state, move generation and search without GUI
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "chessengine.h"
+#include "searchstats.h"
+#include "tracer.h"
+#include "movepicker.h"
+#include "zobrist.h"
+#include "pawnhash.h"
+#include "movecache.h"
+
+// for template defination linkage
+#include "stack.cpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+/*---------------------------------------------------------------------------*/
+#define AI_ASPIRATION_WINDOW 25 // initial half width, doubled on each fail
+#define TIME_CHECK_MASK      1023 // the clock is read every 1024 nodes
+
+static_assert(MOVE_CACHE_MAX_MOVES == MAX_MOVES_EACH_TURN && \
+              MOVE_CACHE_BOXES == BOARD_MATRIX_SIZE * BOARD_MATRIX_SIZE, \
+              "move cache sizes follow the board");
+
+/* https://chess.stackexchange.com/questions/4113/longest-chess-game-possible
+ * -maximum-moves */
+#define MAX_MOVES_IN_A_GAME    6400
+
+/*---------------------------------------------------------------------------*/
+// indexed by piece type
+const char fenPieceLetters[] = { 'b', 'k', 'n', 'p', 'q', 'r' };
+
+/*---------------------------------------------------------------------------*/
+ChessEngine::ChessEngine(uint32_t ttSizeMb)
+    : ChessEngine(new TranspositionTable(ttSizeMb))
+{
+    ownsTable = true;
+}
+
+/*---------------------------------------------------------------------------*/
+ChessEngine::ChessEngine(TranspositionTable *sharedTable)
+{
+    movePool = new Stack<Move>(MAX_MOVES_IN_A_GAME);
+    transpositionTable = sharedTable;
+    ownsTable = false;
+    learningFile = nullptr;
+    recordWriter = nullptr;
+    nodeReason = RECORD_EXACT;
+    stopRequested = false;
+    timeLimited = false;
+    timeUp = false;
+    timeCheckNodes = 0;
+    nodeCount = 0;
+    excludedRootCount = 0;
+
+    resetPosition();
+
+    searchParams.parse(getenv(SEARCH_PARAMS_ENV));
+    // a weight file first, single weights may override it
+    evalParams.load(getenv(EVAL_PARAMS_FILE_ENV));
+    evalParams.parse(getenv(EVAL_PARAMS_ENV));
+}
+
+/*---------------------------------------------------------------------------*/
+ChessEngine::~ChessEngine()
+{
+    if(movePool != nullptr){
+        delete movePool;
+    }
+    if(transpositionTable != nullptr && ownsTable){
+        delete transpositionTable;
+    }
+    delete recordWriter;
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::resetPosition()
+{
+    clearBoard();
+    initilizePieces();
+
+    movementSide = SIDE_WHITE;
+    computeHashKeys();
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::clearBoard()
+{
+    for(uint8_t i = 0; i < BOARD_MATRIX_SIZE; i++){
+        for(uint8_t j = 0; j < BOARD_MATRIX_SIZE; j++){
+            boardInfo[i][j].index = -1;
+            boardInfo[i][j].pressure = 0;
+        }
+    }
+
+    for(uint8_t i = 0; i < TOTAL_PIECE_NUM; i++){
+        chessPieces[i] = ChessPiece();
+        chessPieces[i].setPieceInfo(0, 0, PIECE_PAWN, i >= \
+                                    sidePieceStart(SIDE_WHITE));
+        chessPieces[i].setOnBoard(false);
+    }
+
+    movePool->clear();
+    bestMove = Move();
+    historyCount = 0;
+    halfmoveClock = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::packPosition(packedPosition_t *position)
+{
+    uint8_t count = 0;
+
+    position->board.occupancy = 0;
+    for(uint8_t i = 0; i < TOTAL_PIECE_NUM / 2; i++){
+        position->board.pieces[i] = 0;
+    }
+
+    // a1 .. h8 order, so the reader gets the codes by walking the bits
+    for(uint8_t y = 0; y < BOARD_MATRIX_SIZE; y++){
+        for(uint8_t x = 0; x < BOARD_MATRIX_SIZE; x++){
+            int8_t index = boardInfo[x][y].index;
+            if(index == -1){
+                continue;
+            }
+
+            uint8_t code = (chessPieces[index].side() << \
+                            PACKED_CODE_SIDE_SHIFT) | chessPieces[index].type();
+            position->board.occupancy |= BOARD_SQUARE_BIT(x, y);
+            position->board.pieces[count / 2] |= code << \
+                    ((count % 2) * PACKED_NIBBLE_BITS);
+            count++;
+        }
+    }
+
+    position->side = movementSide;
+    for(uint8_t i = 0; i < sizeof(position->reserved); i++){
+        position->reserved[i] = 0;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::unpackPosition(const packedPosition_t *position)
+{
+    uint8_t offsets[2] = { sidePieceStart(SIDE_BLACK), \
+                           sidePieceStart(SIDE_WHITE) };
+    uint8_t kings[2] = { 0, 0 };
+    uint8_t count = 0;
+
+    clearBoard();
+
+    for(uint8_t square = 0; square < BOARD_MATRIX_SIZE * BOARD_MATRIX_SIZE; \
+        square++){
+        if(!(position->board.occupancy & (1ULL << square))){
+            continue;
+        }
+
+        uint8_t code = (position->board.pieces[count / 2] >> \
+                        ((count % 2) * PACKED_NIBBLE_BITS)) & \
+                PACKED_NIBBLE_MASK;
+        bool side = code >> PACKED_CODE_SIDE_SHIFT;
+        uint8_t type = code & PACKED_CODE_TYPE_MASK;
+        count++;
+
+        if(type > PIECE_ROOK || count > TOTAL_PIECE_NUM || \
+           offsets[side] >= sidePieceStart(side) + TOTAL_PIECE_NUM / 2){
+            resetPosition();
+            return false;
+        }
+
+        uint8_t x = square % BOARD_MATRIX_SIZE;
+        uint8_t y = square / BOARD_MATRIX_SIZE;
+        if(type == PIECE_KING){
+            kings[side]++;
+            if(side == SIDE_WHITE){
+                whiteKingIndex = offsets[side];
+            } else{
+                blackKingIndex = offsets[side];
+            }
+        }
+
+        boardInfo[x][y].index = offsets[side];
+        chessPieces[offsets[side]++].setPieceInfo(x, y, type, side);
+    }
+
+    // search and evaluation expect exactly one king each
+    if(kings[SIDE_BLACK] != 1 || kings[SIDE_WHITE] != 1){
+        resetPosition();
+        return false;
+    }
+
+    movementSide = position->side != 0;
+    computeHashKeys();
+    updatePressures(); // as the gui does after each move
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::fenToPosition(const char *fen, packedPosition_t *position)
+{
+    uint8_t codes[BOARD_MATRIX_SIZE][BOARD_MATRIX_SIZE]; // [x][y], 0xFF empty
+    for(uint8_t i = 0; i < BOARD_MATRIX_SIZE; i++){
+        for(uint8_t j = 0; j < BOARD_MATRIX_SIZE; j++){
+            codes[i][j] = 0xFF;
+        }
+    }
+
+    // ranks are given from 8 to 1
+    int8_t x = 0, y = INVERTING_OFFSET;
+    for(; *fen != '\0' && *fen != ' ' && *fen != '\n'; fen++){
+        if(*fen == '/'){
+            x = 0;
+            y--;
+        } else if(*fen >= '1' && *fen <= '8'){
+            x += *fen - '0';
+        } else{
+            char lower = (*fen >= 'A' && *fen <= 'Z') ? *fen - 'A' + 'a' : *fen;
+            uint8_t type = 0;
+            while(type <= PIECE_ROOK && fenPieceLetters[type] != lower){
+                type++;
+            }
+            if(type > PIECE_ROOK || !BOARD_ON(x, y)){
+                return false;
+            }
+
+            bool side = (lower != *fen) ? SIDE_WHITE : SIDE_BLACK;
+            codes[x++][y] = (side << PACKED_CODE_SIDE_SHIFT) | type;
+        }
+
+        if(y < 0 || x > BOARD_MATRIX_SIZE){
+            return false;
+        }
+    }
+
+    while(*fen == ' '){
+        fen++;
+    }
+
+    uint8_t count = 0;
+    position->board.occupancy = 0;
+    for(uint8_t i = 0; i < TOTAL_PIECE_NUM / 2; i++){
+        position->board.pieces[i] = 0;
+    }
+    for(uint8_t j = 0; j < BOARD_MATRIX_SIZE; j++){
+        for(uint8_t i = 0; i < BOARD_MATRIX_SIZE; i++){
+            if(codes[i][j] == 0xFF){
+                continue;
+            }
+            if(count >= TOTAL_PIECE_NUM){
+                return false;
+            }
+
+            position->board.occupancy |= BOARD_SQUARE_BIT(i, j);
+            position->board.pieces[count / 2] |= codes[i][j] << \
+                    ((count % 2) * PACKED_NIBBLE_BITS);
+            count++;
+        }
+    }
+
+    position->side = (*fen == 'b') ? SIDE_BLACK : SIDE_WHITE;
+    for(uint8_t i = 0; i < sizeof(position->reserved); i++){
+        position->reserved[i] = 0;
+    }
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::positionToFen(const packedPosition_t *position, char *fen)
+{
+    uint8_t codes[BOARD_MATRIX_SIZE][BOARD_MATRIX_SIZE]; // [x][y], 0xFF empty
+    uint8_t count = 0;
+    for(uint8_t y = 0; y < BOARD_MATRIX_SIZE; y++){
+        for(uint8_t x = 0; x < BOARD_MATRIX_SIZE; x++){
+            codes[x][y] = 0xFF;
+            if(position->board.occupancy & BOARD_SQUARE_BIT(x, y)){
+                codes[x][y] = (position->board.pieces[count / 2] >> \
+                               ((count % 2) * PACKED_NIBBLE_BITS)) & \
+                        PACKED_NIBBLE_MASK;
+                count++;
+            }
+        }
+    }
+
+    // ranks from 8 to 1, empty boxes are counted
+    for(int8_t y = INVERTING_OFFSET; y >= 0; y--){
+        uint8_t empty = 0;
+        for(uint8_t x = 0; x < BOARD_MATRIX_SIZE; x++){
+            if(codes[x][y] == 0xFF){
+                empty++;
+                continue;
+            }
+            if(empty > 0){
+                *fen++ = '0' + empty;
+                empty = 0;
+            }
+
+            char letter = fenPieceLetters[codes[x][y] & PACKED_CODE_TYPE_MASK];
+            bool side = codes[x][y] >> PACKED_CODE_SIDE_SHIFT;
+            *fen++ = side == SIDE_WHITE ? letter - 'a' + 'A' : letter;
+        }
+        if(empty > 0){
+            *fen++ = '0' + empty;
+        }
+        if(y > 0){
+            *fen++ = '/';
+        }
+    }
+
+    *fen++ = ' ';
+    *fen++ = position->side == SIDE_BLACK ? 'b' : 'w';
+    *fen = '\0';
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::clearTranspositionTable()
+{
+    transpositionTable->clear();
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::setLearningFile(LearningFile *file)
+{
+    learningFile = file;
+}
+
+/*---------------------------------------------------------------------------*/
+int ChessEngine::search(int depth, uint32_t timeLimitMs)
+{
+    beginSearch(timeLimitMs);
+
+    // an exact result of an earlier session at least this deep is the
+    // answer. a shallower one is searched again from the first iteration,
+    // the deep nodes are found in the file but the shallow iterations
+    // still order the moves. the entry knows nothing of this game, so it
+    // is not taken when a repetition or the fifty move rule can matter
+    ttEntry_t learned;
+    Move learnedMove;
+    if(learningFile != nullptr && !isRepetition() && \
+       halfmoveClock + depth < FIFTY_MOVE_PLIES && \
+       learningFile->probe(hashKey, &learned) && \
+       learned.flag == TT_FLAG_EXACT && learned.depth >= depth && \
+       findLegalMove(learned.move, &learnedMove)){
+        makeMove(learnedMove);
+        bool repeats = isRepetition();
+        undoLastMove();
+
+        if(!repeats){
+            bestMove = learnedMove;
+            return learned.score;
+        }
+    }
+
+    // iterative deepening, each iteration seeds the next one's window and
+    // puts its best move first at the root
+    int score = 0;
+    for(int iteration = 1; iteration <= depth; iteration++){
+        Move finishedMove = bestMove;
+        int iterationScore;
+        STATS_CALL(beginIteration(iteration));
+        {
+            TRACE_SCOPE_ARG("iteration", iteration);
+            iterationScore = aspirationSearch(iteration, score);
+        }
+        STATS_CALL(endIteration());
+
+        // the root may have changed the move before it was stopped
+        if(searchAborted()){
+            bestMove = finishedMove;
+            break;
+        }
+        score = iterationScore;
+        timeLimited = timeLimitMs > 0;
+    }
+
+    return score;
+}
+
+/*---------------------------------------------------------------------------*/
+int ChessEngine::scoutRootMove(int depth, Move move, int bound, \
+                               int *completedDepth, uint32_t timeLimitMs)
+{
+    beginSearch(timeLimitMs);
+
+    Move moves[MAX_MOVES_EACH_TURN];
+    uint8_t count = getAllMoves(moves);
+    for(uint8_t i = 0; i < count; i++){
+        if(moves[i].packed() != move.packed()){
+            excludedRootMoves[excludedRootCount++] = moves[i].packed();
+        }
+    }
+
+    // shallow iterations fill the table and the killers for the last one
+    int score = bound;
+    *completedDepth = 0;
+    for(int iteration = 1; iteration <= depth; iteration++){
+        STATS_CALL(beginIteration(iteration));
+        bestMove = move;
+        int iterationScore = minimax(iteration, 0, bound, bound + 1);
+        STATS_CALL(endIteration());
+
+        if(searchAborted()){
+            break;
+        }
+        score = iterationScore;
+        *completedDepth = iteration;
+        timeLimited = timeLimitMs > 0;
+    }
+
+    excludedRootCount = 0;
+    return score;
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::beginSearch(uint32_t timeLimitMs)
+{
+    searchDeadline = std::chrono::steady_clock::now() + \
+            std::chrono::milliseconds(timeLimitMs);
+    timeLimited = false; // set after the first iteration
+    timeUp = false;
+    timeCheckNodes = 0;
+    nodeCount = 0;
+    excludedRootCount = 0;
+
+    // killers are only meaningful for the position they are found in
+    for(uint8_t i = 0; i < MAX_SEARCH_PLY; i++){
+        for(uint8_t j = 0; j < KILLER_MOVE_NUM; j++){
+            killerMoves[i][j] = Move();
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::stopSearch(bool stop)
+{
+    stopRequested = stop;
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::undoLastMove(bool turnSide)
+{
+    Move move;
+    if(movePool->pop(&move)){
+        int8_t movedPieceIndex = boardInfo[move.to.x][move.to.y].index;
+
+        // a promotion is taken back with the pawn
+        ChessPiece &moved = chessPieces[movedPieceIndex];
+        if(moved.type() != move.movedPiece.type()){
+            materialKey += MATERIAL_UNIT(moved.side(), \
+                                         move.movedPiece.type()) - \
+                    MATERIAL_UNIT(moved.side(), moved.type());
+        }
+
+        // move back the piece
+        chessPieces[movedPieceIndex] = move.movedPiece;
+        boardInfo[move.from.x][move.from.y].index = movedPieceIndex;
+
+        // get the eaten piece back if exist
+        if(move.pieceWasEaten){
+            ChessPiece &eaten = chessPieces[move.eatenPieceIndex];
+            eaten.setOnBoard(true);
+            boardInfo[move.to.x][move.to.y].index = move.eatenPieceIndex;
+            materialKey += MATERIAL_UNIT(eaten.side(), eaten.type());
+        } else{
+            boardInfo[move.to.x][move.to.y].index = -1;
+        }
+
+        hashKey = move.prevHashKey;
+        pawnHashKey = move.prevPawnHashKey;
+        halfmoveClock = move.prevHalfmoveClock;
+        historyCount--;
+
+        if(turnSide){
+            // turn the side
+            movementSide = !movementSide;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::initilizePieces()
+{
+    uint8_t x = 0, y = INVERTING_OFFSET, offset = 0;
+
+    // black other pieces
+    boardInfo[x][y].index = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_ROOK, SIDE_BLACK);
+    boardInfo[x][y].index = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_KNIGHT, SIDE_BLACK);
+    boardInfo[x][y].index = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_BISHOP, SIDE_BLACK);
+    boardInfo[x][y].index = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_QUEEN, SIDE_BLACK);
+    boardInfo[x][y].index = offset;
+
+    blackKingIndex = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_KING, SIDE_BLACK);
+
+    boardInfo[x][y].index = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_BISHOP, SIDE_BLACK);
+    boardInfo[x][y].index = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_KNIGHT, SIDE_BLACK);
+    boardInfo[x][y].index = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_ROOK, SIDE_BLACK);
+
+    // black pawns
+    x = 0;
+    y--;
+    for(int i = 0; i < BOARD_MATRIX_SIZE; i++){
+        boardInfo[x][y].index = offset;
+        chessPieces[offset++].setPieceInfo(x++, y, PIECE_PAWN, SIDE_BLACK);
+    }
+
+    // white pawns
+    x = 0;
+    y = 1;
+    for(int i = 0; i < BOARD_MATRIX_SIZE; i++){
+        boardInfo[x][y].index = offset;
+        chessPieces[offset++].setPieceInfo(x++, y, PIECE_PAWN, SIDE_WHITE);
+    }
+
+    // white other pieces
+    x = 0;
+    y--;
+
+    boardInfo[x][y].index = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_ROOK, SIDE_WHITE);
+    boardInfo[x][y].index = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_KNIGHT, SIDE_WHITE);
+    boardInfo[x][y].index = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_BISHOP, SIDE_WHITE);
+    boardInfo[x][y].index = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_QUEEN, SIDE_WHITE);
+    boardInfo[x][y].index = offset;
+
+    whiteKingIndex = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_KING, SIDE_WHITE);
+
+    boardInfo[x][y].index = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_BISHOP, SIDE_WHITE);
+    boardInfo[x][y].index = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_KNIGHT, SIDE_WHITE);
+    boardInfo[x][y].index = offset;
+    chessPieces[offset++].setPieceInfo(x++, y, PIECE_ROOK, SIDE_WHITE);
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::updatePressures(uint8_t (*pressures)[BOARD_MATRIX_SIZE])
+{
+    // the maps of a position seen lately, by the gui or the engines of
+    // this thread, are copied
+    uint8_t counts[MOVE_CACHE_BOXES];
+    const moveCacheEntry_t *cached = threadMoveCache().probe(hashKey);
+    if(cached != nullptr && cached->hasPressures){
+        memcpy(counts, cached->pressures, sizeof(counts));
+    } else{
+        memset(counts, 0, sizeof(counts));
+
+        Move moves[MAX_MOVES_EACH_TURN];
+
+        // change movement side for getting other side's attacked boxes
+        movementSide = !movementSide;
+        uint8_t moveCount = generateMoves(moves, GEN_ATTACKS);
+        movementSide = !movementSide; // set back
+
+        for(uint8_t i = 0; i < moveCount; i++){
+            counts[moves[i].to.x * BOARD_MATRIX_SIZE + moves[i].to.y]++;
+        }
+
+        moveCacheEntry_t *entry = threadMoveCache().entry(hashKey);
+        memcpy(entry->pressures, counts, sizeof(counts));
+        entry->hasPressures = true;
+    }
+
+    for(uint8_t i = 0; i < BOARD_MATRIX_SIZE; i++){
+        for(uint8_t j = 0; j < BOARD_MATRIX_SIZE; j++){
+            if(pressures == nullptr){
+                boardInfo[i][j].pressure = counts[i * BOARD_MATRIX_SIZE + j];
+            } else{
+                pressures[i][j] = counts[i * BOARD_MATRIX_SIZE + j];
+            }
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::checkKingPressure(Move *move)
+{
+    bool side = chessPieces[boardInfo[move->from.x][move->from.y].index].side();
+    ChessPiece &king = chessPieces[side == SIDE_WHITE ? whiteKingIndex : \
+                                                        blackKingIndex];
+
+    // only the own king box is looked at after the move
+    makeMove(*move, false);
+    bool underPressure = isSquareAttacked(king.x(), king.y(), !side);
+    undoLastMove(false);
+
+    return !underPressure;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::isInCheck()
+{
+    ChessPiece &king = chessPieces[movementSide == SIDE_WHITE ? \
+                                   whiteKingIndex : blackKingIndex];
+
+    return isSquareAttacked(king.x(), king.y(), !movementSide);
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::isRepetition(uint8_t times)
+{
+    // the same side moves every second ply, an irreversible move ends
+    // the search. the ring is long enough below the fifty move rule. its
+    // oldest slot is the one the next move, a trial one too, writes to
+    uint32_t plies = std::min<uint32_t>(halfmoveClock, historyCount);
+    plies = std::min<uint32_t>(plies, KEY_HISTORY_SIZE - 1);
+    for(uint32_t i = 4; i <= plies; i += 2){
+        if(keyHistory[(historyCount - i) & (KEY_HISTORY_SIZE - 1)] == \
+           hashKey && --times == 0){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::isDrawByRule()
+{
+    return halfmoveClock >= FIFTY_MOVE_PLIES || isRepetition(2);
+}
+
+/*---------------------------------------------------------------------------*/
+int8_t ChessEngine::leastValuableAttacker(uint8_t x, uint8_t y, bool side, \
+                                          uint64_t removed)
+{
+    int8_t best = -1;
+    int bestValue = 0;
+
+    // removed pieces are already exchanged, rays look through them
+#define SEE_CONSIDER(px, py, types) \
+    do{ \
+        int8_t index = boardInfo[px][py].index; \
+        ChessPiece &piece = chessPieces[index]; \
+        if(piece.side() == side && ((types) & (1 << piece.type()))){ \
+            int value = abs(piece.point()); \
+            if(best < 0 || value < bestValue){ \
+                best = index; \
+                bestValue = value; \
+            } \
+        } \
+    } while(0)
+#define SEE_OCCUPIED(px, py) (boardInfo[px][py].index != -1 && \
+    !(removed & (1ULL << ((py) * BOARD_MATRIX_SIZE + (px)))))
+
+    // pawns attack forward, so look one rank behind the target
+    int8_t pawnY = (side == SIDE_WHITE) ? y - 1 : y + 1;
+    if(pawnY >= 0 && pawnY < BOARD_MATRIX_SIZE){
+        if(x > 0 && SEE_OCCUPIED(x - 1, pawnY)){
+            SEE_CONSIDER(x - 1, pawnY, 1 << PIECE_PAWN);
+        }
+        if(x < BOARD_MATRIX_SIZE - 1 && SEE_OCCUPIED(x + 1, pawnY)){
+            SEE_CONSIDER(x + 1, pawnY, 1 << PIECE_PAWN);
+        }
+    }
+
+    for(uint8_t i = 0; i < OFFSET_NUM; i++){
+        int8_t newX = x + knightOffsets[i][0];
+        int8_t newY = y + knightOffsets[i][1];
+        if(newX >= 0 && newX < BOARD_MATRIX_SIZE && newY >= 0 && \
+           newY < BOARD_MATRIX_SIZE && SEE_OCCUPIED(newX, newY)){
+            SEE_CONSIDER(newX, newY, 1 << PIECE_KNIGHT);
+        }
+    }
+
+    // diagonal rays have both offsets set
+    for(uint8_t i = 0; i < OFFSET_NUM; i++){
+        int8_t dx = rayOffsets[i][0];
+        int8_t dy = rayOffsets[i][1];
+        int sliders = (1 << PIECE_QUEEN) | \
+                ((dx != 0 && dy != 0) ? (1 << PIECE_BISHOP) : (1 << PIECE_ROOK));
+
+        int8_t newX = x + dx;
+        int8_t newY = y + dy;
+        bool adjacent = true;
+        while(newX >= 0 && newX < BOARD_MATRIX_SIZE && newY >= 0 && \
+              newY < BOARD_MATRIX_SIZE){
+            if(SEE_OCCUPIED(newX, newY)){
+                SEE_CONSIDER(newX, newY, adjacent ? \
+                             (sliders | (1 << PIECE_KING)) : sliders);
+                break;
+            }
+            newX += dx;
+            newY += dy;
+            adjacent = false;
+        }
+    }
+
+#undef SEE_OCCUPIED
+#undef SEE_CONSIDER
+
+    return best;
+}
+
+/*---------------------------------------------------------------------------*/
+int ChessEngine::staticExchange(Move *move)
+{
+    int gain[TOTAL_PIECE_NUM + 1];
+    uint8_t x = move->to.x;
+    uint8_t y = move->to.y;
+
+    int8_t victim = boardInfo[x][y].index;
+    int8_t attacker = boardInfo[move->from.x][move->from.y].index;
+    if(attacker < 0){
+        return 0;
+    }
+
+    gain[0] = victim >= 0 ? abs(chessPieces[victim].point()) : 0;
+    uint64_t removed = 1ULL << (move->from.y * BOARD_MATRIX_SIZE + \
+                                move->from.x);
+    int attackerValue = abs(chessPieces[attacker].point());
+    bool side = !chessPieces[attacker].side();
+
+    // swap list, each side recaptures with its least valuable attacker
+    uint8_t depth = 0;
+    while(depth < TOTAL_PIECE_NUM){
+        depth++;
+        gain[depth] = attackerValue - gain[depth - 1];
+        if(std::max(-gain[depth - 1], gain[depth]) < 0){
+            break; // neither side can profit from continuing
+        }
+
+        int8_t next = leastValuableAttacker(x, y, side, removed);
+        if(next < 0){
+            break;
+        }
+
+        removed |= 1ULL << (chessPieces[next].y() * BOARD_MATRIX_SIZE + \
+                            chessPieces[next].x());
+        attackerValue = abs(chessPieces[next].point());
+        side = !side;
+    }
+
+    while(--depth){
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+    }
+
+    return gain[0] * PIECE_POINT_SCALE;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::hasNonPawnMaterial()
+{
+    return MATERIAL_COUNT(materialKey, movementSide, PIECE_BISHOP) + \
+            MATERIAL_COUNT(materialKey, movementSide, PIECE_KNIGHT) + \
+            MATERIAL_COUNT(materialKey, movementSide, PIECE_QUEEN) + \
+            MATERIAL_COUNT(materialKey, movementSide, PIECE_ROOK) > 0;
+}
+
+/*---------------------------------------------------------------------------*/
+uint8_t ChessEngine::getAllMoves(Move *moves)
+{
+    // legal moves depend on the position only, the ones of a position seen
+    // lately are unpacked
+    const moveCacheEntry_t *cached = threadMoveCache().probe(hashKey);
+    if(cached == nullptr || !cached->hasMoves){
+        uint8_t moveCount = generateMoves(moves, GEN_ALL);
+
+        // eliminate the king pressure moves
+        uint16_t legalMoves[MAX_MOVES_EACH_TURN];
+        uint8_t legalCount = 0;
+        for(uint8_t i = 0; i < moveCount; i++){
+            if(checkKingPressure(&moves[i])){
+                legalMoves[legalCount++] = moves[i].packed();
+            }
+        }
+
+        cacheLegalMoves(legalMoves, legalCount);
+        cached = threadMoveCache().probe(hashKey);
+    }
+
+    for(uint8_t i = 0; i < cached->moveCount; i++){
+        moves[i].setPacked(cached->moves[i]);
+    }
+
+    return cached->moveCount;
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::cacheLegalMoves(uint16_t *moves, uint8_t count)
+{
+    const moveCacheEntry_t *cached = threadMoveCache().probe(hashKey);
+    if(cached != nullptr && cached->hasMoves){
+        return;
+    }
+
+    // the same list for every engine sharing the cache, whatever the
+    // piece slots of the position
+    std::sort(moves, moves + count);
+
+    moveCacheEntry_t *entry = threadMoveCache().entry(hashKey);
+    memcpy(entry->moves, moves, count * sizeof(uint16_t));
+    entry->moveCount = count;
+    entry->hasMoves = true;
+}
+
+/*---------------------------------------------------------------------------*/
+uint8_t ChessEngine::prepareLegalMoves(ChessPiece piece, Move *moves)
+{
+    // a piece of the side to move is picked from all the legal moves, so
+    // the clicks of a turn share one generation
+    if(piece.side() == movementSide){
+        Move allMoves[MAX_MOVES_EACH_TURN];
+        uint8_t moveCount = getAllMoves(allMoves);
+
+        uint8_t newMoveCount = 0;
+        for(uint8_t i = 0; i < moveCount; i++){
+            if(allMoves[i].from.x == piece.x() && \
+               allMoves[i].from.y == piece.y()){
+                moves[newMoveCount++] = allMoves[i];
+            }
+        }
+
+        return newMoveCount;
+    }
+
+    uint8_t moveCount = preparePseudoMoves(piece, moves);
+
+    // eliminate the king pressure moves, king moves too
+    uint8_t newMoveCount = 0;
+    for(uint8_t i = 0; i < moveCount; i++){
+        if(checkKingPressure(&moves[i])){
+            moves[newMoveCount++] = moves[i];
+        }
+    }
+
+    return newMoveCount;
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::makeMove(Move move, bool turnSide)
+{
+    if(chessPieces[boardInfo[move.from.x][move.from.y].index].side() == \
+       SIDE_WHITE){
+        makeSideMove<SIDE_WHITE>(move, turnSide);
+    } else{
+        makeSideMove<SIDE_BLACK>(move, turnSide);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+template <bool Side>
+void ChessEngine::makeSideMove(Move &move, bool turnSide)
+{
+    // clear if any piece exist in next box
+    uint8_t currentIndex = boardInfo[move.from.x][move.from.y].index;
+    int8_t nextIndex = boardInfo[move.to.x][move.to.y].index;
+    move.prevHashKey = hashKey;
+    move.prevPawnHashKey = pawnHashKey;
+    move.prevHalfmoveClock = halfmoveClock;
+    keyHistory[historyCount++ & (KEY_HISTORY_SIZE - 1)] = hashKey;
+    halfmoveClock = nextIndex >= 0 || \
+            chessPieces[currentIndex].type() == PIECE_PAWN ? \
+                0 : halfmoveClock + 1;
+    if(nextIndex >= 0){
+        chessPieces[nextIndex].setOnBoard(false);
+        uint64_t eatenKey = Zobrist::pieceKey(!Side, \
+                chessPieces[nextIndex].type(), move.to.x, move.to.y);
+        hashKey ^= eatenKey;
+        if(chessPieces[nextIndex].type() == PIECE_PAWN){
+            pawnHashKey ^= eatenKey;
+        }
+        materialKey -= MATERIAL_UNIT(!Side, chessPieces[nextIndex].type());
+    }
+    move.setMovedPiece(chessPieces[currentIndex]);
+    move.setEatenPieceIndex(nextIndex);
+
+    movePool->push(move);
+
+    uint8_t type = chessPieces[currentIndex].type();
+    uint64_t movedKey = Zobrist::pieceKey(Side, type, move.from.x, \
+                                          move.from.y) ^ \
+            Zobrist::pieceKey(Side, type, move.to.x, move.to.y);
+    hashKey ^= movedKey;
+    if(type == PIECE_PAWN){
+        pawnHashKey ^= movedKey;
+    }
+
+    // set new position
+    chessPieces[currentIndex].setPosition(move.to.x, move.to.y);
+    boardInfo[move.to.x][move.to.y].index = currentIndex;
+
+    // set old position as not in use
+    boardInfo[move.from.x][move.from.y].index = -1;
+
+    if(turnSide){
+        // turn the side
+        movementSide = !movementSide;
+        hashKey ^= Zobrist::sideKey();
+
+        // the child probes this slot first, the load runs meanwhile
+        transpositionTable->prefetch(hashKey);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::playMove(Move move, uint8_t promotionType, bool updateMaps)
+{
+    makeMove(move);
+
+    int8_t index = boardInfo[move.to.x][move.to.y].index;
+    if((move.to.y == 0 || move.to.y == BOARD_MATRIX_SIZE - 1) && \
+       chessPieces[index].type() == PIECE_PAWN){
+        chessPieces[index].setType(promotionType);
+        computeHashKeys();
+    }
+
+    if(updateMaps){
+        TRACE_SCOPE("updatePressures");
+        updatePressures();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::sideToMove()
+{
+    return movementSide;
+}
+
+/*---------------------------------------------------------------------------*/
+Move ChessEngine::getBestMove()
+{
+    return bestMove;
+}
+
+/*---------------------------------------------------------------------------*/
+uint64_t ChessEngine::getNodeCount()
+{
+    return nodeCount;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::getHashMove(Move *move)
+{
+    ttEntry_t entry;
+    if(!transpositionTable->probe(hashKey, &entry) || \
+       entry.move == TT_NO_MOVE){
+        return false;
+    }
+
+    // the key may be of another position, the move is checked
+    return findLegalMove(entry.move, move);
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::findLegalMove(uint16_t packed, Move *move)
+{
+    Move moves[MAX_MOVES_EACH_TURN];
+    uint8_t count = getAllMoves(moves);
+    for(uint8_t i = 0; i < count; i++){
+        if(moves[i].packed() == packed){
+            *move = moves[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*---------------------------------------------------------------------------*/
+uint64_t ChessEngine::positionKey()
+{
+    return hashKey;
+}
+
+/*---------------------------------------------------------------------------*/
+uint16_t ChessEngine::getHalfmoveClock()
+{
+    return halfmoveClock;
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::setRuleHistory(const uint64_t *keys, uint32_t count, \
+                                 uint16_t clock)
+{
+    // only the last ring length of keys can be looked at
+    uint32_t first = count > KEY_HISTORY_SIZE ? count - KEY_HISTORY_SIZE : 0;
+    for(uint32_t i = first; i < count; i++){
+        keyHistory[i & (KEY_HISTORY_SIZE - 1)] = keys[i];
+    }
+    historyCount = count;
+    halfmoveClock = clock;
+}
+
+/*---------------------------------------------------------------------------*/
+uint32_t ChessEngine::getRuleHistory(uint64_t *keys)
+{
+    uint32_t count = std::min<uint32_t>(halfmoveClock, historyCount);
+    count = std::min<uint32_t>(count, KEY_HISTORY_SIZE - 1);
+    for(uint32_t i = 0; i < count; i++){
+        keys[i] = keyHistory[(historyCount - count + i) & \
+                             (KEY_HISTORY_SIZE - 1)];
+    }
+
+    return count;
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::computeHashKeys()
+{
+    hashKey = 0;
+    pawnHashKey = 0;
+    materialKey = 0;
+    for(uint8_t i = 0; i < TOTAL_PIECE_NUM; i++){
+        if(chessPieces[i].onBoard()){
+            materialKey += MATERIAL_UNIT(chessPieces[i].side(), \
+                                         chessPieces[i].type());
+            uint64_t key = Zobrist::pieceKey(chessPieces[i].side(), \
+                    chessPieces[i].type(), chessPieces[i].x(), \
+                    chessPieces[i].y());
+            hashKey ^= key;
+            if(chessPieces[i].type() == PIECE_PAWN){
+                pawnHashKey ^= key;
+            }
+        }
+    }
+
+    if(movementSide == SIDE_BLACK){
+        hashKey ^= Zobrist::sideKey();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+int ChessEngine::getRating()
+{
+    // one lookup, most positions are not a known ending
+    const endgameEntry_t *endgame = endgameTable().probe(materialKey);
+    int sum = endgame != nullptr ? endgameRating(*endgame) : \
+            materialRating() + positionalRating();
+
+    // relative to the side to move as negamax expects
+    return movementSide == SIDE_WHITE ? sum : (-1 * sum);
+}
+
+/*---------------------------------------------------------------------------*/
+int ChessEngine::materialRating()
+{
+    int16_t features[EVAL_PARAM_NUM];
+    materialFeatures(features);
+
+    return evalParams.weigh(features, EVAL_MATERIAL_FIRST, \
+                            EVAL_POSITIONAL_FIRST);
+}
+
+/*---------------------------------------------------------------------------*/
+int ChessEngine::positionalRating()
+{
+    int16_t features[EVAL_PARAM_NUM];
+    positionalFeatures(features);
+
+    return evalParams.weigh(features, EVAL_POSITIONAL_FIRST, EVAL_PARAM_NUM);
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::evalFeatures(int16_t *features)
+{
+    materialFeatures(features);
+    positionalFeatures(features);
+}
+
+/*---------------------------------------------------------------------------*/
+const EvalParams &ChessEngine::getEvalParams()
+{
+    return evalParams;
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::setEvalParams(const EvalParams &params)
+{
+    evalParams = params;
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::materialFeatures(int16_t *features)
+{
+    // indexed by piece type, kings are never exchanged
+    static const int8_t materialIndex[] = {
+        EVAL_BISHOP, -1, EVAL_KNIGHT, EVAL_PAWN, EVAL_QUEEN, EVAL_ROOK
+    };
+
+    for(uint8_t i = EVAL_MATERIAL_FIRST; i < EVAL_POSITIONAL_FIRST; i++){
+        features[i] = 0;
+    }
+
+    for(uint8_t i = 0; i < TOTAL_PIECE_NUM; i++){
+        int8_t index = materialIndex[chessPieces[i].type()];
+        if(chessPieces[i].onBoard() && index >= 0){
+            features[index] += chessPieces[i].side() ? 1 : -1;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::positionalFeatures(int16_t *features)
+{
+    uint64_t pawns[2] = { 0, 0 };
+    for(uint8_t i = 0; i < TOTAL_PIECE_NUM; i++){
+        if(chessPieces[i].onBoard() && chessPieces[i].type() == PIECE_PAWN){
+            pawns[chessPieces[i].side() ? PAWN_SIDE_WHITE : \
+                    PAWN_SIDE_BLACK] |= PAWN_SQUARE_BIT(\
+                    chessPieces[i].x(), chessPieces[i].y());
+        }
+    }
+
+    ChessPiece &whiteKing = chessPieces[whiteKingIndex];
+    ChessPiece &blackKing = chessPieces[blackKingIndex];
+    // from the node itself, the attack maps of the board are the root's
+    features[EVAL_KING_PRESSURE] = \
+            kingZoneAttacks(blackKing, SIDE_WHITE) - \
+            kingZoneAttacks(whiteKing, SIDE_BLACK);
+
+    // pawn structure rarely changes between siblings, mostly a cache hit
+    const pawnEntry_t *pawnEntry = threadPawnHashTable().probe(pawnHashKey, \
+            pawns[PAWN_SIDE_WHITE], pawns[PAWN_SIDE_BLACK]);
+    for(uint8_t i = 0; i < EVAL_PAWN_TERM_NUM; i++){
+        features[EVAL_PAWN_TERM_FIRST + i] = pawnEntry->terms[i];
+    }
+    features[EVAL_PAWN_SHELTER] = \
+            PawnHashTable::shelterHoles(pawnEntry, PAWN_SIDE_WHITE, \
+                                        whiteKing.x()) - \
+            PawnHashTable::shelterHoles(pawnEntry, PAWN_SIDE_BLACK, \
+                                        blackKing.x());
+}
+
+/*---------------------------------------------------------------------------*/
+// mate scores are kept relative to the node in the table, it may be
+// found again at another distance from the root
+static int scoreToTable(int score, int ply)
+{
+    if(score >= SCORE_MATE_BOUND){
+        return score + ply;
+    } else if(score <= -SCORE_MATE_BOUND){
+        return score - ply;
+    }
+
+    return score;
+}
+
+/*---------------------------------------------------------------------------*/
+static int scoreFromTable(int score, int ply)
+{
+    if(score >= SCORE_MATE_BOUND){
+        return score - ply;
+    } else if(score <= -SCORE_MATE_BOUND){
+        return score + ply;
+    }
+
+    return score;
+}
+
+/*---------------------------------------------------------------------------*/
+int ChessEngine::aspirationSearch(int depth, int previousScore)
+{
+    if(depth == 1){
+        return minimax(depth, 0, -SCORE_INFINITE, SCORE_INFINITE);
+    }
+
+    int delta = AI_ASPIRATION_WINDOW;
+    int alpha = std::max(previousScore - delta, -SCORE_INFINITE);
+    int beta = std::min(previousScore + delta, SCORE_INFINITE);
+
+    while(true){
+        int score = minimax(depth, 0, alpha, beta);
+
+        if(searchAborted()){
+            return score;
+        } else if(score > alpha && score < beta){
+            return score;
+        } else if(alpha == -SCORE_INFINITE && beta == SCORE_INFINITE){
+            return score; // already full window
+        }
+
+        // widen the failed side and search again
+        delta *= 2;
+        if(score <= alpha){
+            alpha = std::max(score - delta, -SCORE_INFINITE);
+        } else{
+            beta = std::min(score + delta, SCORE_INFINITE);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+int ChessEngine::quiescence(int ply, int alpha, int beta)
+{
+    STATS_INC(qnodes);
+    nodeCount++;
+
+    int standPat;
+    {
+        STATS_TIMER(evalNs);
+        standPat = getRating();
+    }
+
+    if(standPat >= beta || ply >= MAX_SEARCH_PLY){
+        return standPat;
+    }
+    if(standPat > alpha){
+        alpha = standPat;
+    }
+
+    // only captures which do not lose material on the exchange
+    MovePicker picker(this, TT_NO_MOVE, nullptr, true);
+
+    int bestScore = standPat;
+    Move move;
+    while(true){
+        {
+            STATS_TIMER(movegenNs);
+            if(!picker.next(&move)){
+                break;
+            }
+        }
+
+        {
+            STATS_TIMER(makeUnmakeNs);
+            makeMove(move);
+        }
+        int score = -quiescence(ply + 1, -beta, -alpha);
+        {
+            STATS_TIMER(makeUnmakeNs);
+            undoLastMove();
+        }
+
+        if(score > bestScore){
+            bestScore = score;
+        }
+        if(score > alpha){
+            alpha = score;
+        }
+        if(alpha >= beta){
+            STATS_INC(betaCutoffs);
+            break;
+        }
+    }
+
+    return bestScore;
+}
+
+/*---------------------------------------------------------------------------*/
+int ChessEngine::minimax(int depth, int ply, int alpha, int beta, \
+                         bool allowNull)
+{
+    if(recordWriter != nullptr && ply <= recordWriter->getMaxPly()){
+        return recordNode(depth, ply, alpha, beta, allowNull);
+    }
+
+    return searchNode(depth, ply, alpha, beta, allowNull);
+}
+
+/*---------------------------------------------------------------------------*/
+int ChessEngine::searchNode(int depth, int ply, int alpha, int beta, \
+                            bool allowNull)
+{
+    STATS_INC(nodes);
+    nodeCount++;
+
+    if(timeLimited && (++timeCheckNodes & TIME_CHECK_MASK) == 0 && \
+       std::chrono::steady_clock::now() >= searchDeadline){
+        timeUp = true;
+    }
+    if(searchAborted()){
+        nodeReason = RECORD_ABORTED;
+        return 0; // thrown away by the callers
+    }
+
+    if(ply > 0){
+        // the line is a draw, cycling through it again can not win more
+        if(halfmoveClock >= FIFTY_MOVE_PLIES || isRepetition()){
+            nodeReason = RECORD_DRAW;
+            return SCORE_DRAW;
+        }
+
+        // a mate from here is not shorter than the one already found
+        alpha = std::max(alpha, -SCORE_MATE + ply);
+        beta = std::min(beta, SCORE_MATE - ply - 1);
+        if(alpha >= beta){
+            nodeReason = RECORD_MATE_DISTANCE;
+            return alpha;
+        }
+    }
+
+    // extend checks so the leaf is never evaluated in the middle of one
+    bool inCheck = false;
+    if(ply > 0 && (depth > 0 || searchParams.checkExtension > 0)){
+        inCheck = isInCheck();
+        if(inCheck && ply < MAX_SEARCH_PLY && searchParams.checkExtension){
+            depth += searchParams.checkExtension;
+            STATS_INC(checkExtensions);
+        }
+    }
+
+    if(depth <= 0 || ply >= MAX_SEARCH_PLY){
+        nodeReason = RECORD_LEAF;
+        return quiescence(ply, alpha, beta);
+    }
+
+    bool pvNode = (beta - alpha) > 1;
+
+    ttEntry_t ttEntry;
+    bool ttHit = transpositionTable->probe(hashKey, &ttEntry);
+    STATS_INC(ttProbes);
+    if(ttHit){
+        STATS_INC(ttHits);
+    }
+
+    // a deeper result of an earlier session, copied to the table so the
+    // file is read once
+    ttEntry_t learned;
+    if(learningFile != nullptr && depth >= learningFile->getMinDepth() && \
+       (!ttHit || ttEntry.depth < depth) && \
+       learningFile->probe(hashKey, &learned) && \
+       (!ttHit || learned.depth > ttEntry.depth)){
+        STATS_INC(learningHits);
+        ttEntry = learned;
+        ttHit = true;
+        transpositionTable->store(hashKey, learned.depth, learned.score, \
+                                  learned.flag, learned.move);
+    }
+
+    if(ttHit){
+        ttEntry.score = scoreFromTable(ttEntry.score, ply);
+
+        // bounds are trusted outside of the principal variation only
+        if(ply > 0 && !pvNode && ttEntry.depth >= depth && \
+           (ttEntry.flag == TT_FLAG_EXACT || \
+            (ttEntry.flag == TT_FLAG_LOWER && ttEntry.score >= beta) || \
+            (ttEntry.flag == TT_FLAG_UPPER && ttEntry.score <= alpha))){
+            nodeReason = RECORD_TABLE;
+            return ttEntry.score;
+        }
+    }
+
+    int staticEval = 0;
+    if(ply > 0 && !inCheck && !pvNode){
+        STATS_TIMER(evalNs);
+        staticEval = getRating();
+    }
+
+    if(ply > 0 && !inCheck && !pvNode){
+        // reverse futility, too far above beta to be caught up near leaves
+        if(searchParams.reverseFutility && \
+           depth <= searchParams.reverseFutilityDepth && \
+           staticEval - searchParams.reverseFutilityMargin * depth >= beta){
+            STATS_INC(reverseFutilityPrunes);
+            nodeReason = RECORD_REVERSE_FUTILITY;
+            return staticEval;
+        }
+
+        // null move, give a free move and see if still fails high. zugzwang
+        // positions are mostly pawn endings so those are excluded
+        if(searchParams.nullMove && allowNull && \
+           depth >= searchParams.nullMoveMinDepth && staticEval >= beta && \
+           hasNonPawnMaterial()){
+            int reduction = searchParams.nullMoveReduction;
+            if(searchParams.nullMoveDepthDivisor > 0){
+                reduction += depth / searchParams.nullMoveDepthDivisor;
+            }
+
+            // no repetition reaches back over the null move
+            uint16_t clock = halfmoveClock;
+            halfmoveClock = 0;
+            movementSide = !movementSide;
+            hashKey ^= Zobrist::sideKey();
+            int score = -minimax(depth - 1 - reduction, ply + 1, -beta, \
+                                 -beta + 1, false);
+            hashKey ^= Zobrist::sideKey();
+            movementSide = !movementSide;
+            halfmoveClock = clock;
+
+            if(score >= beta){
+                STATS_INC(nullMoveCutoffs);
+                nodeReason = RECORD_NULL_MOVE;
+                return beta;
+            }
+        }
+    }
+
+    // quiet moves can not lift a hopeless eval above alpha near leaves
+    bool futile = searchParams.futility && ply > 0 && !inCheck && \
+            !pvNode && depth <= searchParams.futilityDepth && \
+            staticEval + searchParams.futilityMargin * depth <= alpha;
+
+    // the previous iteration's best move goes first at the root
+    uint16_t hashMove = ttHit ? ttEntry.move : (uint16_t)TT_NO_MOVE;
+    if(ply == 0){
+        hashMove = bestMove.packed();
+    }
+    MovePicker picker(this, hashMove, killerMoves[ply], false, inCheck);
+
+    int originalAlpha = alpha;
+    int bestScore = -SCORE_INFINITE;
+    Move nodeBestMove;
+    uint8_t moveNumber = 0;
+    bool hasMoves = false;
+    // the picker gives every legal move of a node without a cutoff. the
+    // root and the child of its best move are such nodes, the gui asks
+    // for both of them again
+    uint8_t seenCount = 0;
+    Move move;
+    while(true){
+        {
+            STATS_TIMER(movegenNs);
+            if(!picker.next(&move)){
+                break;
+            }
+        }
+        hasMoves = true;
+        if(ply <= CACHED_SEARCH_PLY){
+            seenMoves[ply][seenCount++] = move.packed();
+        }
+
+        // lines already found by the earlier multi-pv passes
+        if(ply == 0 && excludedRootCount > 0 && \
+           isExcludedRootMove(move.packed())){
+            continue;
+        }
+
+        bool quiet = picker.lastWasQuiet();
+        uint8_t i = moveNumber++;
+
+        if(futile && quiet && i > 0){
+            STATS_INC(futilityPrunes);
+            continue;
+        }
+
+        TRACE_SCOPE_ARG(ply == 0 ? "rootMove" : nullptr, \
+                        TRACE_MOVE_ARG(move));
+        {
+            STATS_TIMER(makeUnmakeNs);
+            makeMove(move);
+        }
+
+        // full window for the first move, null window for the rest and
+        // a re-search only if one of them beats alpha
+        int score;
+        if(i == 0){
+            score = -minimax(depth - 1, ply + 1, -beta, -alpha);
+        } else{
+            // late quiet moves are searched shallower first
+            int reduction = 0;
+            if(searchParams.lmr && quiet && !inCheck && \
+               depth >= searchParams.lmrMinDepth && \
+               i >= searchParams.lmrMinMoves){
+                reduction = searchParams.reduction(depth, i);
+                if(reduction >= depth){
+                    reduction = depth - 1;
+                }
+            }
+
+            if(reduction > 0){
+                STATS_INC(lmrReductions);
+                score = -minimax(depth - 1 - reduction, ply + 1, \
+                                 -alpha - 1, -alpha);
+                if(score > alpha){
+                    STATS_INC(lmrResearches);
+                    score = -minimax(depth - 1, ply + 1, -alpha - 1, -alpha);
+                }
+            } else{
+                score = -minimax(depth - 1, ply + 1, -alpha - 1, -alpha);
+            }
+
+            if(score > alpha && score < beta){
+                score = -minimax(depth - 1, ply + 1, -beta, -alpha);
+            }
+        }
+
+        {
+            STATS_TIMER(makeUnmakeNs);
+            undoLastMove();
+        }
+
+        // the score is not real, it must not reach the table
+        if(searchAborted()){
+            nodeReason = RECORD_ABORTED;
+            return 0;
+        }
+
+        if(score > bestScore){
+            bestScore = score;
+            nodeBestMove = move;
+            if(ply == 0 && (score > alpha || i == 0)){
+                bestMove = move;
+            }
+        }
+
+        if(score > alpha){
+            alpha = score;
+        }
+
+        if(alpha >= beta){
+            STATS_INC(betaCutoffs);
+            if(i == 0){
+                STATS_INC(firstMoveCutoffs);
+            }
+            if(quiet){
+                storeKiller(ply, move);
+            }
+            break;
+        }
+    }
+
+    if(ply <= CACHED_SEARCH_PLY && alpha < beta){
+        cacheLegalMoves(seenMoves[ply], seenCount);
+    }
+
+    if(moveNumber == 0){
+        nodeReason = RECORD_NO_MOVES;
+        if(hasMoves){
+            // every root move is excluded
+            STATS_TIMER(evalNs);
+            return getRating();
+        }
+
+        // checkmate, a nearer one scores more for the winner, or stalemate
+        return inCheck || isInCheck() ? -SCORE_MATE + ply : SCORE_DRAW;
+    }
+
+    uint8_t flag = TT_FLAG_EXACT;
+    nodeReason = RECORD_EXACT;
+    if(bestScore <= originalAlpha){
+        flag = TT_FLAG_UPPER;
+        nodeReason = RECORD_FAIL_LOW;
+    } else if(bestScore >= beta){
+        flag = TT_FLAG_LOWER;
+        nodeReason = RECORD_FAIL_HIGH;
+    }
+    // with moves excluded the root result is not the one of the position
+    if(ply == 0 && excludedRootCount > 0){
+        return bestScore;
+    }
+
+    uint16_t storedMove = flag == TT_FLAG_UPPER ? (uint16_t)TT_NO_MOVE : \
+            nodeBestMove.packed();
+    int storedScore = scoreToTable(bestScore, ply);
+    transpositionTable->store(hashKey, depth, storedScore, flag, storedMove);
+    if(learningFile != nullptr){
+        learningFile->store(hashKey, depth, storedScore, flag, storedMove);
+    }
+
+    return bestScore;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::searchAborted()
+{
+    return timeUp || stopRequested.load(std::memory_order_relaxed);
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::storeKiller(int ply, Move move)
+{
+    if(killerMoves[ply][0].equals(move)){
+        return;
+    }
+
+    // newest killer first, the older one is kept as second
+    for(uint8_t i = KILLER_MOVE_NUM - 1; i > 0; i--){
+        killerMoves[ply][i] = killerMoves[ply][i - 1];
+    }
+    killerMoves[ply][0] = move;
+}
+
@@ -0,0 +1,316 @@
+/*
+ * ChessEngine Class - board state, move generation and search without GUI
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef CHESSENGINE_H
+#define CHESSENGINE_H
+
+#include "chesspiece.h"
+#include "endgame.h"
+#include "evalparams.h"
+#include "learning.h"
+#include "recorder.h"
+#include "stack.h"
+#include "move.h"
+#include "movegen.h"
+#include "searchparams.h"
+#include "transposition.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+/*---------------------------------------------------------------------------*/
+#define TOTAL_PIECE_NUM   32
+#define MAX_POSSIBLE_MOVE 27 // queen has 27(biggest) legal move
+#define BOARD_MATRIX_SIZE 8  // same row & column
+#define INVERTING_OFFSET  (BOARD_MATRIX_SIZE - 1)
+
+// 103: P-(8*4) + R-14 + K-8 + B-14 + Q-27 + K-8
+#define MAX_MOVES_EACH_TURN 103
+#define MAX_SEARCH_PLY      64
+#define KILLER_MOVE_NUM     2
+#define CACHED_SEARCH_PLY   1 // nodes up to this ply fill the move cache
+
+#define SCORE_INFINITE      1000000
+// mated at the root, one less per ply. above any rating
+#define SCORE_MATE          (SCORE_INFINITE - 1000)
+#define SCORE_MATE_BOUND    (SCORE_MATE - MAX_SEARCH_PLY) // mates beyond it
+#define SCORE_DRAW          0
+
+#define FIFTY_MOVE_PLIES    100
+#define KEY_HISTORY_SIZE    128 // power of two above FIFTY_MOVE_PLIES
+
+#define SAN_MAX_LENGTH 8 // "exd8=Q#" and the terminator
+#define FEN_MAX_LENGTH 75 // 64 boxes, 7 slashes, " w" and the terminator
+
+#define MULTIPV_MAX_LINES 16
+#define PV_MAX_LENGTH     32 // moves of a principal variation at most
+
+#define PACKED_CODE_SIDE_SHIFT 3
+#define PACKED_CODE_TYPE_MASK  0x7
+#define PACKED_NIBBLE_BITS     4
+#define PACKED_NIBBLE_MASK     0xF
+
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    int8_t index;
+    uint8_t pressure;
+} boardInfo_t;
+
+// 24 bytes, codes of the occupied boxes in a1 .. h8 order, two per byte
+// with the low nibble first. code is side << 3 | piece type
+typedef struct {
+    uint64_t occupancy; // a1 = bit 0 .. h8 = bit 63
+    uint8_t pieces[TOTAL_PIECE_NUM / 2];
+} packedBoard_t;
+
+typedef struct {
+    packedBoard_t board;
+    uint8_t side;
+    uint8_t reserved[7];
+} packedPosition_t;
+
+// one root move of a multi-pv search and the moves expected after it
+typedef struct {
+    uint8_t rank;  // 0 is the best line
+    uint8_t depth; // of the iteration it was found in
+    int score;     // relative to the side to move
+    uint8_t length;
+    Move moves[PV_MAX_LENGTH];
+} pvLine_t;
+
+typedef std::function<void(const pvLine_t &line)> pvReport_t;
+
+/*---------------------------------------------------------------------------*/
+class ChessEngine
+{
+public:
+    explicit ChessEngine(uint32_t ttSizeMb = TT_DEFAULT_SIZE_MB);
+    // searches into the table of another engine, which keeps owning it
+    explicit ChessEngine(TranspositionTable *sharedTable);
+    virtual ~ChessEngine();
+
+    void makeMove(Move move, bool turnSide = true);
+    void undoLastMove(bool turnSide = true);
+    // a move of the game, pawns reaching the last rank are promoted and
+    // the attack maps of the board are refreshed
+    void playMove(Move move, uint8_t promotionType = PIECE_QUEEN, \
+                  bool updateMaps = true);
+    // the legal moves by their from and to boxes, so the order does not
+    // depend on which piece slots the position was set up with
+    uint8_t getAllMoves(Move *moves);
+    bool isInCheck();
+    // the position was seen times before since the last capture or pawn
+    // move. moves before a set up or unpacked position are not known
+    bool isRepetition(uint8_t times = 1);
+    // threefold repetition or fifty moves without a capture or pawn move
+    bool isDrawByRule();
+    bool sideToMove();
+    Move getBestMove();
+    // nodes of the last search, quiescence ones included
+    uint64_t getNodeCount();
+    // best move of the position in the table, if it is legal here
+    bool getHashMove(Move *move);
+    uint64_t positionKey(); // zobrist key, side to move included
+    uint16_t getHalfmoveClock(); // plies since the last capture or pawn move
+    // the game before a position set up by unpacking, for the draw rules.
+    // keys are of the positions before each of the last count moves,
+    // oldest first, clock is the halfmove clock of the current position
+    void setRuleHistory(const uint64_t *keys, uint32_t count, \
+                        uint16_t clock);
+    // the keys of setRuleHistory a repetition can still reach back to, at
+    // most KEY_HISTORY_SIZE - 1, their count
+    uint32_t getRuleHistory(uint64_t *keys);
+
+    // standard algebraic notation of a legal move of the side to move,
+    // see san.cpp. castling and en passant are not in the rules yet
+    void moveToSan(Move move, char *san, uint8_t promotionType = PIECE_QUEEN);
+    // token without terminator, check and annotation marks are ignored.
+    // only pieces of the named type are tried, no full generation
+    bool sanToMove(const char *san, size_t length, Move *move, \
+                   uint8_t *promotionType);
+
+    // start position, move history is dropped
+    void resetPosition();
+    void packPosition(packedPosition_t *position);
+    bool unpackPosition(const packedPosition_t *position);
+    // placement and side fields only, castling and en passant are ignored
+    static bool fenToPosition(const char *fen, packedPosition_t *position);
+    static void positionToFen(const packedPosition_t *position, char *fen);
+    void clearTranspositionTable();
+    // deep results are also kept in the file and read back on table
+    // misses, an exact root result spares its iterations. the file is
+    // not owned, nullptr detaches it
+    void setLearningFile(LearningFile *file);
+    // the visited nodes up to the ply limit of the recorder are written
+    // to its file (see recorder.h). the recorder is not owned, the buffer
+    // of this engine is, nullptr flushes and detaches it
+    void setTreeRecorder(TreeRecorder *recorder);
+
+    // iterative deepening up to depth, the move is kept in bestMove. with
+    // a time limit the deeper iterations are cut when it runs out, the
+    // first one is always finished so there is a move
+    int search(int depth, uint32_t timeLimitMs = 0);
+    // may be called from another thread. while set, search returns with
+    // the move of the last finished iteration, nothing is stored for the
+    // unfinished one. it stays set until it is cleared
+    void stopSearch(bool stop = true);
+    // the best lineCount root moves and their variations, see multipv.cpp.
+    // each iteration searches the root once per line with the moves of
+    // the lines before it excluded, the passes share the table and the
+    // move order. report gets each line as soon as its pass is done,
+    // lines keeps the ones of the last finished iteration, best first.
+    // with searchMoves only those root moves (Move::packed()) are searched
+    uint8_t searchMultiPv(int depth, uint8_t lineCount, pvLine_t *lines, \
+                          const pvReport_t &report = pvReport_t(), \
+                          uint32_t timeLimitMs = 0, \
+                          const uint16_t *searchMoves = nullptr, \
+                          uint8_t searchMoveCount = 0);
+    // the root limited to move, every iteration with the null window just
+    // above bound. a score above bound means the move is better, for the
+    // younger brothers of a root split over several engines. the depth
+    // of the last finished iteration goes to completedDepth
+    int scoutRootMove(int depth, Move move, int bound, int *completedDepth, \
+                      uint32_t timeLimitMs = 0);
+    // moves of the line in SAN separated by spaces, may be called from
+    // the report
+    void lineToSan(const pvLine_t &line, char *text, size_t size);
+    // static evaluation in rating units, relative to the side to move.
+    // known endings are rated or scaled by their own rules (see endgame.h)
+    int getRating();
+    // the material is of a known ending, getRating applies its rules
+    bool isKnownEnding();
+    int materialRating();   // white relative
+    int positionalRating(); // white relative
+    // terms of the evaluation, getRating is their dot product with the
+    // weights. EVAL_PARAM_NUM entries, white relative
+    void evalFeatures(int16_t *features);
+    const EvalParams &getEvalParams();
+    void setEvalParams(const EvalParams &params);
+protected:
+    friend class MovePicker;
+
+    void initilizePieces();
+    void clearBoard();
+    void updatePressures(uint8_t (*pressures)[BOARD_MATRIX_SIZE] = nullptr);
+    bool checkKingPressure(Move *move);
+    bool isSquareAttacked(uint8_t x, uint8_t y, bool side);
+    // boxes of the king and around it attacked by side, of this node
+    uint8_t kingZoneAttacks(ChessPiece &king, bool side);
+    // static exchange evaluation, material result of the capture sequence
+    int staticExchange(Move *move);
+    int8_t leastValuableAttacker(uint8_t x, uint8_t y, bool side, \
+                                 uint64_t removed);
+    bool hasNonPawnMaterial();
+    // white relative rating of a known ending
+    int endgameRating(const endgameEntry_t &endgame);
+    // in 64ths, ENDGAME_SCALE_NORMAL keeps the usual evaluation
+    int endgameScale(const endgameEntry_t &endgame);
+    // the first one on board, nullptr if there is none
+    ChessPiece *findPiece(bool side, uint8_t type);
+    // the piece could move to the box, own king safety is not checked
+    bool canReach(ChessPiece &piece, uint8_t x, uint8_t y);
+    // fill their own ranges of the feature vector
+    void materialFeatures(int16_t *features);
+    void positionalFeatures(int16_t *features);
+    // moving functions
+    uint8_t prepareLegalMoves(ChessPiece piece, Move *moves);
+    // all the legal moves of the position (Move::packed()) go to the move
+    // cache, sorted in place. a complete list from a search node will do
+    void cacheLegalMoves(uint16_t *moves, uint8_t count);
+    uint8_t preparePseudoMoves(ChessPiece piece, Move *moves, \
+                               uint8_t genType = GEN_ALL);
+    uint8_t generateMoves(Move *moves, uint8_t genType);
+    void computeHashKeys();
+
+    // side and generation type are resolved at compile time, the runtime
+    // functions above only dispatch (see movegen.cpp)
+    template <bool Side, uint8_t GenType>
+    uint8_t generateSideMoves(Move *moves);
+    template <bool Side, uint8_t GenType>
+    uint8_t generatePieceMoves(ChessPiece &piece, Move *moves);
+    template <bool Side, uint8_t GenType, uint8_t FirstRay, uint8_t LastRay>
+    uint8_t generateSliderMoves(int8_t x, int8_t y, Move *moves);
+    template <bool Side, uint8_t GenType>
+    bool isTarget(int8_t index, int8_t x, int8_t y);
+    template <bool Side>
+    bool isSquareAttackedBy(int8_t x, int8_t y);
+    template <bool Side>
+    void computeEvasionTargets();
+    template <bool Side>
+    void makeSideMove(Move &move, bool turnSide);
+
+    // search functions
+    void beginSearch(uint32_t timeLimitMs);
+    int aspirationSearch(int depth, int previousScore);
+    int quiescence(int ply, int alpha, int beta);
+    int minimax(int depth, int ply, int alpha, int beta, \
+                bool allowNull = true);
+    // the body of minimax, nodeReason tells how it returned
+    int searchNode(int depth, int ply, int alpha, int beta, bool allowNull);
+    int recordNode(int depth, int ply, int alpha, int beta, bool allowNull);
+    void storeKiller(int ply, Move move);
+    bool searchAborted();
+    // the legal move of the position packed as Move::packed()
+    bool findLegalMove(uint16_t packed, Move *move);
+    // the root move and the table moves after it, as far as they are legal
+    void extractLine(Move first, int depth, pvLine_t *line);
+    bool isExcludedRootMove(uint16_t packed);
+
+
+    Stack<Move> *movePool;
+    ChessPiece chessPieces[TOTAL_PIECE_NUM]; // piece properties
+    // holds the indexes in chessPieces array
+    boardInfo_t boardInfo[BOARD_MATRIX_SIZE][BOARD_MATRIX_SIZE];
+
+    // holds the best move in minimax search
+    Move bestMove;
+    SearchParams searchParams;
+    EvalParams evalParams;
+    TranspositionTable *transpositionTable;
+    bool ownsTable;
+    LearningFile *learningFile;
+    RecordWriter *recordWriter;
+    uint8_t nodeReason; // RECORD_*
+    std::atomic<bool> stopRequested;
+
+    // time limit of the running search
+    bool timeLimited;
+    bool timeUp;
+    uint32_t timeCheckNodes;
+    uint64_t nodeCount;
+    std::chrono::steady_clock::time_point searchDeadline;
+    Move killerMoves[MAX_SEARCH_PLY][KILLER_MOVE_NUM];
+    // legal moves of the shallow nodes, kept out of the search frames
+    uint16_t seenMoves[CACHED_SEARCH_PLY + 1][MAX_MOVES_EACH_TURN];
+
+    // root moves not asked for and the lines already found in a multi-pv
+    // pass
+    uint16_t excludedRootMoves[MAX_MOVES_EACH_TURN];
+    uint8_t excludedRootCount;
+
+    // zobrist keys of the current position, kept up to date in makeMove
+    uint64_t hashKey;
+    uint64_t pawnHashKey; // pawns only, indexes the pawn hash table
+    uint64_t materialKey; // piece counts, picks the endgame evaluation
+
+    // keys before the moves of the pool, the last ones in a ring indexed
+    // by the number of moves played. a repetition is looked for in the
+    // plies of the clock, the ring holds the ones of the fifty move rule
+    uint64_t keyHistory[KEY_HISTORY_SIZE];
+    uint32_t historyCount;
+    uint16_t halfmoveClock; // plies since the last capture or pawn move
+
+    // boxes which capture or block the checker, set for GEN_EVASIONS
+    uint64_t evasionTargets;
+
+    bool movementSide;
+
+    // for easy access
+    uint8_t whiteKingIndex;
+    uint8_t blackKingIndex;
+};
+
+#endif // CHESSENGINE_H
@@ -6,10 +6,17 @@
 #include "chessgui.h"
 #include "ui_chessgui.h"
 
+#include <QDate>
 #include <QDesktopWidget>
+#include <QFileDialog>
+#include <QMessageBox>
 #include <QSizePolicy>
 #include <QStyle>
 
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
 /*---------------------------------------------------------------------------*/
 ChessGui::ChessGui(QWidget *parent)
     : QWidget(parent)
@@ -27,12 +34,26 @@ ChessGui::ChessGui(QWidget *parent)
 
     chessBoard = new ChessBoard(this);
 
-    ui->notationTable->setRowCount(0);
-    ui->notationTable->setColumnCount(2);
-    ui->notationTable->setHorizontalHeaderItem(0, \
-                                               new QTableWidgetItem("White"));
-    ui->notationTable->setHorizontalHeaderItem(1, \
-                                               new QTableWidgetItem("Black"));
+    history.reset(chessBoard);
+    ui->notationTable->setModel(&history);
+
+    gameRecord.setTag("Event", "AI Chess game");
+    gameRecord.setTag("Date", QDate::currentDate().toString("yyyy.MM.dd")\
+                      .toStdString().c_str());
+    gameRecord.setTag("White", "Player");
+    gameRecord.setTag("Black", "AI Chess");
+
+    ui->explorerTable->setRowCount(0);
+    ui->explorerTable->setColumnCount(3);
+    ui->explorerTable->setHorizontalHeaderItem(0, \
+                                               new QTableWidgetItem("Move"));
+    ui->explorerTable->setHorizontalHeaderItem(1, \
+                                               new QTableWidgetItem("Games"));
+    ui->explorerTable->setHorizontalHeaderItem(2, \
+                                               new QTableWidgetItem("Score"));
+
+    explorer.open(getenv(EXPLORER_INDEX_ENV));
+    updateExplorer();
 }
 
 /*---------------------------------------------------------------------------*/
@@ -43,27 +64,116 @@ ChessGui::~ChessGui()
 }
 
 /*---------------------------------------------------------------------------*/
-void ChessGui::setNotation(QString notation, bool side)
+void ChessGui::addMove(Move move, uint8_t promotionType, QString notation)
 {
-    if(side == SIDE_WHITE){
-        int row = ui->notationTable->rowCount();
-        ui->notationTable->setRowCount(row + 1);
-        QTableWidgetItem *item = new QTableWidgetItem(notation);
-        ui->notationTable->setItem(row, 0, item);
-    } else{
-        QTableWidgetItem *item = new QTableWidgetItem(notation);
-        ui->notationTable->setItem(ui->notationTable->rowCount() - 1, 1, \
-                                   item);
-    }
+    truncateRecord(history.currentPly());
+    gameRecord.addMove(notation.toStdString().c_str());
+    history.addMove(move, promotionType, notation.toStdString().c_str(), \
+                    chessBoard);
 
     ui->notationTable->scrollToBottom();
+    updateExplorer();
 }
 
 /*---------------------------------------------------------------------------*/
 void ChessGui::on_undoButton_clicked()
 {
-    chessBoard->undoLastMove(); // black
-    chessBoard->undoLastMove(); // white
-    chessBoard->repaint();
-    ui->notationTable->removeRow(ui->notationTable->rowCount() - 1);
+    // back to the last position of the shown ply with white to move
+    int ply = history.currentPly();
+    ply = std::max(ply - (ply % 2 == 0 ? 2 : 1), 0);
+
+    history.truncate(ply);
+    truncateRecord(ply);
+    chessBoard->showPly(&history, ply);
+    updateExplorer();
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessGui::on_notationTable_clicked(const QModelIndex &index)
+{
+    int ply = history.plyOf(index);
+    if(ply < 0){
+        return;
+    }
+
+    chessBoard->showPly(&history, ply);
+    updateExplorer();
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessGui::truncateRecord(int ply)
+{
+    if(gameRecord.moveCount() <= (size_t)ply){
+        return;
+    }
+
+    while(gameRecord.moveCount() > (size_t)ply){
+        gameRecord.removeLastMove();
+    }
+    gameRecord.setResult(PGN_RESULT_UNKNOWN);
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessGui::setResult(int8_t result)
+{
+    gameRecord.setResult(result);
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessGui::on_exportButton_clicked()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Export PGN", "", \
+                                                "PGN files (*.pgn)");
+    if(path.isEmpty()){
+        return;
+    }
+
+    PgnWriter writer;
+    if(!writer.open(path.toStdString().c_str()) || \
+       !writer.write(gameRecord)){
+        QMessageBox::warning(this, "Export PGN", \
+                             "The file can not be written.");
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessGui::updateExplorer()
+{
+    ui->explorerTable->setRowCount(0);
+    if(!explorer.isOpen()){
+        return;
+    }
+
+    const explorerEntry_t *found;
+    size_t count = explorer.lookup(chessBoard->positionKey(), &found);
+
+    // most played first
+    std::vector<explorerEntry_t> entries(found, found + count);
+    std::sort(entries.begin(), entries.end(), \
+              [](const explorerEntry_t &a, const explorerEntry_t &b){
+        return a.white + a.draws + a.black > b.white + b.draws + b.black;
+    });
+    count = std::min<size_t>(count, EXPLORER_MAX_RESULTS);
+
+    ui->explorerTable->setRowCount(count);
+    for(size_t i = 0; i < count; i++){
+        Move move;
+        move.setPacked(entries[i].move & EXPLORER_MOVE_MASK);
+        char san[SAN_MAX_LENGTH];
+        chessBoard->moveToSan(move, san, \
+                              entries[i].move >> EXPLORER_PROMOTION_SHIFT);
+
+        // score of the side to move, draws are half a point
+        uint32_t total = entries[i].white + entries[i].draws + \
+                entries[i].black;
+        uint32_t wins = chessBoard->sideToMove() == SIDE_WHITE ? \
+                entries[i].white : entries[i].black;
+        double score = 100.0 * (wins + entries[i].draws / 2.0) / total;
+
+        ui->explorerTable->setItem(i, 0, new QTableWidgetItem(san));
+        ui->explorerTable->setItem(i, 1, \
+                new QTableWidgetItem(QString::number(total)));
+        ui->explorerTable->setItem(i, 2, \
+                new QTableWidgetItem(QString::number(score, 'f', 1) + "%"));
+    }
 }
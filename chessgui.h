@@ -7,6 +7,9 @@
 #define CHESSGUI_H
 
 #include "chessboard.h"
+#include "explorer.h"
+#include "gamehistory.h"
+#include "pgn.h"
 
 #include <QWidget>
 
@@ -27,13 +30,24 @@ class ChessGui : public QWidget
 public:
     ChessGui(QWidget *parent = nullptr);
     ~ChessGui();
-    void setNotation(QString notation, bool side);
+    // played on the board in the shown ply, the plies after it are dropped
+    void addMove(Move move, uint8_t promotionType, QString notation);
+    void setResult(int8_t result);
 
 private slots:
     void on_undoButton_clicked();
+    void on_exportButton_clicked();
+    void on_notationTable_clicked(const QModelIndex &index);
 
 private:
+    void updateExplorer();
+    // the moves of the export after ply are dropped
+    void truncateRecord(int ply);
+
     Ui::ChessGui *ui;
     ChessBoard *chessBoard;
+    GameHistory history;    // model of the notation table
+    PgnRecorder gameRecord; // moves of the table, for the export
+    ExplorerIndex explorer; // opened from EXPLORER_INDEX_ENV, if it is set
 };
 #endif // CHESSGUI_H
@@ -39,6 +39,8 @@
 #define PIECE_POINT_QUEEN  9
 #define PIECE_POINT_KING   50
 
+#define PIECE_POINT_SCALE  100 // rating units for one point
+
 /*---------------------------------------------------------------------------*/
 #define SIDE_BLACK false
 #define SIDE_WHITE true
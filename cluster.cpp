@@ -0,0 +1,571 @@
+/*
+ * Cluster Search - root moves split over game server processes
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "cluster.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*---------------------------------------------------------------------------*/
+#define CLUSTER_TT_SIZE_MB 1 // the engine only generates moves
+#define CLUSTER_READ_SIZE  4096
+
+/*---------------------------------------------------------------------------*/
+static uint32_t elapsedSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(\
+                std::chrono::steady_clock::now() - start).count();
+}
+
+/*---------------------------------------------------------------------------*/
+ClusterSearch::ClusterSearch(unsigned slowFactor)
+    : engine(CLUSTER_TT_SIZE_MB)
+{
+    fen[0] = '\0';
+    depth = 0;
+    alpha = -SCORE_INFINITE;
+    this->slowFactor = slowFactor;
+    doneCount = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+ClusterSearch::~ClusterSearch()
+{
+    // the servers throw the results of running searches away
+    for(size_t i = 0; i < workers.size(); i++){
+        if(workers[i].fd >= 0){
+            close(workers[i].fd);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+unsigned ClusterSearch::connectWorkers(\
+        const std::vector<std::string> &addresses)
+{
+    for(size_t i = 0; i < addresses.size(); i++){
+        clusterWorker_t worker;
+        worker.address = addresses[i];
+        worker.fd = -1;
+        worker.session = 0;
+        worker.task = -1;
+        worker.generation = 0;
+        worker.scouting = false;
+        worker.lastDepth = 0;
+        worker.lastScore = 0;
+
+        if(connectWorker(&worker)){
+            workers.push_back(worker);
+        } else{
+            fprintf(stderr, "%s is not reachable\n", addresses[i].c_str());
+        }
+    }
+
+    return workers.size();
+}
+
+/*---------------------------------------------------------------------------*/
+bool ClusterSearch::connectWorker(clusterWorker_t *worker)
+{
+    size_t colon = worker->address.rfind(':');
+    if(colon == std::string::npos){
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if(worker->address.size() >= sizeof(address.sun_path)){
+            return false;
+        }
+        strcpy(address.sun_path, worker->address.c_str());
+
+        worker->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(worker->fd < 0 || connect(worker->fd, (sockaddr *)&address, \
+                                     sizeof(address)) != 0){
+            return false;
+        }
+    } else{
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(atoi(worker->address.c_str() + colon + 1));
+        std::string host = worker->address.substr(0, colon);
+        if(inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1){
+            return false;
+        }
+
+        worker->fd = socket(AF_INET, SOCK_STREAM, 0);
+        if(worker->fd < 0 || connect(worker->fd, (sockaddr *)&address, \
+                                     sizeof(address)) != 0){
+            return false;
+        }
+    }
+
+    // the one session of the worker, all root moves are searched in it.
+    // nothing cuts its searches, a shallower answer is of no use
+    std::string line;
+    if(!sendLine(worker, "new unlimited") || !readLine(worker, &line) || \
+       line.compare(0, 8, "session ") != 0){
+        close(worker->fd);
+        worker->fd = -1;
+        return false;
+    }
+    worker->session = strtoul(line.c_str() + 8, nullptr, 10);
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ClusterSearch::sendLine(clusterWorker_t *worker, const std::string &line)
+{
+    std::string text = line + "\n";
+    size_t sent = 0;
+    while(sent < text.size()){
+        ssize_t length = write(worker->fd, text.data() + sent, \
+                               text.size() - sent);
+        if(length < 0 && errno == EINTR){
+            continue;
+        } else if(length <= 0){
+            return false;
+        }
+        sent += length;
+    }
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ClusterSearch::readLine(clusterWorker_t *worker, std::string *line)
+{
+    size_t end;
+    while((end = worker->input.find('\n')) == std::string::npos){
+        char buffer[CLUSTER_READ_SIZE];
+        ssize_t length = read(worker->fd, buffer, sizeof(buffer));
+        if(length < 0 && errno == EINTR){
+            continue;
+        } else if(length <= 0){
+            return false;
+        }
+        worker->input.append(buffer, length);
+    }
+
+    *line = worker->input.substr(0, end);
+    worker->input.erase(0, end + 1);
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ClusterSearch::search(const packedPosition_t *position, int depth, \
+                           clusterTask_t *best)
+{
+    if(depth < 1 || !engine.unpackPosition(position)){
+        return false;
+    }
+
+    ChessEngine::positionToFen(position, fen);
+    this->depth = depth;
+    alpha = -SCORE_INFINITE;
+    doneCount = 0;
+    doneMs.clear();
+    tasks.clear();
+
+    // the best lines of a shallow search first, the others after them in
+    // generation order. the first move should be the best one, it is the
+    // only one searched alone
+    Move moves[MAX_MOVES_EACH_TURN];
+    uint8_t count = engine.getAllMoves(moves);
+    pvLine_t lines[MULTIPV_MAX_LINES];
+    uint8_t lineCount = engine.searchMultiPv(std::min(depth, \
+                                                      CLUSTER_ORDER_DEPTH), \
+                                             MULTIPV_MAX_LINES, lines, \
+                                             pvReport_t());
+    for(uint8_t i = 0; i < lineCount; i++){
+        Move *found = std::find_if(moves + i, moves + count, \
+                                   [&](const Move &move){
+            return move.packed() == lines[i].moves[0].packed();
+        });
+        if(found != moves + count){
+            std::rotate(moves + i, found, found + 1);
+        }
+    }
+
+    for(uint8_t i = 0; i < count; i++){
+        clusterTask_t task;
+        task.move = moves[i];
+        engine.moveToSan(moves[i], task.san);
+        task.state = CLUSTER_TASK_PENDING;
+        task.full = i == 0;
+        task.exact = false;
+        task.bound = 0;
+        task.runners = 0;
+        task.generation = 0;
+        task.score = -SCORE_INFINITE;
+        task.depth = 0;
+        task.elapsedMs = 0;
+        task.line = task.san;
+        tasks.push_back(task);
+    }
+
+    while(doneCount < tasks.size()){
+        assignTasks();
+
+        std::vector<pollfd> fds;
+        std::vector<unsigned> owners;
+        for(unsigned i = 0; i < workers.size(); i++){
+            if(workers[i].fd >= 0 && \
+               (workers[i].task >= 0 || workers[i].session == 0)){
+                fds.push_back({ workers[i].fd, POLLIN, 0 });
+                owners.push_back(i);
+            }
+        }
+        if(fds.empty()){
+            fprintf(stderr, "no worker is left\n");
+            return false;
+        }
+
+        if(poll(fds.data(), fds.size(), CLUSTER_POLL_MS) < 0 && \
+           errno != EINTR){
+            perror("poll");
+            return false;
+        }
+        for(size_t i = 0; i < fds.size(); i++){
+            if(fds[i].revents != 0 && !readWorker(owners[i])){
+                dropWorker(owners[i]);
+            }
+        }
+    }
+
+    // a helper may still search a reassigned move. its session is closed,
+    // the server throws the result, and the next search gets a new one
+    for(unsigned i = 0; i < workers.size(); i++){
+        clusterWorker_t &worker = workers[i];
+        if(worker.fd >= 0 && worker.task >= 0){
+            worker.task = -1;
+            if(!sendLine(&worker, "close " + \
+                         std::to_string(worker.session)) || \
+               !sendLine(&worker, "new unlimited")){
+                dropWorker(i);
+            }
+            worker.session = 0;
+        }
+    }
+
+    // the first of equal scores, the moves are in search order. the first
+    // move is always exact, bounds are never above alpha
+    size_t bestIndex = 0;
+    for(size_t i = 1; i < tasks.size(); i++){
+        if(tasks[i].exact && tasks[i].score > tasks[bestIndex].score){
+            bestIndex = i;
+        }
+    }
+    if(!tasks.empty()){
+        *best = tasks[bestIndex];
+    }
+
+    return !tasks.empty();
+}
+
+/*---------------------------------------------------------------------------*/
+const std::vector<clusterTask_t> &ClusterSearch::getTasks() const
+{
+    return tasks;
+}
+
+/*---------------------------------------------------------------------------*/
+void ClusterSearch::assignTasks()
+{
+    for(unsigned i = 0; i < workers.size(); i++){
+        clusterWorker_t &worker = workers[i];
+        if(worker.fd < 0 || worker.task >= 0 || worker.session == 0){
+            continue;
+        }
+
+        int task = pickTask(i);
+        if(task < 0){
+            return; // the other idle workers would not find one either
+        }
+
+        // a new scout is against the latest alpha, a helper takes the
+        // bound of the search it helps
+        clusterTask_t &current = tasks[task];
+        if(current.state == CLUSTER_TASK_PENDING && !current.full){
+            current.bound = alpha;
+        }
+
+        // the position is set for each task, a worker may join late
+        std::string session = std::to_string(worker.session);
+        std::string search = current.full ? \
+                "analyze " + session + " " + std::to_string(depth) + " 1 " : \
+                "scout " + session + " " + std::to_string(depth) + " " + \
+                std::to_string(current.bound) + " ";
+        if(!sendLine(&worker, "position " + session + " " + fen) || \
+           !sendLine(&worker, search + current.san)){
+            dropWorker(i);
+            continue;
+        }
+
+        worker.task = task;
+        worker.generation = current.generation;
+        worker.scouting = !current.full;
+        worker.started = std::chrono::steady_clock::now();
+        worker.lastDepth = 0;
+        worker.lastScore = 0;
+        worker.lastLine.clear();
+        tasks[task].state = CLUSTER_TASK_RUNNING;
+        tasks[task].runners++;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+int ClusterSearch::pickTask(unsigned worker)
+{
+    // the others wait for alpha, the score of the first move
+    for(size_t i = 0; i < tasks.size(); i++){
+        if(tasks[i].state == CLUSTER_TASK_PENDING && \
+           (i == 0 || tasks[0].state == CLUSTER_TASK_DONE)){
+            return i;
+        }
+    }
+
+    // nothing left, help the slowest move which nobody else helps yet
+    uint32_t limit = medianMs() * slowFactor;
+    int slowest = -1;
+    unsigned slowWorker = worker;
+    uint32_t slowestMs = 0;
+    for(unsigned i = 0; i < workers.size(); i++){
+        const clusterWorker_t &other = workers[i];
+        if(i == worker || other.fd < 0 || other.task < 0 || \
+           other.generation != tasks[other.task].generation || \
+           tasks[other.task].state != CLUSTER_TASK_RUNNING || \
+           tasks[other.task].runners > 1){
+            continue;
+        }
+
+        uint32_t elapsed = elapsedSince(other.started);
+        if(!doneMs.empty() && elapsed > limit && elapsed > slowestMs){
+            slowest = other.task;
+            slowWorker = i;
+            slowestMs = elapsed;
+        }
+    }
+
+    if(slowest >= 0){
+        fprintf(stderr, "%s is slow on %s, %s helps\n", \
+                workers[slowWorker].address.c_str(), tasks[slowest].san, \
+                workers[worker].address.c_str());
+    }
+    return slowest;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ClusterSearch::readWorker(unsigned worker)
+{
+    clusterWorker_t &current = workers[worker];
+    char buffer[CLUSTER_READ_SIZE];
+    ssize_t length = read(current.fd, buffer, sizeof(buffer));
+    if(length <= 0){
+        return length < 0 && errno == EINTR;
+    }
+    current.input.append(buffer, length);
+
+    size_t end;
+    while(workers[worker].fd >= 0 && \
+          (end = workers[worker].input.find('\n')) != std::string::npos){
+        std::string line = workers[worker].input.substr(0, end);
+        workers[worker].input.erase(0, end + 1);
+        handleLine(worker, line);
+    }
+
+    return workers[worker].fd < 0 || \
+            workers[worker].input.size() <= CLUSTER_MAX_INPUT;
+}
+
+/*---------------------------------------------------------------------------*/
+void ClusterSearch::handleLine(unsigned worker, const std::string &line)
+{
+    clusterWorker_t &current = workers[worker];
+    size_t space = line.find(' ');
+    std::string reply = line.substr(0, space);
+    char *cursor = nullptr;
+    uint32_t session = space == std::string::npos ? 0 : \
+            strtoul(line.c_str() + space, &cursor, 10);
+
+    if(reply == "session"){
+        current.session = session;
+        return;
+    } else if(reply == "ok" || \
+              ((reply == "pv" || reply == "done" || reply == "scout") && \
+               (session != current.session || current.task < 0))){
+        return; // of a session closed after a search
+    } else if(reply == "pv"){
+        // "pv <id> <depth> <rank> <score> <san>...", the deeper iterations
+        // come later
+        current.lastDepth = strtol(cursor, &cursor, 10);
+        strtol(cursor, &cursor, 10);
+        current.lastScore = strtol(cursor, &cursor, 10);
+        current.lastLine = cursor + strspn(cursor, " ");
+    } else if(reply == "done"){
+        finishTask(worker, current.lastDepth >= depth);
+    } else if(reply == "scout"){
+        // "scout <id> <depth> <score> <ms>"
+        current.lastDepth = strtol(cursor, &cursor, 10);
+        current.lastScore = strtol(cursor, &cursor, 10);
+        current.lastLine = tasks[current.task].san;
+        finishTask(worker, current.lastDepth >= depth);
+    } else{
+        fprintf(stderr, "%s: %s\n", current.address.c_str(), line.c_str());
+        dropWorker(worker);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void ClusterSearch::finishTask(unsigned worker, bool succeeded)
+{
+    clusterWorker_t &current = workers[worker];
+    clusterTask_t &task = tasks[current.task];
+    current.task = -1;
+
+    // the answer of an older search of the move is thrown
+    if(current.generation != task.generation){
+        return;
+    }
+
+    // so is the second answer of a reassigned move
+    task.runners--;
+    if(task.state == CLUSTER_TASK_DONE){
+        return;
+    } else if(!succeeded){
+        if(task.runners == 0){
+            task.state = CLUSTER_TASK_PENDING;
+        }
+        return;
+    }
+
+    // above the bound the move may be better. against the latest alpha
+    // it is searched with a full window, against an older one it is
+    // scouted again
+    if(current.scouting && current.lastScore > task.bound){
+        fprintf(stderr, "%s fails high on %d\n", task.san, task.bound);
+        task.full = task.bound == alpha;
+        task.state = CLUSTER_TASK_PENDING;
+        task.runners = 0;
+        task.generation++;
+        return;
+    }
+
+    task.state = CLUSTER_TASK_DONE;
+    task.exact = !current.scouting;
+    task.score = current.lastScore;
+    task.depth = current.lastDepth;
+    task.elapsedMs = elapsedSince(current.started);
+    task.line = current.lastLine;
+    doneMs.push_back(task.elapsedMs);
+    doneCount++;
+    if(task.exact){
+        alpha = std::max(alpha, task.score);
+    }
+
+    printf("move %s %s %d %d %u %s %s\n", task.san, \
+           task.exact ? "exact" : "upper", task.score, task.depth, \
+           task.elapsedMs, current.address.c_str(), task.line.c_str());
+    fflush(stdout);
+}
+
+/*---------------------------------------------------------------------------*/
+void ClusterSearch::dropWorker(unsigned worker)
+{
+    clusterWorker_t &current = workers[worker];
+    if(current.fd < 0){
+        return;
+    }
+
+    fprintf(stderr, "%s is dropped\n", current.address.c_str());
+    if(current.task >= 0){
+        finishTask(worker, false);
+    }
+    close(current.fd);
+    current.fd = -1;
+}
+
+/*---------------------------------------------------------------------------*/
+uint32_t ClusterSearch::medianMs()
+{
+    if(doneMs.empty()){
+        return 0;
+    }
+
+    std::vector<uint32_t> sorted(doneMs);
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, \
+                     sorted.end());
+    return sorted[sorted.size() / 2];
+}
+
+/*---------------------------------------------------------------------------*/
+int clusterMain(int argc, char *argv[])
+{
+    int depth = CLUSTER_DEFAULT_DEPTH;
+    unsigned slowFactor = CLUSTER_DEFAULT_SLOW_FACTOR;
+    std::vector<std::string> addresses;
+    const char *fen = nullptr;
+
+    for(int i = 1; i < argc; i++){
+        bool hasValue = i + 1 < argc;
+        if(strcmp(argv[i], "-d") == 0 && hasValue){
+            depth = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-r") == 0 && hasValue){
+            slowFactor = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-w") == 0 && hasValue){
+            addresses.push_back(argv[++i]);
+        } else if(fen == nullptr && argv[i][0] != '-'){
+            fen = argv[i];
+        } else{
+            fen = nullptr;
+            break;
+        }
+    }
+
+    if(fen == nullptr || addresses.empty() || depth < 1){
+        fprintf(stderr, "usage: cluster [-d depth] [-r slowFactor] "
+                        "-w address [-w address]... fen|startpos\n");
+        return 1;
+    }
+
+    ChessEngine start(CLUSTER_TT_SIZE_MB);
+    packedPosition_t position;
+    start.packPosition(&position);
+    if(strcmp(fen, "startpos") != 0 && \
+       !ChessEngine::fenToPosition(fen, &position)){
+        fprintf(stderr, "invalid position\n");
+        return 1;
+    }
+
+    // a worker gone while a line is sent is only an error code
+    signal(SIGPIPE, SIG_IGN);
+
+    ClusterSearch cluster(slowFactor);
+    if(cluster.connectWorkers(addresses) == 0){
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point begin = \
+            std::chrono::steady_clock::now();
+    clusterTask_t best;
+    if(!cluster.search(&position, depth, &best)){
+        return 1;
+    }
+
+    printf("bestmove %s %d %u %s\n", best.san, best.score, \
+           elapsedSince(begin), best.line.c_str());
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * Cluster Search - root moves split over game server processes
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include "chessengine.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+#define CLUSTER_DEFAULT_DEPTH       9
+#define CLUSTER_DEFAULT_SLOW_FACTOR 3   // of the median time of a root move
+#define CLUSTER_POLL_MS             100 // slow workers are looked for so often
+#define CLUSTER_ORDER_DEPTH         3   // of the search ordering the root moves
+#define CLUSTER_MAX_INPUT           (1 << 16) // of a worker, without newline
+
+#define CLUSTER_TASK_PENDING 0
+#define CLUSTER_TASK_RUNNING 1
+#define CLUSTER_TASK_DONE    2
+
+/*---------------------------------------------------------------------------*/
+// one root move, the only one a worker searches at the root. the child
+// is not searched on its own, the history of the root stays with it
+typedef struct {
+    Move move;
+    char san[SAN_MAX_LENGTH];
+    uint8_t state;
+    bool full;         // searched with a full window, else scouted
+    bool exact;        // score of a full search, else an upper bound
+    int bound;         // of the scout
+    unsigned runners;  // workers searching it, two once it is reassigned
+    unsigned generation; // counts the searches, older answers are thrown
+    int score;         // relative to the side to move at the root
+    int depth;         // reached
+    uint32_t elapsedMs;
+    std::string line;  // principal variation in SAN, the root move first
+} clusterTask_t;
+
+typedef struct {
+    std::string address; // "host:port" or a unix socket path
+    int fd;              // -1 once it is gone
+    uint32_t session;
+    int task;            // index of the searched root move, -1 if idle
+    unsigned generation; // of the task when it was given
+    bool scouting;
+    std::chrono::steady_clock::time_point started;
+    // last "pv" or "scout" reply of the running task, the one of the
+    // deepest iteration
+    int lastDepth;
+    int lastScore;
+    std::string lastLine;
+    std::string input;
+} clusterWorker_t;
+
+/*---------------------------------------------------------------------------*/
+// the coordinator of a distributed search, young brothers wait: the root
+// moves are ordered by a shallow search and the first one is searched with
+// a full window by a game server ("server", see server.h), as an analysis
+// of the root limited to that move. its score is alpha, the other moves
+// are then scouted in parallel with a null window at alpha. a move which
+// scores above it is searched again with a full window and may raise
+// alpha, the best exact score wins. idle workers take over moves which
+// run much longer than the others, the first answer is kept. moves of a
+// worker which fails, or which answers below the depth, are given to the
+// next idle one
+class ClusterSearch
+{
+public:
+    explicit ClusterSearch(unsigned slowFactor = CLUSTER_DEFAULT_SLOW_FACTOR);
+    ~ClusterSearch();
+
+    // a session is opened on each, the reachable ones are kept
+    unsigned connectWorkers(const std::vector<std::string> &addresses);
+    // results of the root moves are printed as they come, false if no
+    // worker is left
+    bool search(const packedPosition_t *position, int depth, \
+                clusterTask_t *best);
+    const std::vector<clusterTask_t> &getTasks() const;
+private:
+    bool connectWorker(clusterWorker_t *worker);
+    bool sendLine(clusterWorker_t *worker, const std::string &line);
+    bool readLine(clusterWorker_t *worker, std::string *line);
+    void assignTasks();
+    int pickTask(unsigned worker);
+    bool readWorker(unsigned worker);
+    void handleLine(unsigned worker, const std::string &line);
+    void finishTask(unsigned worker, bool succeeded);
+    void dropWorker(unsigned worker);
+    uint32_t medianMs();
+
+    ChessEngine engine; // root moves, their notation and order
+    char fen[FEN_MAX_LENGTH];
+    int depth;
+    int alpha; // best exact score so far
+    unsigned slowFactor;
+    unsigned doneCount;
+    std::vector<uint32_t> doneMs;
+    std::vector<clusterTask_t> tasks;
+    std::vector<clusterWorker_t> workers;
+};
+
+/*---------------------------------------------------------------------------*/
+// "cluster [-d depth] [-r slowFactor] -w address [-w address]...
+// fen|startpos", an address is "host:port" or a unix socket path
+int clusterMain(int argc, char *argv[]);
+
+#endif // CLUSTER_H
@@ -0,0 +1,229 @@
+/*
+ * Endgame Table - specialised evaluations picked by the material on board
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "endgame.h"
+#include "chessengine.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+/*---------------------------------------------------------------------------*/
+#define ENDGAME_MAX_PAWNS 8
+
+/*---------------------------------------------------------------------------*/
+const EndgameTable &endgameTable()
+{
+    static const EndgameTable table;
+    return table;
+}
+
+/*---------------------------------------------------------------------------*/
+EndgameTable::EndgameTable()
+{
+    memset(entries, 0, sizeof(entries));
+
+    // no mate can be forced, not even with the help of the other side in
+    // most of them
+    add("KK", ENDGAME_DRAW);
+    add("KBK", ENDGAME_DRAW);
+    add("KNK", ENDGAME_DRAW);
+    add("KNNK", ENDGAME_DRAW);
+    add("KBKB", ENDGAME_DRAW);
+    add("KBKN", ENDGAME_DRAW);
+    add("KNKN", ENDGAME_DRAW);
+
+    add("KQK", ENDGAME_KXK);
+    add("KRK", ENDGAME_KXK);
+    add("KQQK", ENDGAME_KXK);
+    add("KQRK", ENDGAME_KXK);
+    add("KQBK", ENDGAME_KXK);
+    add("KQNK", ENDGAME_KXK);
+    add("KRRK", ENDGAME_KXK);
+    add("KRBK", ENDGAME_KXK);
+    add("KRNK", ENDGAME_KXK);
+    add("KBBK", ENDGAME_KXK);
+    add("KBNK", ENDGAME_KBNK);
+
+    // pawn counts are part of the key, every count has its own entry
+    uint64_t bishop[2] = { MATERIAL_UNIT(SIDE_BLACK, PIECE_KING) + \
+                           MATERIAL_UNIT(SIDE_BLACK, PIECE_BISHOP), \
+                           MATERIAL_UNIT(SIDE_WHITE, PIECE_KING) + \
+                           MATERIAL_UNIT(SIDE_WHITE, PIECE_BISHOP) };
+    for(uint8_t side = 0; side < 2; side++){
+        uint64_t key = bishop[side] + MATERIAL_UNIT(!side, PIECE_KING);
+        for(uint8_t i = 1; i <= ENDGAME_MAX_PAWNS; i++){
+            addKey(key + i * MATERIAL_UNIT(side, PIECE_PAWN), ENDGAME_KBPK, \
+                   side);
+        }
+    }
+    for(uint8_t i = 0; i <= ENDGAME_MAX_PAWNS; i++){
+        for(uint8_t j = 0; j <= ENDGAME_MAX_PAWNS; j++){
+            addKey(bishop[SIDE_BLACK] + bishop[SIDE_WHITE] + \
+                   i * MATERIAL_UNIT(SIDE_BLACK, PIECE_PAWN) + \
+                   j * MATERIAL_UNIT(SIDE_WHITE, PIECE_PAWN), \
+                   ENDGAME_OPPOSITE_BISHOPS, i > j ? SIDE_BLACK : SIDE_WHITE);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+const endgameEntry_t *EndgameTable::probe(uint64_t key) const
+{
+    // few slots are used, a miss mostly ends at the first empty one
+    for(uint32_t i = slotOf(key); entries[i].key != 0; \
+        i = (i + 1) & (ENDGAME_TABLE_SIZE - 1)){
+        if(entries[i].key == key){
+            return &entries[i];
+        }
+    }
+
+    return nullptr;
+}
+
+/*---------------------------------------------------------------------------*/
+void EndgameTable::add(const char *pieces, uint8_t type)
+{
+    static const char letters[] = "BKNPQR"; // in PIECE_* order
+
+    for(uint8_t strongSide = 0; strongSide < 2; strongSide++){
+        uint64_t key = 0;
+        bool side = strongSide;
+        for(const char *c = pieces; *c != '\0'; c++){
+            // the second king starts the pieces of the weak side
+            if(*c == 'K' && c != pieces){
+                side = !side;
+            }
+            key += MATERIAL_UNIT(side, strchr(letters, *c) - letters);
+        }
+        addKey(key, type, strongSide);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void EndgameTable::addKey(uint64_t key, uint8_t type, uint8_t strongSide)
+{
+    // symmetric material is added once, the first entry is kept
+    uint32_t i = slotOf(key);
+    while(entries[i].key != 0 && entries[i].key != key){
+        i = (i + 1) & (ENDGAME_TABLE_SIZE - 1);
+    }
+    if(entries[i].key == 0){
+        entries[i].key = key;
+        entries[i].type = type;
+        entries[i].strongSide = strongSide;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+uint32_t EndgameTable::slotOf(uint64_t key)
+{
+    // fibonacci hashing spreads the few counts over the whole table
+    return (key * 0x9E3779B97F4A7C15ULL) >> (64 - ENDGAME_TABLE_BITS);
+}
+
+/*---------------------------------------------------------------------------*/
+static int boxDistance(ChessPiece &piece, int x, int y)
+{
+    return std::max(abs(piece.x() - x), abs(piece.y() - y));
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::isKnownEnding()
+{
+    return endgameTable().probe(materialKey) != nullptr;
+}
+
+/*---------------------------------------------------------------------------*/
+int ChessEngine::endgameRating(const endgameEntry_t &endgame)
+{
+    if(endgame.type == ENDGAME_DRAW){
+        return 0;
+    } else if(endgame.type >= ENDGAME_SCALE_FIRST){
+        return (materialRating() + positionalRating()) * \
+                endgameScale(endgame) / ENDGAME_SCALE_NORMAL;
+    }
+
+    bool strong = endgame.strongSide;
+    ChessPiece &winner = chessPieces[strong == SIDE_WHITE ? \
+                                     whiteKingIndex : blackKingIndex];
+    ChessPiece &loser = chessPieces[strong == SIDE_WHITE ? \
+                                    blackKingIndex : whiteKingIndex];
+
+    // the lone king is driven to the edge, for KBNK also to a corner of the
+    // colour of the bishop, and the other king follows it
+    int bonus = ENDGAME_WIN_BONUS + \
+            (INVERTING_OFFSET - boxDistance(winner, loser.x(), loser.y())) * \
+            ENDGAME_CLOSE_BONUS;
+    int centre = std::max(loser.x() < 4 ? 3 - loser.x() : loser.x() - 4, \
+                          loser.y() < 4 ? 3 - loser.y() : loser.y() - 4);
+    bonus += centre * ENDGAME_EDGE_BONUS;
+    if(endgame.type == ENDGAME_KBNK){
+        // a1 and h8 are dark, (x + y) is even on the dark boxes
+        ChessPiece &bishop = *findPiece(strong, PIECE_BISHOP);
+        int corner = (bishop.x() + bishop.y()) % 2 == 0 ? \
+                std::min(boxDistance(loser, 0, 0), \
+                         boxDistance(loser, INVERTING_OFFSET, \
+                                     INVERTING_OFFSET)) : \
+                std::min(boxDistance(loser, INVERTING_OFFSET, 0), \
+                         boxDistance(loser, 0, INVERTING_OFFSET));
+        bonus += (INVERTING_OFFSET - corner) * ENDGAME_CORNER_BONUS;
+    }
+
+    return materialRating() + (strong == SIDE_WHITE ? bonus : -bonus);
+}
+
+/*---------------------------------------------------------------------------*/
+int ChessEngine::endgameScale(const endgameEntry_t &endgame)
+{
+    if(endgame.type == ENDGAME_OPPOSITE_BISHOPS){
+        ChessPiece &white = *findPiece(SIDE_WHITE, PIECE_BISHOP);
+        ChessPiece &black = *findPiece(SIDE_BLACK, PIECE_BISHOP);
+        return (white.x() + white.y()) % 2 != (black.x() + black.y()) % 2 ? \
+                ENDGAME_SCALE_OPPOSITE_BISHOPS : ENDGAME_SCALE_NORMAL;
+    }
+
+    // ENDGAME_KBPK, a draw if all pawns are on one rook file, the bishop
+    // can not cover the promotion box and the lone king stands near it
+    bool strong = endgame.strongSide;
+    uint8_t file = 0xFF;
+    for(uint8_t i = 0; i < TOTAL_PIECE_NUM; i++){
+        ChessPiece &piece = chessPieces[i];
+        if(!piece.onBoard() || piece.side() != strong || \
+           piece.type() != PIECE_PAWN){
+            continue;
+        }
+        if((piece.x() != 0 && piece.x() != INVERTING_OFFSET) || \
+           (file != 0xFF && piece.x() != file)){
+            return ENDGAME_SCALE_NORMAL;
+        }
+        file = piece.x();
+    }
+
+    uint8_t rank = strong == SIDE_WHITE ? INVERTING_OFFSET : 0;
+    ChessPiece &bishop = *findPiece(strong, PIECE_BISHOP);
+    ChessPiece &loser = chessPieces[strong == SIDE_WHITE ? \
+                                    blackKingIndex : whiteKingIndex];
+    if((bishop.x() + bishop.y()) % 2 == (file + rank) % 2 || \
+       boxDistance(loser, file, rank) > 1){
+        return ENDGAME_SCALE_NORMAL;
+    }
+
+    return ENDGAME_SCALE_DRAW;
+}
+
+/*---------------------------------------------------------------------------*/
+ChessPiece *ChessEngine::findPiece(bool side, uint8_t type)
+{
+    // a side keeps its pieces in its own half of the array
+    uint8_t start = sidePieceStart(side);
+    for(uint8_t i = start; i < start + TOTAL_PIECE_NUM / 2; i++){
+        if(chessPieces[i].onBoard() && chessPieces[i].type() == type){
+            return &chessPieces[i];
+        }
+    }
+
+    return nullptr;
+}
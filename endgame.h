@@ -0,0 +1,76 @@
+/*
+ * Endgame Table - specialised evaluations picked by the material on board
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+#include <cstdint>
+
+/*---------------------------------------------------------------------------*/
+// the material key counts the pieces of each side and type in 4 bits,
+// kings included so a key is never 0
+#define MATERIAL_COUNT_BITS 4
+#define MATERIAL_COUNT_MASK 0xF
+#define MATERIAL_SIDE_SHIFT 24 // 6 piece types of a side
+#define MATERIAL_SHIFT(side, type) \
+    ((side) * MATERIAL_SIDE_SHIFT + (type) * MATERIAL_COUNT_BITS)
+#define MATERIAL_UNIT(side, type) (1ULL << MATERIAL_SHIFT(side, type))
+#define MATERIAL_COUNT(key, side, type) \
+    (((key) >> MATERIAL_SHIFT(side, type)) & MATERIAL_COUNT_MASK)
+
+#define ENDGAME_TABLE_BITS 9 // a few hundred keys are used
+#define ENDGAME_TABLE_SIZE (1 << ENDGAME_TABLE_BITS)
+
+// evaluated on their own
+#define ENDGAME_NONE             0
+#define ENDGAME_DRAW             1 // neither side can force a mate
+#define ENDGAME_KXK              2 // mating material against the lone king
+#define ENDGAME_KBNK             3
+// the usual evaluation scaled
+#define ENDGAME_KBPK             4 // rook pawns and the wrong bishop
+#define ENDGAME_OPPOSITE_BISHOPS 5 // only bishops and pawns
+#define ENDGAME_SCALE_FIRST      ENDGAME_KBPK
+
+// rating units
+#define ENDGAME_WIN_BONUS    2000 // a won ending beats keeping more pieces
+#define ENDGAME_EDGE_BONUS   20   // per rank or file of the lone king from
+                                  // the centre
+#define ENDGAME_CORNER_BONUS 20   // per box nearer the mating corner
+#define ENDGAME_CLOSE_BONUS  10   // per box nearer the other king
+
+// in 64ths of the evaluation
+#define ENDGAME_SCALE_NORMAL           64
+#define ENDGAME_SCALE_OPPOSITE_BISHOPS 32
+#define ENDGAME_SCALE_DRAW             0
+
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    uint64_t key;       // material key, 0 for an empty slot
+    uint8_t type;       // ENDGAME_*
+    uint8_t strongSide; // the side with more material
+} endgameEntry_t;
+
+/*---------------------------------------------------------------------------*/
+// filled once with the known endings of both colours, read only after
+class EndgameTable
+{
+public:
+    EndgameTable();
+
+    // nullptr if the material has no specialised evaluation
+    const endgameEntry_t *probe(uint64_t key) const;
+private:
+    // pieces of the strong side then of the weak one, like "KBNK"
+    void add(const char *pieces, uint8_t type);
+    void addKey(uint64_t key, uint8_t type, uint8_t strongSide);
+    static uint32_t slotOf(uint64_t key);
+
+    endgameEntry_t entries[ENDGAME_TABLE_SIZE];
+};
+
+/*---------------------------------------------------------------------------*/
+const EndgameTable &endgameTable();
+
+#endif // ENDGAME_H
@@ -0,0 +1,27 @@
+/*
+ * Evaluation Defaults - initial weights of the evaluation parameters
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef EVALDEFAULTS_H
+#define EVALDEFAULTS_H
+
+// rating units, the tuner ("tune -o evaldefaults.h") rewrites this file
+#define EVAL_DEFAULT_PAWN          100
+#define EVAL_DEFAULT_KNIGHT        300
+#define EVAL_DEFAULT_BISHOP        300
+#define EVAL_DEFAULT_ROOK          500
+#define EVAL_DEFAULT_QUEEN         900
+#define EVAL_DEFAULT_KING_PRESSURE 5
+#define EVAL_DEFAULT_PAWN_SHELTER  -20
+#define EVAL_DEFAULT_PAWN_DOUBLED  -15
+#define EVAL_DEFAULT_PAWN_ISOLATED -12
+#define EVAL_DEFAULT_PAWN_BACKWARD -8
+#define EVAL_DEFAULT_PASSED_RANK2  5
+#define EVAL_DEFAULT_PASSED_RANK3  10
+#define EVAL_DEFAULT_PASSED_RANK4  20
+#define EVAL_DEFAULT_PASSED_RANK5  35
+#define EVAL_DEFAULT_PASSED_RANK6  60
+#define EVAL_DEFAULT_PASSED_RANK7  100
+
+#endif // EVALDEFAULTS_H
@@ -0,0 +1,166 @@
+/*
+ * Evaluation Parameters - runtime weights of the static evaluation
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "evalparams.h"
+#include "evaldefaults.h"
+#include "paramlist.h"
+
+#include <QDebug>
+
+#include <cstdio>
+#include <cstring>
+
+/*---------------------------------------------------------------------------*/
+#define PARAM_NAME_MAX_LEN 32
+#define PARAM_LINE_LENGTH  128
+
+#define EVAL_PARAM_ENTRY(name, macro) { name, #macro, macro }
+
+typedef struct {
+    const char *name;
+    const char *macro;
+    int defaultValue;
+} evalParamEntry_t;
+
+// in EVAL_* index order
+static const evalParamEntry_t evalParamEntries[EVAL_PARAM_NUM] = {
+    EVAL_PARAM_ENTRY("pawn", EVAL_DEFAULT_PAWN),
+    EVAL_PARAM_ENTRY("knight", EVAL_DEFAULT_KNIGHT),
+    EVAL_PARAM_ENTRY("bishop", EVAL_DEFAULT_BISHOP),
+    EVAL_PARAM_ENTRY("rook", EVAL_DEFAULT_ROOK),
+    EVAL_PARAM_ENTRY("queen", EVAL_DEFAULT_QUEEN),
+    EVAL_PARAM_ENTRY("kingPressure", EVAL_DEFAULT_KING_PRESSURE),
+    EVAL_PARAM_ENTRY("pawnShelter", EVAL_DEFAULT_PAWN_SHELTER),
+    EVAL_PARAM_ENTRY("pawnDoubled", EVAL_DEFAULT_PAWN_DOUBLED),
+    EVAL_PARAM_ENTRY("pawnIsolated", EVAL_DEFAULT_PAWN_ISOLATED),
+    EVAL_PARAM_ENTRY("pawnBackward", EVAL_DEFAULT_PAWN_BACKWARD),
+    EVAL_PARAM_ENTRY("passedRank2", EVAL_DEFAULT_PASSED_RANK2),
+    EVAL_PARAM_ENTRY("passedRank3", EVAL_DEFAULT_PASSED_RANK3),
+    EVAL_PARAM_ENTRY("passedRank4", EVAL_DEFAULT_PASSED_RANK4),
+    EVAL_PARAM_ENTRY("passedRank5", EVAL_DEFAULT_PASSED_RANK5),
+    EVAL_PARAM_ENTRY("passedRank6", EVAL_DEFAULT_PASSED_RANK6),
+    EVAL_PARAM_ENTRY("passedRank7", EVAL_DEFAULT_PASSED_RANK7)
+};
+
+/*---------------------------------------------------------------------------*/
+EvalParams::EvalParams()
+{
+    for(uint8_t i = 0; i < EVAL_PARAM_NUM; i++){
+        weights[i] = evalParamEntries[i].defaultValue;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+bool EvalParams::parse(const char *spec)
+{
+    return parseParamList(spec, [this](const char *name, int value){
+        return set(name, value);
+    });
+}
+
+/*---------------------------------------------------------------------------*/
+bool EvalParams::set(const char *name, int value)
+{
+    for(uint8_t i = 0; i < EVAL_PARAM_NUM; i++){
+        if(strcmp(evalParamEntries[i].name, name) == 0){
+            weights[i] = value;
+            return true;
+        }
+    }
+
+    qDebug() << "Unknown evaluation parameter:" << name;
+    return false;
+}
+
+/*---------------------------------------------------------------------------*/
+bool EvalParams::load(const char *path)
+{
+    FILE *file = path ? fopen(path, "r") : nullptr;
+    if(file == nullptr){
+        return false;
+    }
+
+    bool allValid = true;
+    char line[PARAM_LINE_LENGTH];
+    while(fgets(line, sizeof(line), file) != nullptr){
+        char name[PARAM_NAME_MAX_LEN];
+        int value;
+
+        char *comment = strchr(line, '#');
+        if(comment != nullptr){
+            *comment = '\0';
+        }
+
+        if(sscanf(line, " %31[^= \t] = %d", name, &value) == 2){
+            allValid = set(name, value) && allValid;
+        } else if(strspn(line, " \t\r\n") != strlen(line)){
+            allValid = false;
+        }
+    }
+    fclose(file);
+
+    return allValid;
+}
+
+/*---------------------------------------------------------------------------*/
+bool EvalParams::save(const char *path) const
+{
+    FILE *file = fopen(path, "w");
+    if(file == nullptr){
+        return false;
+    }
+
+    fprintf(file, "# evaluation weights in rating units\n");
+    for(uint8_t i = 0; i < EVAL_PARAM_NUM; i++){
+        fprintf(file, "%s = %d\n", evalParamEntries[i].name, weights[i]);
+    }
+
+    return fclose(file) == 0;
+}
+
+/*---------------------------------------------------------------------------*/
+bool EvalParams::saveHeader(const char *path) const
+{
+    FILE *file = fopen(path, "w");
+    if(file == nullptr){
+        return false;
+    }
+
+    fprintf(file, "/*\n"
+                  " * Evaluation Defaults - initial weights of the evaluation "
+                  "parameters\n"
+                  " *\n"
+                  " * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020\n"
+                  " */\n"
+                  "#ifndef EVALDEFAULTS_H\n"
+                  "#define EVALDEFAULTS_H\n\n"
+                  "// rating units, the tuner (\"tune -o evaldefaults.h\") "
+                  "rewrites this file\n");
+    for(uint8_t i = 0; i < EVAL_PARAM_NUM; i++){
+        fprintf(file, "#define %-26s %d\n", evalParamEntries[i].macro, \
+                weights[i]);
+    }
+    fprintf(file, "\n#endif // EVALDEFAULTS_H\n");
+
+    return fclose(file) == 0;
+}
+
+/*---------------------------------------------------------------------------*/
+int EvalParams::weigh(const int16_t *features, uint8_t first, \
+                      uint8_t end) const
+{
+    int sum = 0;
+    for(uint8_t i = first; i < end; i++){
+        sum += weights[i] * features[i];
+    }
+
+    return sum;
+}
+
+/*---------------------------------------------------------------------------*/
+const char *EvalParams::name(uint8_t index)
+{
+    return index < EVAL_PARAM_NUM ? evalParamEntries[index].name : nullptr;
+}
@@ -0,0 +1,59 @@
+/*
+ * Evaluation Parameters - runtime weights of the static evaluation
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef EVALPARAMS_H
+#define EVALPARAMS_H
+
+#include <cstdint>
+
+/*---------------------------------------------------------------------------*/
+#define EVAL_PARAMS_ENV      "AI_CHESS_EVAL_PARAMS"
+#define EVAL_PARAMS_FILE_ENV "AI_CHESS_EVAL_FILE"
+
+// indexes of the weight and feature vectors, the evaluation is the dot
+// product of both. features are white count minus black count
+#define EVAL_PAWN          0
+#define EVAL_KNIGHT        1
+#define EVAL_BISHOP        2
+#define EVAL_ROOK          3
+#define EVAL_QUEEN         4
+#define EVAL_KING_PRESSURE 5  // attacked boxes around the enemy king
+#define EVAL_PAWN_SHELTER  6  // king files without a close own pawn
+#define EVAL_PAWN_DOUBLED  7  // the pawn hash terms start here
+#define EVAL_PAWN_ISOLATED 8
+#define EVAL_PAWN_BACKWARD 9
+#define EVAL_PASSED_RANK2  10 // one weight per rank, up to rank 7
+#define EVAL_PARAM_NUM     16
+
+#define EVAL_MATERIAL_FIRST   EVAL_PAWN
+#define EVAL_POSITIONAL_FIRST EVAL_KING_PRESSURE
+#define EVAL_PAWN_TERM_FIRST  EVAL_PAWN_DOUBLED
+#define EVAL_PAWN_TERM_NUM    (EVAL_PARAM_NUM - EVAL_PAWN_TERM_FIRST)
+
+/*---------------------------------------------------------------------------*/
+// weights are in rating units, defaults come from evaldefaults.h
+class EvalParams
+{
+public:
+    EvalParams();
+
+    // "name=value,name=value", unknown names are reported and skipped
+    bool parse(const char *spec);
+    bool set(const char *name, int value);
+    // "name = value" lines, '#' starts a comment
+    bool load(const char *path);
+    bool save(const char *path) const;
+    // evaldefaults.h with the current weights as the defaults
+    bool saveHeader(const char *path) const;
+
+    // weighted sum of the features in [first, end)
+    int weigh(const int16_t *features, uint8_t first, uint8_t end) const;
+
+    static const char *name(uint8_t index);
+
+    int weights[EVAL_PARAM_NUM];
+};
+
+#endif // EVALPARAMS_H
@@ -0,0 +1,611 @@
+/*
+ * Opening Explorer - sorted position index built from PGN games
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "explorer.h"
+#include "pgn.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <queue>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*---------------------------------------------------------------------------*/
+#define EXPLORER_TT_SIZE_MB       1    // replay needs no search
+#define EXPLORER_MIN_BUFFER       4096 // entries of a run buffer at least
+#define EXPLORER_MERGE_BUFFER     4096 // entries read at once from a run
+#define EXPLORER_MERGE_FAN_IN     256  // runs merged at once
+#define EXPLORER_LINEAR_RANGE     16   // lookups scan ranges this small
+#define EXPLORER_RUN_SUFFIX       ".run."
+
+/*---------------------------------------------------------------------------*/
+static bool entryLess(const explorerEntry_t &a, const explorerEntry_t &b)
+{
+    return a.key < b.key || (a.key == b.key && a.move < b.move);
+}
+
+/*---------------------------------------------------------------------------*/
+// sorted, the counts of equal moves of a position are summed
+static size_t compactEntries(explorerEntry_t *entries, size_t count)
+{
+    std::sort(entries, entries + count, entryLess);
+
+    size_t out = 0;
+    for(size_t i = 0; i < count; i++){
+        if(out > 0 && entries[out - 1].key == entries[i].key && \
+           entries[out - 1].move == entries[i].move){
+            entries[out - 1].white += entries[i].white;
+            entries[out - 1].draws += entries[i].draws;
+            entries[out - 1].black += entries[i].black;
+        } else{
+            entries[out++] = entries[i];
+        }
+    }
+
+    return out;
+}
+
+/*---------------------------------------------------------------------------*/
+ExplorerBuilder::ExplorerBuilder(unsigned threadCount, uint32_t memoryMb, \
+                                 uint16_t maxPly)
+{
+    if(threadCount == 0){
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    this->threadCount = threadCount;
+    this->bufferEntries = std::max<size_t>(EXPLORER_MIN_BUFFER, \
+            (size_t)(memoryMb * BYTES_IN_MB) / sizeof(explorerEntry_t) / \
+            threadCount);
+    this->maxPly = maxPly;
+    this->games = 0;
+    this->positions = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ExplorerBuilder::build(const char *indexPath, const char **pgnPaths, \
+                            size_t pgnCount)
+{
+    games = 0;
+    positions = 0;
+    runs.clear();
+
+    bool ok = true;
+    for(size_t i = 0; i < pgnCount && ok; i++){
+        ok = buildRuns(pgnPaths[i], indexPath);
+    }
+    ok = ok && mergeRuns(indexPath);
+
+    for(size_t i = 0; i < runs.size(); i++){
+        remove(runs[i].c_str());
+    }
+    runs.clear();
+
+    return ok;
+}
+
+/*---------------------------------------------------------------------------*/
+uint64_t ExplorerBuilder::gameCount() const
+{
+    return games;
+}
+
+/*---------------------------------------------------------------------------*/
+uint64_t ExplorerBuilder::positionCount() const
+{
+    return positions;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ExplorerBuilder::buildRuns(const char *pgnPath, const char *indexPath)
+{
+    PgnReader reader;
+    if(!reader.open(pgnPath)){
+        fprintf(stderr, "%s can not be read\n", pgnPath);
+        return false;
+    }
+
+    std::vector<const char *> bounds = PgnParser::splitRanges(\
+                reader.data(), reader.data() + reader.size(), threadCount);
+
+    // run files are named after the index, the file and the thread
+    std::vector<std::string> prefixes;
+    std::vector<unsigned> runCounts(threadCount, 0);
+    std::vector<uint64_t> gameCounts(threadCount, 0);
+    std::unique_ptr<bool[]> oks(new bool[threadCount]);
+    std::vector<std::thread> workers;
+    for(unsigned i = 0; i < threadCount; i++){
+        prefixes.push_back(std::string(indexPath) + EXPLORER_RUN_SUFFIX + \
+                           std::to_string(runs.size()) + "." + \
+                           std::to_string(i) + ".");
+        oks[i] = true;
+    }
+    for(unsigned i = 0; i < threadCount; i++){
+        workers.push_back(std::thread(replayRange, bounds[i], bounds[i + 1], \
+                                      prefixes[i].c_str(), bufferEntries, \
+                                      maxPly, &runCounts[i], &gameCounts[i], \
+                                      &oks[i]));
+    }
+
+    bool ok = true;
+    for(unsigned i = 0; i < threadCount; i++){
+        workers[i].join();
+        ok = ok && oks[i];
+        games += gameCounts[i];
+        for(unsigned j = 0; j < runCounts[i]; j++){
+            runs.push_back(prefixes[i] + std::to_string(j));
+        }
+    }
+
+    return ok;
+}
+
+/*---------------------------------------------------------------------------*/
+void ExplorerBuilder::replayRange(const char *begin, const char *end, \
+                                  const char *runPrefix, \
+                                  size_t bufferEntries, uint16_t maxPly, \
+                                  unsigned *runCount, uint64_t *games, \
+                                  bool *ok)
+{
+    ChessEngine engine(EXPLORER_TT_SIZE_MB);
+    std::vector<explorerEntry_t> buffer(bufferEntries);
+    size_t used = 0;
+
+    PgnParser parser(begin, end);
+    pgnGame_t game;
+    while(parser.next(&game) && *ok){
+        if(game.result == PGN_RESULT_UNKNOWN){
+            continue; // nothing to score
+        }
+
+        (*games)++;
+        engine.resetPosition();
+
+        const char *cursor = game.moves.data;
+        const char *movesEnd = cursor + game.moves.length;
+        pgnText_t san;
+        for(uint16_t ply = 0; ply < maxPly && \
+            PgnParser::nextMove(&cursor, movesEnd, &san); ply++){
+            Move move;
+            uint8_t promotionType;
+            if(!engine.sanToMove(san.data, san.length, &move, \
+                                 &promotionType)){
+                break; // castling, en passant or an illegal move
+            }
+
+            explorerEntry_t *entry = &buffer[used++];
+            entry->key = engine.positionKey();
+            entry->move = move.packed() | \
+                    (promotionType << EXPLORER_PROMOTION_SHIFT);
+            entry->reserved = 0;
+            entry->white = game.result == PGN_RESULT_WHITE;
+            entry->draws = game.result == PGN_RESULT_DRAW;
+            entry->black = game.result == PGN_RESULT_BLACK;
+            engine.playMove(move, promotionType, false);
+
+            if(used < bufferEntries){
+                continue;
+            }
+
+            // openings repeat, summing in memory often makes enough room
+            used = compactEntries(buffer.data(), used);
+            if(used > bufferEntries / 2){
+                std::string path = runPrefix + std::to_string((*runCount)++);
+                *ok = writeRun(buffer.data(), used, path.c_str());
+                used = 0;
+            }
+        }
+    }
+
+    if(used > 0 && *ok){
+        used = compactEntries(buffer.data(), used);
+        std::string path = runPrefix + std::to_string((*runCount)++);
+        *ok = writeRun(buffer.data(), used, path.c_str());
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+bool ExplorerBuilder::writeRun(explorerEntry_t *entries, size_t count, \
+                               const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if(file == nullptr){
+        fprintf(stderr, "%s can not be written\n", path);
+        return false;
+    }
+
+    bool ok = fwrite(entries, sizeof(explorerEntry_t), count, file) == count;
+    return (fclose(file) == 0) && ok;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ExplorerBuilder::mergeRuns(const char *indexPath)
+{
+    // a pass merges up to EXPLORER_MERGE_FAN_IN runs into a longer one,
+    // open files stay below the process limit for any corpus size
+    unsigned pass = 0;
+    bool ok = true;
+    while(runs.size() > EXPLORER_MERGE_FAN_IN && ok){
+        std::vector<std::string> merged;
+        size_t i = 0;
+        for(; i < runs.size() && ok; i += EXPLORER_MERGE_FAN_IN){
+            size_t last = std::min(runs.size(), i + EXPLORER_MERGE_FAN_IN);
+            std::vector<std::string> group(runs.begin() + i, \
+                                           runs.begin() + last);
+            merged.push_back(std::string(indexPath) + EXPLORER_RUN_SUFFIX + \
+                             "m" + std::to_string(pass) + "." + \
+                             std::to_string(merged.size()));
+
+            uint64_t count;
+            ok = mergeFiles(group, merged.back().c_str(), false, &count);
+            for(size_t j = 0; j < group.size(); j++){
+                remove(group[j].c_str());
+            }
+        }
+
+        // on failure the runs left are still removed by build()
+        merged.insert(merged.end(), runs.begin() + std::min(i, runs.size()), \
+                      runs.end());
+        runs.swap(merged);
+        pass++;
+    }
+
+    return ok && mergeFiles(runs, indexPath, true, &positions);
+}
+
+/*---------------------------------------------------------------------------*/
+bool ExplorerBuilder::mergeFiles(const std::vector<std::string> &inputs, \
+                                 const char *outPath, bool index, \
+                                 uint64_t *count)
+{
+    typedef struct {
+        FILE *file;
+        std::vector<explorerEntry_t> buffer;
+        size_t position;
+        size_t length;
+    } runReader_t;
+
+    std::vector<runReader_t> readers(inputs.size());
+    bool ok = true;
+    for(size_t i = 0; i < inputs.size(); i++){
+        readers[i].file = fopen(inputs[i].c_str(), "rb");
+        readers[i].buffer.resize(EXPLORER_MERGE_BUFFER);
+        readers[i].position = 0;
+        readers[i].length = 0;
+        if(readers[i].file == nullptr){
+            fprintf(stderr, "%s can not be read\n", inputs[i].c_str());
+            ok = false;
+        }
+    }
+
+    // next entry of a run, false when it is used up
+    auto advance = [&readers](size_t run, explorerEntry_t *entry){
+        runReader_t &reader = readers[run];
+        if(reader.position == reader.length){
+            reader.length = fread(reader.buffer.data(), \
+                                  sizeof(explorerEntry_t), \
+                                  EXPLORER_MERGE_BUFFER, reader.file);
+            reader.position = 0;
+            if(reader.length == 0){
+                return false;
+            }
+        }
+        *entry = reader.buffer[reader.position++];
+        return true;
+    };
+
+    typedef std::pair<explorerEntry_t, size_t> heapItem_t;
+    auto heapGreater = [](const heapItem_t &a, const heapItem_t &b){
+        return entryLess(b.first, a.first);
+    };
+    std::priority_queue<heapItem_t, std::vector<heapItem_t>, \
+                        decltype(heapGreater)> heap(heapGreater);
+
+    *count = 0;
+    FILE *out = ok ? fopen(outPath, "wb") : nullptr;
+    if(out != nullptr){
+        // runs are bare entries, the index starts with a header
+        explorerHeader_t header;
+        memcpy(header.magic, EXPLORER_MAGIC, EXPLORER_MAGIC_LENGTH);
+        header.count = 0;
+        if(index){
+            ok = fwrite(&header, sizeof(header), 1, out) == 1;
+        }
+
+        for(size_t i = 0; i < readers.size(); i++){
+            explorerEntry_t entry;
+            if(advance(i, &entry)){
+                heap.push(heapItem_t(entry, i));
+            }
+        }
+
+        // the runs are sorted, equal moves meet at the top of the heap
+        explorerEntry_t current;
+        bool hasCurrent = false;
+        while(!heap.empty() && ok){
+            heapItem_t item = heap.top();
+            heap.pop();
+
+            if(hasCurrent && current.key == item.first.key && \
+               current.move == item.first.move){
+                current.white += item.first.white;
+                current.draws += item.first.draws;
+                current.black += item.first.black;
+            } else{
+                if(hasCurrent){
+                    ok = fwrite(&current, sizeof(current), 1, out) == 1;
+                    (*count)++;
+                }
+                current = item.first;
+                hasCurrent = true;
+            }
+
+            explorerEntry_t entry;
+            if(advance(item.second, &entry)){
+                heap.push(heapItem_t(entry, item.second));
+            }
+        }
+        if(hasCurrent && ok){
+            ok = fwrite(&current, sizeof(current), 1, out) == 1;
+            (*count)++;
+        }
+
+        // the count is known at the end
+        if(index){
+            header.count = *count;
+            ok = ok && fseek(out, 0, SEEK_SET) == 0 && \
+                    fwrite(&header, sizeof(header), 1, out) == 1;
+        }
+        ok = (fclose(out) == 0) && ok;
+    } else if(ok){
+        fprintf(stderr, "%s can not be written\n", outPath);
+        ok = false;
+    }
+
+    for(size_t i = 0; i < readers.size(); i++){
+        if(readers[i].file != nullptr){
+            fclose(readers[i].file);
+        }
+    }
+
+    return ok;
+}
+
+/*---------------------------------------------------------------------------*/
+ExplorerIndex::ExplorerIndex()
+{
+    map = nullptr;
+    mapSize = 0;
+    entries = nullptr;
+    count = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+ExplorerIndex::~ExplorerIndex()
+{
+    close();
+}
+
+/*---------------------------------------------------------------------------*/
+bool ExplorerIndex::open(const char *path)
+{
+    close();
+
+    int fd = path ? ::open(path, O_RDONLY) : -1;
+    if(fd < 0){
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || \
+       info.st_size < (off_t)sizeof(explorerHeader_t)){
+        ::close(fd);
+        return false;
+    }
+
+    mapSize = info.st_size;
+    map = mmap(nullptr, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps the file
+
+    if(map == MAP_FAILED){
+        map = nullptr;
+        mapSize = 0;
+        return false;
+    }
+
+    const explorerHeader_t *header = (const explorerHeader_t *)map;
+    if(memcmp(header->magic, EXPLORER_MAGIC, EXPLORER_MAGIC_LENGTH) != 0 || \
+       header->count > (mapSize - sizeof(explorerHeader_t)) / \
+            sizeof(explorerEntry_t)){
+        close();
+        return false;
+    }
+
+    // lookups jump around, read ahead would only waste memory
+    madvise(map, mapSize, MADV_RANDOM);
+    entries = (const explorerEntry_t *)(header + 1);
+    count = header->count;
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+void ExplorerIndex::close()
+{
+    if(map != nullptr){
+        munmap(map, mapSize);
+    }
+
+    map = nullptr;
+    mapSize = 0;
+    entries = nullptr;
+    count = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ExplorerIndex::isOpen() const
+{
+    return map != nullptr;
+}
+
+/*---------------------------------------------------------------------------*/
+size_t ExplorerIndex::lookup(uint64_t key, \
+                             const explorerEntry_t **found) const
+{
+    // first entry with a key not below the searched one is in [low, high]
+    size_t low = 0, high = count;
+    bool interpolate = true;
+    while(high - low > EXPLORER_LINEAR_RANGE){
+        uint64_t lowKey = entries[low].key;
+        uint64_t highKey = entries[high - 1].key;
+        if(lowKey >= key){
+            high = low;
+            break;
+        } else if(highKey < key){
+            low = high;
+            break;
+        }
+
+        // zobrist keys are uniform so the guess is close, the bisection
+        // steps in between keep the worst case logarithmic
+        size_t guess = low + (high - low) / 2;
+        if(interpolate){
+            double ratio = (double)(key - lowKey) / (double)(highKey - lowKey);
+            guess = low + (size_t)(ratio * (high - 1 - low));
+        }
+        interpolate = !interpolate;
+
+        if(entries[guess].key < key){
+            low = guess + 1;
+        } else{
+            high = guess;
+        }
+    }
+
+    while(low < high && entries[low].key < key){
+        low++;
+    }
+
+    size_t matches = 0;
+    while(low + matches < count && entries[low + matches].key == key){
+        matches++;
+    }
+
+    *found = matches ? &entries[low] : nullptr;
+    return matches;
+}
+
+/*---------------------------------------------------------------------------*/
+static int explorerBuildMain(int argc, char *argv[])
+{
+    unsigned threads = 0;
+    uint32_t memoryMb = EXPLORER_DEFAULT_MEMORY;
+    uint16_t maxPly = EXPLORER_DEFAULT_MAX_PLY;
+    std::vector<const char *> paths;
+
+    for(int i = 1; i < argc; i++){
+        bool hasValue = i + 1 < argc;
+        if(strcmp(argv[i], "-t") == 0 && hasValue){
+            threads = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-m") == 0 && hasValue){
+            memoryMb = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-p") == 0 && hasValue){
+            maxPly = atoi(argv[++i]);
+        } else{
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if(paths.size() < 2){
+        fprintf(stderr, "usage: explorer build [-t threads] [-m MB] "
+                        "[-p maxPly] index pgn...\n");
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point start = \
+            std::chrono::steady_clock::now();
+
+    ExplorerBuilder builder(threads, memoryMb, maxPly);
+    if(!builder.build(paths[0], &paths[1], paths.size() - 1)){
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(\
+                std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%llu games, %llu entries, %.1f MB, %.1f s\n", \
+            (unsigned long long)builder.gameCount(), \
+            (unsigned long long)builder.positionCount(), \
+            builder.positionCount() * sizeof(explorerEntry_t) / BYTES_IN_MB, \
+            seconds);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+static int explorerQueryMain(int argc, char *argv[])
+{
+    ExplorerIndex index;
+    packedPosition_t position;
+    if(argc < 3 || !index.open(argv[1]) || \
+       !ChessEngine::fenToPosition(argv[2], &position)){
+        fprintf(stderr, "usage: explorer query index fen\n");
+        return 1;
+    }
+
+    ChessEngine engine(EXPLORER_TT_SIZE_MB);
+    if(!engine.unpackPosition(&position)){
+        fprintf(stderr, "invalid position\n");
+        return 1;
+    }
+
+    const explorerEntry_t *found;
+    size_t count = index.lookup(engine.positionKey(), &found);
+
+    // most played first
+    std::vector<explorerEntry_t> entries(found, found + count);
+    std::sort(entries.begin(), entries.end(), \
+              [](const explorerEntry_t &a, const explorerEntry_t &b){
+        return a.white + a.draws + a.black > b.white + b.draws + b.black;
+    });
+    count = std::min<size_t>(count, EXPLORER_MAX_RESULTS);
+
+    for(size_t i = 0; i < count; i++){
+        Move move;
+        move.setPacked(entries[i].move & EXPLORER_MOVE_MASK);
+        char san[SAN_MAX_LENGTH];
+        engine.moveToSan(move, san, \
+                         entries[i].move >> EXPLORER_PROMOTION_SHIFT);
+
+        uint32_t total = entries[i].white + entries[i].draws + \
+                entries[i].black;
+        printf("%-8s %8u  %5.1f%% %5.1f%% %5.1f%%\n", san, total, \
+               100.0 * entries[i].white / total, \
+               100.0 * entries[i].draws / total, \
+               100.0 * entries[i].black / total);
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+int explorerMain(int argc, char *argv[])
+{
+    if(argc > 1 && strcmp(argv[1], "build") == 0){
+        return explorerBuildMain(argc - 1, argv + 1);
+    } else if(argc > 1 && strcmp(argv[1], "query") == 0){
+        return explorerQueryMain(argc - 1, argv + 1);
+    }
+
+    fprintf(stderr, "usage: explorer build|query ...\n");
+    return 1;
+}
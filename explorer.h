@@ -0,0 +1,105 @@
+/*
+ * Opening Explorer - sorted position index built from PGN games
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef EXPLORER_H
+#define EXPLORER_H
+
+#include "chessengine.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+#define EXPLORER_INDEX_ENV       "AI_CHESS_EXPLORER_INDEX"
+#define EXPLORER_MAGIC           "AICEXPL1"
+#define EXPLORER_MAGIC_LENGTH    8
+#define EXPLORER_DEFAULT_MAX_PLY 30  // deeper positions are rarely shared
+#define EXPLORER_DEFAULT_MEMORY  512 // MB of run buffers, all threads
+#define EXPLORER_MAX_RESULTS     64  // moves returned for one position
+
+// promotion type above the 12 bits of Move::packed()
+#define EXPLORER_PROMOTION_SHIFT 12
+#define EXPLORER_MOVE_MASK       0x0FFF
+
+/*---------------------------------------------------------------------------*/
+// 24 bytes, sorted by key then move, one entry per move of a position
+typedef struct {
+    uint64_t key;  // zobrist key of the position before the move
+    uint16_t move; // Move::packed() | promotion << EXPLORER_PROMOTION_SHIFT
+    uint16_t reserved;
+    uint32_t white; // games won by white after the move
+    uint32_t draws;
+    uint32_t black;
+} explorerEntry_t;
+
+typedef struct {
+    char magic[EXPLORER_MAGIC_LENGTH];
+    uint64_t count;
+} explorerHeader_t;
+
+static_assert(sizeof(explorerEntry_t) == 24, "explorer entry is 24 bytes");
+
+/*---------------------------------------------------------------------------*/
+// games are replayed into sorted runs on all cores, the runs are merged
+// into the index. memory use is bounded by memoryMb, not by the corpus
+class ExplorerBuilder
+{
+public:
+    ExplorerBuilder(unsigned threadCount = 0, \
+                    uint32_t memoryMb = EXPLORER_DEFAULT_MEMORY, \
+                    uint16_t maxPly = EXPLORER_DEFAULT_MAX_PLY);
+
+    bool build(const char *indexPath, const char **pgnPaths, \
+               size_t pgnCount);
+    uint64_t gameCount() const;
+    uint64_t positionCount() const; // entries of the index
+private:
+    bool buildRuns(const char *pgnPath, const char *indexPath);
+    bool mergeRuns(const char *indexPath);
+    static bool mergeFiles(const std::vector<std::string> &inputs, \
+                           const char *outPath, bool index, uint64_t *count);
+    static void replayRange(const char *begin, const char *end, \
+                            const char *runPrefix, size_t bufferEntries, \
+                            uint16_t maxPly, unsigned *runCount, \
+                            uint64_t *games, bool *ok);
+    static bool writeRun(explorerEntry_t *entries, size_t count, \
+                         const char *path);
+
+    unsigned threadCount;
+    size_t bufferEntries; // per thread
+    uint16_t maxPly;
+    uint64_t games;
+    uint64_t positions;
+    std::vector<std::string> runs;
+};
+
+/*---------------------------------------------------------------------------*/
+// whole index mapped read only, lookups touch a few pages
+class ExplorerIndex
+{
+public:
+    ExplorerIndex();
+    ~ExplorerIndex();
+
+    bool open(const char *path);
+    void close();
+    bool isOpen() const;
+    // entries of the position, consecutive in the index
+    size_t lookup(uint64_t key, const explorerEntry_t **entries) const;
+private:
+    void *map;
+    size_t mapSize;
+    const explorerEntry_t *entries;
+    size_t count;
+};
+
+/*---------------------------------------------------------------------------*/
+// "explorer build [-t threads] [-m MB] [-p maxPly] index pgn..." or
+// "explorer query index fen"
+int explorerMain(int argc, char *argv[]);
+
+#endif // EXPLORER_H
@@ -0,0 +1,215 @@
+/*
+ * Game History - moves of the game as a table model, for scrubbing
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "gamehistory.h"
+
+#include <QBrush>
+#include <QColor>
+
+#include <algorithm>
+#include <cstring>
+
+/*---------------------------------------------------------------------------*/
+#define HISTORY_CURRENT_COLOR (QColor(255, 30, 30, 135))
+
+/*---------------------------------------------------------------------------*/
+GameHistory::GameHistory(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+    startKey = 0;
+    current = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+void GameHistory::reset(ChessEngine *engine)
+{
+    packedPosition_t position;
+    engine->packPosition(&position);
+
+    beginResetModel();
+    plies.clear();
+    checkpoints.assign(1, position);
+    startKey = engine->positionKey();
+    current = 0;
+    endResetModel();
+}
+
+/*---------------------------------------------------------------------------*/
+void GameHistory::addMove(Move move, uint8_t promotionType, const char *san, \
+                          ChessEngine *engine)
+{
+    truncate(current);
+
+    historyPly_t ply;
+    ply.move = move;
+    ply.promotionType = promotionType;
+    strncpy(ply.san, san, SAN_MAX_LENGTH - 1);
+    ply.san[SAN_MAX_LENGTH - 1] = '\0';
+    ply.key = engine->positionKey();
+    ply.halfmoveClock = engine->getHalfmoveClock();
+
+    // a white move starts a row, a black one fills its second cell
+    int row = plies.size() / HISTORY_COLUMNS;
+    if(plies.size() % HISTORY_COLUMNS == 0){
+        beginInsertRows(QModelIndex(), row, row);
+        plies.push_back(ply);
+        endInsertRows();
+    } else{
+        plies.push_back(ply);
+        emit dataChanged(index(row, 1), index(row, 1));
+    }
+
+    if(plies.size() % HISTORY_CHECKPOINT_PLIES == 0){
+        packedPosition_t position;
+        engine->packPosition(&position);
+        checkpoints.push_back(position);
+    }
+
+    setCurrentPly(plies.size());
+}
+
+/*---------------------------------------------------------------------------*/
+void GameHistory::truncate(int ply)
+{
+    if(ply < 0 || ply >= (int)plies.size()){
+        return;
+    }
+
+    beginResetModel();
+    plies.resize(ply);
+    checkpoints.resize(ply / HISTORY_CHECKPOINT_PLIES + 1);
+    current = std::min(current, ply);
+    endResetModel();
+}
+
+/*---------------------------------------------------------------------------*/
+int GameHistory::plyCount() const
+{
+    return plies.size();
+}
+
+/*---------------------------------------------------------------------------*/
+int GameHistory::currentPly() const
+{
+    return current;
+}
+
+/*---------------------------------------------------------------------------*/
+void GameHistory::restore(int ply, ChessEngine *engine)
+{
+    if(ply < 0 || ply > (int)plies.size()){
+        return;
+    }
+
+    // the checkpoint before the ply, so its last move is on the board
+    // for the highlight
+    int checkpoint = ply > 0 ? (ply - 1) / HISTORY_CHECKPOINT_PLIES : 0;
+    engine->unpackPosition(&checkpoints[checkpoint]);
+    for(int i = checkpoint * HISTORY_CHECKPOINT_PLIES; i < ply; i++){
+        engine->playMove(plies[i].move, plies[i].promotionType, \
+                         i == ply - 1);
+    }
+
+    // unpacking cleared the keys and the clock. a repetition can only
+    // reach back to the last capture or pawn move
+    uint16_t clock = ply > 0 ? plies[ply - 1].halfmoveClock : 0;
+    int first = std::max(ply - clock, 0);
+    std::vector<uint64_t> keys;
+    for(int i = first; i < ply; i++){
+        keys.push_back(keyAt(i));
+    }
+    engine->setRuleHistory(keys.data(), keys.size(), clock);
+
+    setCurrentPly(ply);
+}
+
+/*---------------------------------------------------------------------------*/
+int GameHistory::plyOf(const QModelIndex &index) const
+{
+    if(!index.isValid()){
+        return -1;
+    }
+
+    int ply = index.row() * HISTORY_COLUMNS + index.column() + 1;
+    return ply <= (int)plies.size() ? ply : -1;
+}
+
+/*---------------------------------------------------------------------------*/
+int GameHistory::rowCount(const QModelIndex &parent) const
+{
+    if(parent.isValid()){
+        return 0;
+    }
+
+    return (plies.size() + HISTORY_COLUMNS - 1) / HISTORY_COLUMNS;
+}
+
+/*---------------------------------------------------------------------------*/
+int GameHistory::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : HISTORY_COLUMNS;
+}
+
+/*---------------------------------------------------------------------------*/
+QVariant GameHistory::data(const QModelIndex &index, int role) const
+{
+    int ply = plyOf(index);
+    if(ply < 0){
+        return QVariant();
+    }
+
+    if(role == Qt::DisplayRole){
+        return QString(plies[ply - 1].san);
+    } else if(role == Qt::BackgroundRole && ply == current){
+        return QBrush(HISTORY_CURRENT_COLOR);
+    }
+
+    return QVariant();
+}
+
+/*---------------------------------------------------------------------------*/
+QVariant GameHistory::headerData(int section, Qt::Orientation orientation, \
+                                 int role) const
+{
+    if(role != Qt::DisplayRole){
+        return QVariant();
+    } else if(orientation == Qt::Vertical){
+        return section + 1; // move number
+    }
+
+    return QString(section == 0 ? "White" : "Black");
+}
+
+/*---------------------------------------------------------------------------*/
+QModelIndex GameHistory::indexOf(int ply) const
+{
+    // ply 0 is the start position, it has no cell
+    if(ply <= 0){
+        return QModelIndex();
+    }
+
+    return index((ply - 1) / HISTORY_COLUMNS, (ply - 1) % HISTORY_COLUMNS);
+}
+
+/*---------------------------------------------------------------------------*/
+uint64_t GameHistory::keyAt(int ply) const
+{
+    return ply > 0 ? plies[ply - 1].key : startKey;
+}
+
+/*---------------------------------------------------------------------------*/
+void GameHistory::setCurrentPly(int ply)
+{
+    QModelIndex previous = indexOf(current);
+    current = ply;
+    if(previous.isValid()){
+        emit dataChanged(previous, previous);
+    }
+
+    QModelIndex shown = indexOf(current);
+    if(shown.isValid()){
+        emit dataChanged(shown, shown);
+    }
+}
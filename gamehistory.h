@@ -0,0 +1,75 @@
+/*
+ * Game History - moves of the game as a table model, for scrubbing
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef GAMEHISTORY_H
+#define GAMEHISTORY_H
+
+#include "chessengine.h"
+
+#include <QAbstractTableModel>
+
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+#define HISTORY_CHECKPOINT_PLIES 16 // a ply is restored with this many moves
+                                    // at most
+#define HISTORY_COLUMNS          2  // white and black moves of a row
+
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    Move move;
+    uint8_t promotionType;
+    char san[SAN_MAX_LENGTH];
+    uint64_t key;           // of the position after the move
+    uint16_t halfmoveClock; // after the move
+} historyPly_t;
+
+/*---------------------------------------------------------------------------*/
+// a row per move number, the cell of the shown ply is highlighted. the
+// position after every HISTORY_CHECKPOINT_PLIES plies is kept packed, so
+// any ply is set up by unpacking the checkpoint before it and playing the
+// moves after it, no matter how long the game is
+class GameHistory : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit GameHistory(QObject *parent = nullptr);
+
+    // drops the moves, the game starts from the position of engine
+    void reset(ChessEngine *engine);
+    // played in the shown ply, the plies after it are dropped. engine is
+    // the board after the move, packed if a checkpoint falls on it
+    void addMove(Move move, uint8_t promotionType, const char *san, \
+                 ChessEngine *engine);
+    // the plies after ply are dropped
+    void truncate(int ply);
+    int plyCount() const;
+    int currentPly() const; // the shown one, plyCount unless scrubbed
+    // engine is set up in the position after ply moves, the pressure maps
+    // are updated once at the end. the move history of the engine starts
+    // at the checkpoint, the draw rules get the keys of the whole game
+    void restore(int ply, ChessEngine *engine);
+    // the ply after the move of the cell, -1 for an empty cell
+    int plyOf(const QModelIndex &index) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const \
+            override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, \
+                        int role) const override;
+private:
+    QModelIndex indexOf(int ply) const;
+    uint64_t keyAt(int ply) const; // of the position after ply moves
+    void setCurrentPly(int ply);
+
+    std::vector<historyPly_t> plies;
+    // before ply 0, HISTORY_CHECKPOINT_PLIES, twice that ...
+    std::vector<packedPosition_t> checkpoints;
+    uint64_t startKey;
+    int current;
+};
+
+#endif // GAMEHISTORY_H
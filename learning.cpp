@@ -0,0 +1,238 @@
+/*
+ * Learning File - deep search results kept on disk between sessions
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "learning.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*---------------------------------------------------------------------------*/
+LearningFile::LearningFile()
+{
+    map = nullptr;
+    mapSize = 0;
+    buckets = nullptr;
+    bucketCount = 0;
+    minDepth = LEARNING_DEFAULT_MIN_DEPTH;
+}
+
+/*---------------------------------------------------------------------------*/
+LearningFile::~LearningFile()
+{
+    close();
+}
+
+/*---------------------------------------------------------------------------*/
+bool LearningFile::open(const char *path, uint32_t sizeMb, int minDepth)
+{
+    close();
+
+    int fd = path ? ::open(path, O_RDWR | O_CREAT, 0644) : -1;
+    if(fd < 0){
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0){
+        ::close(fd);
+        return false;
+    }
+
+    // a new file is sized up front, unwritten buckets read as zeros
+    bool created = info.st_size == 0;
+    if(created){
+        uint64_t count = 1;
+        while(count * 2 * sizeof(learningBucket_t) <= \
+              (uint64_t)sizeMb * 1024 * 1024){
+            count *= 2;
+        }
+        info.st_size = sizeof(learningHeader_t) + \
+                count * sizeof(learningBucket_t);
+        if(ftruncate(fd, info.st_size) != 0){
+            ::close(fd);
+            return false;
+        }
+    } else if(info.st_size < (off_t)sizeof(learningHeader_t)){
+        ::close(fd);
+        return false;
+    }
+
+    mapSize = info.st_size;
+    map = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps the file
+
+    if(map == MAP_FAILED){
+        map = nullptr;
+        mapSize = 0;
+        return false;
+    }
+
+    learningHeader_t *header = (learningHeader_t *)map;
+    if(created){
+        header->bucketCount = (mapSize - sizeof(learningHeader_t)) / \
+                sizeof(learningBucket_t);
+        header->minDepth = minDepth;
+        // last, a file without the magic is never used
+        memcpy(header->magic, LEARNING_MAGIC, LEARNING_MAGIC_LENGTH);
+    }
+
+    uint64_t count = header->bucketCount;
+    if(memcmp(header->magic, LEARNING_MAGIC, LEARNING_MAGIC_LENGTH) != 0 || \
+       count == 0 || (count & (count - 1)) != 0 || \
+       count > (mapSize - sizeof(learningHeader_t)) / \
+            sizeof(learningBucket_t)){
+        close();
+        return false;
+    }
+
+    // one bucket is touched for a probe, read ahead would only waste memory
+    madvise(map, mapSize, MADV_RANDOM);
+    buckets = (learningBucket_t *)(header + 1);
+    bucketCount = count;
+    this->minDepth = header->minDepth;
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+void LearningFile::close()
+{
+    if(map != nullptr){
+        munmap(map, mapSize); // dirty pages are still written back
+    }
+
+    map = nullptr;
+    mapSize = 0;
+    buckets = nullptr;
+    bucketCount = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+bool LearningFile::isOpen() const
+{
+    return map != nullptr;
+}
+
+/*---------------------------------------------------------------------------*/
+int LearningFile::getMinDepth() const
+{
+    return minDepth;
+}
+
+/*---------------------------------------------------------------------------*/
+bool LearningFile::probe(uint64_t key, ttEntry_t *entry) const
+{
+    const learningBucket_t *bucket = &buckets[key & (bucketCount - 1)];
+    for(uint8_t i = 0; i < LEARNING_BUCKET_SLOTS; i++){
+        const ttSlot_t *slot = &bucket->entries[i];
+        uint64_t data = slot->data.load(std::memory_order_relaxed);
+        uint64_t check = slot->check.load(std::memory_order_relaxed);
+        if((check ^ data) == key){
+            ttUnpackEntry(data, entry);
+            entry->key = key;
+            return entry->flag != TT_FLAG_NONE;
+        }
+    }
+
+    return false;
+}
+
+/*---------------------------------------------------------------------------*/
+void LearningFile::store(uint64_t key, int depth, int score, uint8_t flag, \
+                         uint16_t move)
+{
+    if(depth < minDepth){
+        return;
+    }
+
+    learningBucket_t *bucket = &buckets[key & (bucketCount - 1)];
+
+    // the slot of the same position, else an empty one, else the
+    // shallowest one if it is not deeper than the new result
+    ttSlot_t *target = nullptr;
+    int targetDepth = depth + 1;
+    for(uint8_t i = 0; i < LEARNING_BUCKET_SLOTS; i++){
+        ttSlot_t *slot = &bucket->entries[i];
+        uint64_t data = slot->data.load(std::memory_order_relaxed);
+        uint64_t check = slot->check.load(std::memory_order_relaxed);
+        ttEntry_t old;
+        ttUnpackEntry(data, &old);
+
+        if((check ^ data) == key && old.flag != TT_FLAG_NONE){
+            // the deeper result of the same position is kept, also over
+            // an exact one. unlike the table nothing ages out here
+            if(old.depth > depth){
+                return;
+            }
+            if(move == TT_NO_MOVE){
+                move = old.move;
+            }
+            target = slot;
+            break;
+        } else if(old.flag == TT_FLAG_NONE){
+            targetDepth = -1;
+            target = slot;
+        } else if(old.depth < targetDepth){
+            targetDepth = old.depth;
+            target = slot;
+        }
+    }
+
+    if(target == nullptr){
+        return; // all slots hold deeper results
+    }
+
+    uint64_t data = ttPackEntry(score, move, depth, flag);
+    target->data.store(data, std::memory_order_relaxed);
+    target->check.store(key ^ data, std::memory_order_relaxed);
+}
+
+/*---------------------------------------------------------------------------*/
+size_t LearningFile::slotCount() const
+{
+    return bucketCount * LEARNING_BUCKET_SLOTS;
+}
+
+/*---------------------------------------------------------------------------*/
+size_t LearningFile::usedSlots() const
+{
+    size_t used = 0;
+    for(uint64_t i = 0; i < bucketCount; i++){
+        for(uint8_t j = 0; j < LEARNING_BUCKET_SLOTS; j++){
+            uint64_t data = buckets[i].entries[j].data.load(\
+                        std::memory_order_relaxed);
+            used += (uint8_t)data != TT_FLAG_NONE;
+        }
+    }
+
+    return used;
+}
+
+/*---------------------------------------------------------------------------*/
+int learningMain(int argc, char *argv[])
+{
+    if(argc != 3 || strcmp(argv[1], "info") != 0){
+        fprintf(stderr, "usage: learning info file\n");
+        return 1;
+    }
+
+    LearningFile file;
+    if(access(argv[2], F_OK) != 0 || !file.open(argv[2])){
+        fprintf(stderr, "%s is not a learning file\n", argv[2]);
+        return 1;
+    }
+
+    size_t total = file.slotCount();
+    size_t used = file.usedSlots();
+    printf("slots %zu used %zu (%.1f%%) minDepth %d\n", total, used, \
+           100.0 * used / total, file.getMinDepth());
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * Learning File - deep search results kept on disk between sessions
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef LEARNING_H
+#define LEARNING_H
+
+#include "transposition.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/*---------------------------------------------------------------------------*/
+#define LEARNING_FILE_ENV          "AI_CHESS_LEARNING_FILE"
+#define LEARNING_MAGIC             "AICLRN01"
+#define LEARNING_MAGIC_LENGTH      8
+#define LEARNING_DEFAULT_SIZE_MB   64 // of a new file, old ones keep theirs
+#define LEARNING_DEFAULT_MIN_DEPTH 4  // shallower results are not written
+#define LEARNING_BUCKET_SLOTS      4
+
+/*---------------------------------------------------------------------------*/
+// 64 bytes, the header is followed by the buckets. the key picks one
+// bucket, the position is in one of its entries
+typedef struct {
+    char magic[LEARNING_MAGIC_LENGTH];
+    uint64_t bucketCount; // power of two
+    uint32_t minDepth;
+    uint8_t reserved[44];
+} learningHeader_t;
+
+// one cache line, slots are kept like the ones of the table
+typedef struct {
+    ttSlot_t entries[LEARNING_BUCKET_SLOTS];
+} learningBucket_t;
+
+static_assert(sizeof(learningHeader_t) == 64, "learning header is 64 bytes");
+static_assert(sizeof(learningBucket_t) == 64, "learning bucket is 64 bytes");
+
+/*---------------------------------------------------------------------------*/
+// the file is mapped shared and used in place, opening it reads nothing.
+// engines of any thread or process may probe and store at once, a torn
+// slot reads as a miss. the page cache writes it back, also on a crash
+class LearningFile
+{
+public:
+    LearningFile();
+    ~LearningFile();
+
+    // created empty with sizeMb of buckets if it does not exist
+    bool open(const char *path, uint32_t sizeMb = LEARNING_DEFAULT_SIZE_MB, \
+              int minDepth = LEARNING_DEFAULT_MIN_DEPTH);
+    void close();
+    bool isOpen() const;
+    int getMinDepth() const; // shallower results are neither kept nor read
+
+    bool probe(uint64_t key, ttEntry_t *entry) const;
+    // deeper results replace the shallower ones of the bucket
+    void store(uint64_t key, int depth, int score, uint8_t flag, \
+               uint16_t move);
+    size_t slotCount() const;
+    size_t usedSlots() const; // walks the whole file
+private:
+    void *map;
+    size_t mapSize;
+    learningBucket_t *buckets;
+    uint64_t bucketCount;
+    int minDepth;
+};
+
+/*---------------------------------------------------------------------------*/
+// "learning info file", slot use of a learning file
+int learningMain(int argc, char *argv[]);
+
+#endif // LEARNING_H
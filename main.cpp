@@ -1,12 +1,62 @@
 #include "chessgui.h"
+#include "batcheval.h"
+#include "bench.h"
+#include "cluster.h"
+#include "explorer.h"
+#include "learning.h"
+#include "pgn.h"
+#include "recorder.h"
+#include "selfplay.h"
+#include "server.h"
+#include "tracer.h"
+#include "trainingdata.h"
+#include "tuner.h"
 
 #include <QApplication>
 
+#include <cstring>
+
+/*---------------------------------------------------------------------------*/
+// headless tools, picked by the first argument, no window is created
+typedef struct {
+    const char *name;
+    int (*run)(int argc, char *argv[]);
+} tool_t;
+
+static const tool_t tools[] = {
+    { "bench", benchMain },
+    { "cluster", clusterMain },
+    { "datagen", selfPlayMain },
+    { "datainfo", trainingInfoMain },
+    { "eval", batchEvalMain },
+    { "explorer", explorerMain },
+    { "learning", learningMain },
+    { "pgn", pgnMain },
+    { "record", recordMain },
+    { "server", serverMain },
+    { "tune", tunerMain }
+};
+
 /*---------------------------------------------------------------------------*/
 int main(int argc, char *argv[])
 {
+    for(size_t i = 0; argc > 1 && i < sizeof(tools) / sizeof(tools[0]); i++){
+        if(strcmp(argv[1], tools[i].name) == 0){
+            return tools[i].run(argc - 1, argv + 1);
+        }
+    }
+
     QApplication a(argc, argv);
+
+#ifdef SEARCH_TRACE
+    Tracer::setMarkersEnabled(qEnvironmentVariableIsSet(\
+                                  "AI_CHESS_TRACE_MARKERS"));
+#endif
+
     ChessGui w;
     w.show();
-    return a.exec();
+    int ret = a.exec();
+
+    TRACE_DUMP(); // written to TRACE_OUTPUT_FILE
+    return ret;
 }
@@ -13,6 +13,9 @@ Move::Move()
     this->to.x = 0;
     this->to.y = 0;
     this->pieceWasEaten = false;
+    this->prevHashKey = 0;
+    this->prevPawnHashKey = 0;
+    this->prevHalfmoveClock = 0;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -24,6 +27,9 @@ Move::Move(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, \
     this->to.x = x2;
     this->to.y = y2;
     this->movedPiece = piece;
+    this->prevHashKey = 0;
+    this->prevPawnHashKey = 0;
+    this->prevHalfmoveClock = 0;
 
     if(index >= 0){
         this->pieceWasEaten = true;
@@ -56,3 +62,26 @@ void Move::setEatenPieceIndex(int8_t index)
         this->pieceWasEaten = true;
     }
 }
+
+/*---------------------------------------------------------------------------*/
+bool Move::equals(const Move &move) const
+{
+    return this->from.x == move.from.x && this->from.y == move.from.y && \
+            this->to.x == move.to.x && this->to.y == move.to.y;
+}
+
+/*---------------------------------------------------------------------------*/
+uint16_t Move::packed() const
+{
+    return (uint16_t)((this->from.x << 9) | (this->from.y << 6) | \
+                      (this->to.x << 3) | this->to.y);
+}
+
+/*---------------------------------------------------------------------------*/
+void Move::setPacked(uint16_t packed)
+{
+    this->from.x = (packed >> 9) & 0x07;
+    this->from.y = (packed >> 6) & 0x07;
+    this->to.x = (packed >> 3) & 0x07;
+    this->to.y = packed & 0x07;
+}
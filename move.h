@@ -26,11 +26,18 @@ public:
     void setPositions(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2);
     void setMovedPiece(ChessPiece piece);
     void setEatenPieceIndex(int8_t index);
+    bool equals(const Move &move) const;
+    // 3 bits for each coordinate, fits the transposition table entry
+    uint16_t packed() const;
+    void setPacked(uint16_t packed);
     pos_t from;
     pos_t to;
     bool pieceWasEaten;
     int8_t eatenPieceIndex;
     ChessPiece movedPiece; // for holding prev setting
+    uint64_t prevHashKey;  // board hash before the move, restored on undo
+    uint64_t prevPawnHashKey;
+    uint16_t prevHalfmoveClock;
 };
 
 #endif // MOVE_H
@@ -0,0 +1,42 @@
+/*
+ * Move Cache - legal moves and attack maps of the last positions
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "movecache.h"
+
+#include <cstring>
+
+/*---------------------------------------------------------------------------*/
+MoveCache &threadMoveCache()
+{
+    static thread_local MoveCache cache;
+    return cache;
+}
+
+/*---------------------------------------------------------------------------*/
+MoveCache::MoveCache()
+{
+    // an empty entry has neither part, whatever its key
+    memset(entries, 0, sizeof(entries));
+}
+
+/*---------------------------------------------------------------------------*/
+const moveCacheEntry_t *MoveCache::probe(uint64_t key) const
+{
+    const moveCacheEntry_t *entry = &entries[key & (MOVE_CACHE_ENTRIES - 1)];
+    return entry->key == key ? entry : nullptr;
+}
+
+/*---------------------------------------------------------------------------*/
+moveCacheEntry_t *MoveCache::entry(uint64_t key)
+{
+    moveCacheEntry_t *entry = &entries[key & (MOVE_CACHE_ENTRIES - 1)];
+    if(entry->key != key){
+        entry->key = key;
+        entry->hasMoves = false;
+        entry->hasPressures = false;
+    }
+
+    return entry;
+}
@@ -0,0 +1,49 @@
+/*
+ * Move Cache - legal moves and attack maps of the last positions
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef MOVECACHE_H
+#define MOVECACHE_H
+
+#include <cstdint>
+
+/*---------------------------------------------------------------------------*/
+#define MOVE_CACHE_ENTRIES   64  // per thread, power of two
+#define MOVE_CACHE_MAX_MOVES 103 // MAX_MOVES_EACH_TURN
+#define MOVE_CACHE_BOXES     64  // x * 8 + y
+
+/*---------------------------------------------------------------------------*/
+// the moves are kept packed (Move::packed()) and the maps as counts, so
+// an entry does not depend on the piece order of the engine filling it
+typedef struct {
+    uint64_t key;      // zobrist key of the position, side to move included
+    bool hasMoves;
+    bool hasPressures;
+    uint8_t moveCount;
+    uint16_t moves[MOVE_CACHE_MAX_MOVES];
+    uint8_t pressures[MOVE_CACHE_BOXES]; // attacks of the side not to move
+} moveCacheEntry_t;
+
+/*---------------------------------------------------------------------------*/
+// the positions of a game are asked for again and again outside of the
+// tree: by the clicks and the end of turn checks of the gui, the check
+// marks of the notation, undo and scrubbing, and the root of the search
+class MoveCache
+{
+public:
+    MoveCache();
+
+    // nullptr on a miss
+    const moveCacheEntry_t *probe(uint64_t key) const;
+    // the entry of key, emptied if it held another position
+    moveCacheEntry_t *entry(uint64_t key);
+private:
+    moveCacheEntry_t entries[MOVE_CACHE_ENTRIES];
+};
+
+/*---------------------------------------------------------------------------*/
+// the engines of a thread share it, the gui and its board engine included
+MoveCache &threadMoveCache();
+
+#endif // MOVECACHE_H
@@ -0,0 +1,378 @@
+/*
+ * Move Generation - pseudo legal moves and attacks of the ChessEngine
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "chessengine.h"
+#include "movegen.h"
+
+/*---------------------------------------------------------------------------*/
+uint8_t ChessEngine::preparePseudoMoves(ChessPiece piece, Move *moves, \
+                                        uint8_t genType)
+{
+    // runtime values are turned into template arguments only here
+#define GEN_DISPATCH(side) \
+    switch(genType){ \
+        case GEN_CAPTURES: \
+            return generatePieceMoves<side, GEN_CAPTURES>(piece, moves); \
+        case GEN_QUIETS: \
+            return generatePieceMoves<side, GEN_QUIETS>(piece, moves); \
+        case GEN_EVASIONS: \
+            computeEvasionTargets<side>(); \
+            return generatePieceMoves<side, GEN_EVASIONS>(piece, moves); \
+        case GEN_ATTACKS: \
+            return generatePieceMoves<side, GEN_ATTACKS>(piece, moves); \
+        default: \
+            return generatePieceMoves<side, GEN_ALL>(piece, moves); \
+    }
+
+    if(piece.side() == SIDE_WHITE){
+        GEN_DISPATCH(SIDE_WHITE);
+    }
+    GEN_DISPATCH(SIDE_BLACK);
+
+#undef GEN_DISPATCH
+}
+
+/*---------------------------------------------------------------------------*/
+uint8_t ChessEngine::generateMoves(Move *moves, uint8_t genType)
+{
+#define GEN_DISPATCH(side) \
+    switch(genType){ \
+        case GEN_CAPTURES: \
+            return generateSideMoves<side, GEN_CAPTURES>(moves); \
+        case GEN_QUIETS: \
+            return generateSideMoves<side, GEN_QUIETS>(moves); \
+        case GEN_EVASIONS: \
+            computeEvasionTargets<side>(); \
+            return generateSideMoves<side, GEN_EVASIONS>(moves); \
+        case GEN_ATTACKS: \
+            return generateSideMoves<side, GEN_ATTACKS>(moves); \
+        default: \
+            return generateSideMoves<side, GEN_ALL>(moves); \
+    }
+
+    if(movementSide == SIDE_WHITE){
+        GEN_DISPATCH(SIDE_WHITE);
+    }
+    GEN_DISPATCH(SIDE_BLACK);
+
+#undef GEN_DISPATCH
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::isSquareAttacked(uint8_t x, uint8_t y, bool side)
+{
+    if(side == SIDE_WHITE){
+        return isSquareAttackedBy<SIDE_WHITE>(x, y);
+    }
+
+    return isSquareAttackedBy<SIDE_BLACK>(x, y);
+}
+
+/*---------------------------------------------------------------------------*/
+uint8_t ChessEngine::kingZoneAttacks(ChessPiece &king, bool side)
+{
+    uint8_t attacked = 0;
+    for(int8_t x = king.x() - 1; x <= king.x() + 1; x++){
+        for(int8_t y = king.y() - 1; y <= king.y() + 1; y++){
+            if(BOARD_ON(x, y) && isSquareAttacked(x, y, side)){
+                attacked++;
+            }
+        }
+    }
+
+    return attacked;
+}
+
+/*---------------------------------------------------------------------------*/
+template <bool Side, uint8_t GenType>
+uint8_t ChessEngine::generateSideMoves(Move *moves)
+{
+    uint8_t moveCount = 0;
+    for(uint8_t i = sidePieceStart(Side); \
+        i < sidePieceStart(Side) + TOTAL_PIECE_NUM / 2; i++){
+        if(chessPieces[i].onBoard()){
+            moveCount += generatePieceMoves<Side, GenType>(chessPieces[i], \
+                                                           &moves[moveCount]);
+        }
+    }
+
+    return moveCount;
+}
+
+/*---------------------------------------------------------------------------*/
+template <bool Side, uint8_t GenType>
+uint8_t ChessEngine::generatePieceMoves(ChessPiece &piece, Move *moves)
+{
+    uint8_t moveCount = 0;
+    int8_t x = piece.x();
+    int8_t y = piece.y();
+
+    switch (piece.type()){
+        case PIECE_BISHOP:
+            moveCount = generateSliderMoves<Side, GenType, \
+                    RAY_DIAGONAL_FIRST, RAY_STRAIGHT_FIRST>(x, y, moves);
+            break;
+        case PIECE_KING:
+            // king always may step out of a check
+            for(uint8_t i = 0; i < OFFSET_NUM; i++){
+                int8_t newX = x + rayOffsets[i][0];
+                int8_t newY = y + rayOffsets[i][1];
+
+                if(BOARD_ON(newX, newY) && \
+                   isTarget<Side, GenType == GEN_EVASIONS ? GEN_ALL : \
+                   GenType>(boardInfo[newX][newY].index, newX, newY)){
+                    moves[moveCount++].setPositions(x, y, newX, newY);
+                }
+            }
+
+            // TODO: Add castling movement.
+            break;
+        case PIECE_KNIGHT:
+            for(uint8_t i = 0; i < OFFSET_NUM; i++){
+                int8_t newX = x + knightOffsets[i][0];
+                int8_t newY = y + knightOffsets[i][1];
+
+                if(BOARD_ON(newX, newY) && isTarget<Side, GenType>\
+                        (boardInfo[newX][newY].index, newX, newY)){
+                    moves[moveCount++].setPositions(x, y, newX, newY);
+                }
+            }
+            break;
+        case PIECE_PAWN:
+        {
+            int8_t newY = y + pawnDirection(Side);
+            if(newY < 0 || newY >= BOARD_MATRIX_SIZE){
+                break;
+            }
+
+            // pushes, never attacks
+            if(GenType != GEN_CAPTURES && GenType != GEN_ATTACKS && \
+               boardInfo[x][newY].index == -1){
+                if(isTarget<Side, GenType>(-1, x, newY)){
+                    moves[moveCount++].setPositions(x, y, x, newY);
+                }
+
+                // 2 box forward only from the start rank
+                int8_t farY = newY + pawnDirection(Side);
+                if(y == pawnStartRank(Side) && \
+                   boardInfo[x][farY].index == -1 && \
+                   isTarget<Side, GenType>(-1, x, farY)){
+                    moves[moveCount++].setPositions(x, y, x, farY);
+
+                    // TODO: mark as 2 box forwarded for be edible
+                }
+            }
+
+            // w-left & b-right eat, then w-right & b-left eat
+            if(GenType != GEN_QUIETS){
+                for(int8_t newX = x - 1; newX <= x + 1; newX += 2){
+                    if(newX < 0 || newX >= BOARD_MATRIX_SIZE){
+                        continue;
+                    }
+
+                    int8_t index = boardInfo[newX][newY].index;
+                    if(GenType == GEN_ATTACKS || (index != -1 && \
+                       isTarget<Side, GenType>(index, newX, newY))){
+                        moves[moveCount++].setPositions(x, y, newX, newY);
+                    }
+                }
+            }
+        }
+            break;
+        case PIECE_QUEEN:
+            moveCount = generateSliderMoves<Side, GenType, \
+                    RAY_DIAGONAL_FIRST, RAY_LAST>(x, y, moves);
+            break;
+        case PIECE_ROOK:
+            moveCount = generateSliderMoves<Side, GenType, \
+                    RAY_STRAIGHT_FIRST, RAY_LAST>(x, y, moves);
+            break;
+    }
+
+    return moveCount;
+}
+
+/*---------------------------------------------------------------------------*/
+template <bool Side, uint8_t GenType, uint8_t FirstRay, uint8_t LastRay>
+uint8_t ChessEngine::generateSliderMoves(int8_t x, int8_t y, Move *moves)
+{
+    uint8_t moveCount = 0;
+
+    for(uint8_t ray = FirstRay; ray < LastRay; ray++){
+        int8_t dx = rayOffsets[ray][0];
+        int8_t dy = rayOffsets[ray][1];
+
+        for(int8_t i = x + dx, j = y + dy; BOARD_ON(i, j); i += dx, j += dy){
+            int8_t index = boardInfo[i][j].index;
+            if(isTarget<Side, GenType>(index, i, j)){
+                moves[moveCount++].setPositions(x, y, i, j);
+            }
+
+            if(index != -1){
+                // attacks go on behind the enemy king, so it can not step
+                // back on the same ray
+                if(GenType != GEN_ATTACKS || \
+                   chessPieces[index].type() != PIECE_KING || \
+                   chessPieces[index].side() == Side){
+                    break;
+                }
+            }
+        }
+    }
+
+    return moveCount;
+}
+
+/*---------------------------------------------------------------------------*/
+template <bool Side, uint8_t GenType>
+bool ChessEngine::isTarget(int8_t index, int8_t x, int8_t y)
+{
+    if(GenType == GEN_ATTACKS){
+        return true;
+    }
+
+    if(index != -1 && chessPieces[index].side() == Side){
+        return false;
+    }
+
+    if(GenType == GEN_CAPTURES){
+        return index != -1;
+    }
+    if(GenType == GEN_QUIETS){
+        return index == -1;
+    }
+    if(GenType == GEN_EVASIONS){
+        return (evasionTargets & BOARD_SQUARE_BIT(x, y)) != 0;
+    }
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+template <bool Side>
+bool ChessEngine::isSquareAttackedBy(int8_t x, int8_t y)
+{
+    // pawns attack forward, so look one rank behind the box
+    int8_t pawnY = y - pawnDirection(Side);
+    if(pawnY >= 0 && pawnY < BOARD_MATRIX_SIZE){
+        for(int8_t pawnX = x - 1; pawnX <= x + 1; pawnX += 2){
+            if(pawnX < 0 || pawnX >= BOARD_MATRIX_SIZE){
+                continue;
+            }
+
+            int8_t index = boardInfo[pawnX][pawnY].index;
+            if(index != -1 && chessPieces[index].side() == Side && \
+               chessPieces[index].type() == PIECE_PAWN){
+                return true;
+            }
+        }
+    }
+
+    for(uint8_t i = 0; i < OFFSET_NUM; i++){
+        int8_t newX = x + knightOffsets[i][0];
+        int8_t newY = y + knightOffsets[i][1];
+        if(BOARD_ON(newX, newY)){
+            int8_t index = boardInfo[newX][newY].index;
+            if(index != -1 && chessPieces[index].side() == Side && \
+               chessPieces[index].type() == PIECE_KNIGHT){
+                return true;
+            }
+        }
+    }
+
+    // first piece met on each ray, the king only when adjacent
+    for(uint8_t ray = 0; ray < OFFSET_NUM; ray++){
+        int8_t dx = rayOffsets[ray][0];
+        int8_t dy = rayOffsets[ray][1];
+        uint8_t slider = ray < RAY_STRAIGHT_FIRST ? PIECE_BISHOP : PIECE_ROOK;
+
+        for(int8_t i = x + dx, j = y + dy; BOARD_ON(i, j); i += dx, j += dy){
+            int8_t index = boardInfo[i][j].index;
+            if(index == -1){
+                continue;
+            }
+
+            ChessPiece &piece = chessPieces[index];
+            if(piece.side() == Side && (piece.type() == slider || \
+               piece.type() == PIECE_QUEEN || (piece.type() == PIECE_KING && \
+               i == x + dx && j == y + dy))){
+                return true;
+            }
+            break;
+        }
+    }
+
+    return false;
+}
+
+/*---------------------------------------------------------------------------*/
+template <bool Side>
+void ChessEngine::computeEvasionTargets()
+{
+    ChessPiece &king = chessPieces[Side == SIDE_WHITE ? whiteKingIndex : \
+                                                        blackKingIndex];
+    int8_t x = king.x();
+    int8_t y = king.y();
+    uint8_t checkers = 0;
+    evasionTargets = 0;
+
+    int8_t pawnY = y + pawnDirection(Side);
+    if(pawnY >= 0 && pawnY < BOARD_MATRIX_SIZE){
+        for(int8_t pawnX = x - 1; pawnX <= x + 1; pawnX += 2){
+            if(pawnX < 0 || pawnX >= BOARD_MATRIX_SIZE){
+                continue;
+            }
+
+            int8_t index = boardInfo[pawnX][pawnY].index;
+            if(index != -1 && chessPieces[index].side() != Side && \
+               chessPieces[index].type() == PIECE_PAWN){
+                evasionTargets |= BOARD_SQUARE_BIT(pawnX, pawnY);
+                checkers++;
+            }
+        }
+    }
+
+    for(uint8_t i = 0; i < OFFSET_NUM; i++){
+        int8_t newX = x + knightOffsets[i][0];
+        int8_t newY = y + knightOffsets[i][1];
+        if(BOARD_ON(newX, newY)){
+            int8_t index = boardInfo[newX][newY].index;
+            if(index != -1 && chessPieces[index].side() != Side && \
+               chessPieces[index].type() == PIECE_KNIGHT){
+                evasionTargets |= BOARD_SQUARE_BIT(newX, newY);
+                checkers++;
+            }
+        }
+    }
+
+    // a slider check is also answered by blocking the boxes in between
+    for(uint8_t ray = 0; ray < OFFSET_NUM; ray++){
+        int8_t dx = rayOffsets[ray][0];
+        int8_t dy = rayOffsets[ray][1];
+        uint8_t slider = ray < RAY_STRAIGHT_FIRST ? PIECE_BISHOP : PIECE_ROOK;
+        uint64_t between = 0;
+
+        for(int8_t i = x + dx, j = y + dy; BOARD_ON(i, j); i += dx, j += dy){
+            int8_t index = boardInfo[i][j].index;
+            between |= BOARD_SQUARE_BIT(i, j);
+            if(index == -1){
+                continue;
+            }
+
+            ChessPiece &piece = chessPieces[index];
+            if(piece.side() != Side && (piece.type() == slider || \
+               piece.type() == PIECE_QUEEN)){
+                evasionTargets |= between;
+                checkers++;
+            }
+            break;
+        }
+    }
+
+    // only the king can answer a double check
+    if(checkers > 1){
+        evasionTargets = 0;
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * Move Generation - compile time tables for the templated generators
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include "chesspiece.h"
+
+#include <cstdint>
+
+/*---------------------------------------------------------------------------*/
+// move generation types
+#define GEN_ALL      0
+#define GEN_CAPTURES 1
+#define GEN_QUIETS   2
+#define GEN_EVASIONS 3 // king moves and moves landing on evasionTargets
+#define GEN_ATTACKS  4 // attacked boxes, own pieces and x-ray through king
+
+/*---------------------------------------------------------------------------*/
+#define OFFSET_NUM         8
+#define RAY_DIAGONAL_FIRST 0 // rays 0 .. 3 are diagonal
+#define RAY_STRAIGHT_FIRST 4 // rays 4 .. 7 are straight
+#define RAY_LAST           8
+
+#define BOARD_ON(x, y)         ((x) >= 0 && (x) < 8 && (y) >= 0 && (y) < 8)
+#define BOARD_SQUARE_BIT(x, y) (1ULL << ((y) * 8 + (x)))
+
+/*---------------------------------------------------------------------------*/
+constexpr int8_t knightOffsets[OFFSET_NUM][2] = {
+  { -1, -2 },
+  { -2, -1 },
+  { -2, 1 },
+  { -1, 2 },
+  { 1, 2 },
+  { 2, 1 },
+  { 2, -1 },
+  { 1, -2 }
+};
+
+// sliding directions, also the king offsets
+constexpr int8_t rayOffsets[OFFSET_NUM][2] = {
+  { -1, 1 },
+  { -1, -1 },
+  { 1, 1 },
+  { 1, -1 },
+  { -1, 0 },
+  { 1, 0 },
+  { 0, -1 },
+  { 0, 1 }
+};
+
+/*---------------------------------------------------------------------------*/
+constexpr int8_t pawnDirection(bool side)
+{
+    return side == SIDE_WHITE ? 1 : -1;
+}
+
+constexpr uint8_t pawnStartRank(bool side)
+{
+    return side == SIDE_WHITE ? 1 : 6;
+}
+
+// black pieces in first half, white pieces in second half
+constexpr uint8_t sidePieceStart(bool side)
+{
+    return side == SIDE_WHITE ? 16 : 0;
+}
+
+#endif // MOVEGEN_H
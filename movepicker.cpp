@@ -0,0 +1,250 @@
+/*
+ * MovePicker Class - staged, lazily generated legal moves for the search
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "movepicker.h"
+#include "transposition.h"
+
+#include <cstdlib>
+
+/*---------------------------------------------------------------------------*/
+#define MVV_LVA_VICTIM_WEIGHT 16
+
+/*---------------------------------------------------------------------------*/
+MovePicker::MovePicker(ChessEngine *board, uint16_t ttMove, Move *killers, \
+                       bool capturesOnly, bool inCheck)
+{
+    this->board = board;
+    this->stage = capturesOnly ? PICK_STAGE_GEN_CAPTURES : PICK_STAGE_TT;
+    this->lastQuiet = false;
+    this->capturesOnly = capturesOnly;
+    this->inCheck = inCheck;
+
+    this->hasTTMove = (ttMove != TT_NO_MOVE);
+    this->ttMove.setPacked(ttMove);
+
+    for(uint8_t i = 0; i < KILLER_MOVE_NUM; i++){
+        if(killers != nullptr){
+            this->killers[i] = killers[i];
+        }
+    }
+    this->killerOffset = 0;
+    this->triedCount = 0;
+
+    this->captureCount = 0;
+    this->captureOffset = 0;
+    this->badCaptureCount = 0;
+    this->badCaptureOffset = 0;
+    this->quietCount = 0;
+    this->quietOffset = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+bool MovePicker::next(Move *move)
+{
+    while(true){
+        switch(stage){
+            case PICK_STAGE_TT:
+                // hash move is only verified, nothing is generated for it
+                stage = PICK_STAGE_GEN_CAPTURES;
+                if(hasTTMove && isPseudoLegal(&ttMove, GEN_ALL) && \
+                   isLegal(&ttMove)){
+                    tried[triedCount++] = ttMove;
+                    lastQuiet = board->boardInfo[ttMove.to.x]\
+                            [ttMove.to.y].index == -1;
+                    (*move) = ttMove;
+                    return true;
+                }
+                break;
+            case PICK_STAGE_GEN_CAPTURES:
+            {
+                Move generated[MAX_MOVES_EACH_TURN];
+                uint8_t count = board->generateMoves(generated, \
+                        inCheck ? GEN_EVASIONS : GEN_CAPTURES);
+
+                // losing captures wait until quiet moves are tried, quiet
+                // evasions are kept for their own stage
+                for(uint8_t i = 0; i < count; i++){
+                    if(board->boardInfo[generated[i].to.x]\
+                            [generated[i].to.y].index == -1){
+                        quiets[quietCount++] = generated[i];
+                        continue;
+                    }
+
+                    int score = captureScore(&generated[i]);
+                    if(score >= 0){
+                        captureScores[captureCount] = score;
+                        captures[captureCount++] = generated[i];
+                    } else if(!capturesOnly){
+                        badCaptures[badCaptureCount++] = generated[i];
+                    }
+                }
+                stage = PICK_STAGE_GOOD_CAPTURES;
+            }
+                break;
+            case PICK_STAGE_GOOD_CAPTURES:
+                while(pickBest(captures, captureScores, captureCount, \
+                               &captureOffset, move)){
+                    if(!alreadyTried(move) && isLegal(move)){
+                        lastQuiet = false;
+                        return true;
+                    }
+                }
+                stage = capturesOnly ? PICK_STAGE_DONE : PICK_STAGE_KILLERS;
+                break;
+            case PICK_STAGE_KILLERS:
+                while(killerOffset < KILLER_MOVE_NUM){
+                    Move killer = killers[killerOffset++];
+                    if(killer.packed() == TT_NO_MOVE || alreadyTried(&killer)){
+                        continue;
+                    }
+
+                    if(isPseudoLegal(&killer, GEN_QUIETS) && isLegal(&killer)){
+                        tried[triedCount++] = killer;
+                        lastQuiet = true;
+                        (*move) = killer;
+                        return true;
+                    }
+                }
+                stage = PICK_STAGE_GEN_QUIETS;
+                break;
+            case PICK_STAGE_GEN_QUIETS:
+                // only reached when nothing above caused a cutoff
+                if(!inCheck){
+                    quietCount = board->generateMoves(quiets, GEN_QUIETS);
+                }
+                stage = PICK_STAGE_QUIETS;
+                break;
+            case PICK_STAGE_QUIETS:
+                while(quietOffset < quietCount){
+                    (*move) = quiets[quietOffset++];
+                    if(!alreadyTried(move) && isLegal(move)){
+                        lastQuiet = true;
+                        return true;
+                    }
+                }
+                stage = PICK_STAGE_BAD_CAPTURES;
+                break;
+            case PICK_STAGE_BAD_CAPTURES:
+                while(badCaptureOffset < badCaptureCount){
+                    (*move) = badCaptures[badCaptureOffset++];
+                    if(!alreadyTried(move) && isLegal(move)){
+                        lastQuiet = false;
+                        return true;
+                    }
+                }
+                stage = PICK_STAGE_DONE;
+                break;
+            default:
+                return false;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+bool MovePicker::lastWasQuiet()
+{
+    return lastQuiet;
+}
+
+/*---------------------------------------------------------------------------*/
+bool MovePicker::isPseudoLegal(Move *move, uint8_t genType)
+{
+    int8_t index = board->boardInfo[move->from.x][move->from.y].index;
+    if(index < 0){
+        return false;
+    }
+
+    ChessPiece piece = board->chessPieces[index];
+    if(!piece.onBoard() || piece.side() != board->movementSide){
+        return false;
+    }
+
+    int8_t target = board->boardInfo[move->to.x][move->to.y].index;
+    if(target != -1 && (genType == GEN_QUIETS || \
+                        board->chessPieces[target].side() == piece.side())){
+        return false;
+    }
+
+    // only the moving piece is generated to confirm the move
+    Move moves[MAX_POSSIBLE_MOVE];
+    uint8_t count = board->preparePseudoMoves(piece, moves, genType);
+    for(uint8_t i = 0; i < count; i++){
+        if(moves[i].equals(*move)){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*---------------------------------------------------------------------------*/
+bool MovePicker::isLegal(Move *move)
+{
+    return board->checkKingPressure(move);
+}
+
+/*---------------------------------------------------------------------------*/
+bool MovePicker::alreadyTried(Move *move)
+{
+    for(uint8_t i = 0; i < triedCount; i++){
+        if(tried[i].equals(*move)){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*---------------------------------------------------------------------------*/
+int MovePicker::captureScore(Move *move)
+{
+    ChessPiece attacker = board->chessPieces\
+            [board->boardInfo[move->from.x][move->from.y].index];
+    ChessPiece victim = board->chessPieces\
+            [board->boardInfo[move->to.x][move->to.y].index];
+
+    // king only captures undefended pieces, it never loses material
+    int attackerValue = 0;
+    if(attacker.type() != PIECE_KING){
+        attackerValue = abs(attacker.point());
+    }
+    int victimValue = abs(victim.point());
+
+    // cheaper attacker can not lose, the exchange is only resolved when
+    // the attacker is worth more than the victim
+    if(victimValue < attackerValue && board->staticExchange(move) < 0){
+        return -1; // bad capture
+    }
+
+    return victimValue * MVV_LVA_VICTIM_WEIGHT - attackerValue;
+}
+
+/*---------------------------------------------------------------------------*/
+bool MovePicker::pickBest(Move *moves, int *scores, uint8_t count, \
+                          uint8_t *offset, Move *move)
+{
+    if(*offset >= count){
+        return false;
+    }
+
+    // selection step, the rest stays unsorted until needed
+    uint8_t best = *offset;
+    for(uint8_t i = *offset + 1; i < count; i++){
+        if(scores[i] > scores[best]){
+            best = i;
+        }
+    }
+
+    Move tempMove = moves[*offset];
+    moves[*offset] = moves[best];
+    moves[best] = tempMove;
+
+    int tempScore = scores[*offset];
+    scores[*offset] = scores[best];
+    scores[best] = tempScore;
+
+    (*move) = moves[(*offset)++];
+    return true;
+}
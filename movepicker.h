@@ -0,0 +1,70 @@
+/*
+ * MovePicker Class - staged, lazily generated legal moves for the search
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef MOVEPICKER_H
+#define MOVEPICKER_H
+
+#include "chessengine.h"
+#include "move.h"
+
+/*---------------------------------------------------------------------------*/
+#define PICK_STAGE_TT            0
+#define PICK_STAGE_GEN_CAPTURES  1
+#define PICK_STAGE_GOOD_CAPTURES 2
+#define PICK_STAGE_KILLERS       3
+#define PICK_STAGE_GEN_QUIETS    4
+#define PICK_STAGE_QUIETS        5
+#define PICK_STAGE_BAD_CAPTURES  6
+#define PICK_STAGE_DONE          7
+
+/*---------------------------------------------------------------------------*/
+// captures with a negative static exchange are bad, others ordered by
+// MVV-LVA (most valuable victim, least valuable attacker)
+class MovePicker
+{
+public:
+    MovePicker(ChessEngine *board, uint16_t ttMove, Move *killers, \
+               bool capturesOnly = false, bool inCheck = false);
+    // gives the next legal move, false when all moves are consumed
+    bool next(Move *move);
+    bool lastWasQuiet();
+private:
+    bool isPseudoLegal(Move *move, uint8_t genType);
+    bool isLegal(Move *move);
+    bool alreadyTried(Move *move);
+    int captureScore(Move *move);
+    bool pickBest(Move *moves, int *scores, uint8_t count, \
+                  uint8_t *offset, Move *move);
+
+    ChessEngine *board;
+    uint8_t stage;
+    bool lastQuiet;
+    bool capturesOnly; // quiescence, losing captures are dropped too
+    bool inCheck;      // only evasions are generated, all at once
+
+    Move ttMove;
+    bool hasTTMove;
+    Move killers[KILLER_MOVE_NUM];
+    uint8_t killerOffset;
+
+    // moves given before their own stage, skipped when met again
+    Move tried[KILLER_MOVE_NUM + 1];
+    uint8_t triedCount;
+
+    Move captures[MAX_MOVES_EACH_TURN];
+    int captureScores[MAX_MOVES_EACH_TURN];
+    uint8_t captureCount;
+    uint8_t captureOffset;
+
+    Move badCaptures[MAX_MOVES_EACH_TURN];
+    uint8_t badCaptureCount;
+    uint8_t badCaptureOffset;
+
+    Move quiets[MAX_MOVES_EACH_TURN];
+    uint8_t quietCount;
+    uint8_t quietOffset;
+};
+
+#endif // MOVEPICKER_H
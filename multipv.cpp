@@ -0,0 +1,160 @@
+/*
+ * Multi-PV Search - best root moves of a position with their variations
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "chessengine.h"
+#include "searchstats.h"
+#include "tracer.h"
+
+#include <algorithm>
+#include <cstring>
+
+/*---------------------------------------------------------------------------*/
+uint8_t ChessEngine::searchMultiPv(int depth, uint8_t lineCount, \
+                                   pvLine_t *lines, \
+                                   const pvReport_t &report, \
+                                   uint32_t timeLimitMs, \
+                                   const uint16_t *searchMoves, \
+                                   uint8_t searchMoveCount)
+{
+    Move rootMoves[MAX_MOVES_EACH_TURN];
+    uint8_t rootCount = getAllMoves(rootMoves);
+
+    beginSearch(timeLimitMs);
+
+    // the moves not asked for stay excluded in all passes, in front of
+    // the ones the passes add
+    uint8_t outsideCount = 0;
+    for(uint8_t i = 0; searchMoves != nullptr && i < rootCount; i++){
+        uint16_t packed = rootMoves[i].packed();
+        if(std::find(searchMoves, searchMoves + searchMoveCount, packed) == \
+           searchMoves + searchMoveCount){
+            excludedRootMoves[outsideCount++] = packed;
+        }
+    }
+
+    lineCount = std::min(lineCount, std::min<uint8_t>(\
+                             rootCount - outsideCount, MULTIPV_MAX_LINES));
+    if(lineCount == 0){
+        return 0;
+    }
+
+    uint8_t finished = 0; // lines of the last finished iteration
+    for(int iteration = 1; iteration <= depth; iteration++){
+        pvLine_t found[MULTIPV_MAX_LINES];
+        STATS_CALL(beginIteration(iteration));
+
+        excludedRootCount = outsideCount;
+        for(uint8_t i = 0; i < lineCount; i++){
+            TRACE_SCOPE_ARG("multiPvPass", i);
+
+            // the move of the same rank goes first, the window is around
+            // its score. it may already be excluded, then the picker
+            // skips it like the others
+            bestMove = i < finished ? lines[i].moves[0] : Move();
+            int score = aspirationSearch(iteration, \
+                                         i < finished ? lines[i].score : 0);
+            if(searchAborted()){
+                break;
+            }
+
+            extractLine(bestMove, iteration, &found[i]);
+            found[i].rank = i;
+            found[i].score = score;
+            excludedRootMoves[excludedRootCount++] = bestMove.packed();
+
+            if(report){
+                report(found[i]);
+            }
+        }
+        excludedRootCount = 0;
+        STATS_CALL(endIteration());
+
+        // a cut iteration is thrown, even the lines it has reported
+        if(searchAborted()){
+            break;
+        }
+
+        // a later pass may still score higher, the search is not stable
+        std::stable_sort(found, found + lineCount, \
+                         [](const pvLine_t &a, const pvLine_t &b){
+            return a.score > b.score;
+        });
+        for(uint8_t i = 0; i < lineCount; i++){
+            lines[i] = found[i];
+            lines[i].rank = i;
+        }
+        finished = lineCount;
+        timeLimited = timeLimitMs > 0;
+    }
+
+    if(finished > 0){
+        bestMove = lines[0].moves[0];
+    }
+    return finished;
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::lineToSan(const pvLine_t &line, char *text, size_t size)
+{
+    size_t used = 0;
+    uint8_t played = 0;
+    text[0] = '\0';
+
+    for(uint8_t i = 0; i < line.length; i++){
+        char san[SAN_MAX_LENGTH];
+        moveToSan(line.moves[i], san);
+        size_t length = strlen(san);
+        if(used + length + 2 > size){
+            break;
+        }
+
+        if(used > 0){
+            text[used++] = ' ';
+        }
+        memcpy(text + used, san, length + 1);
+        used += length;
+
+        makeMove(line.moves[i]);
+        played++;
+    }
+
+    while(played-- > 0){
+        undoLastMove();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::extractLine(Move first, int depth, pvLine_t *line)
+{
+    line->depth = depth;
+    line->length = 1;
+    line->moves[0] = first;
+    makeMove(first);
+
+    // the table keeps the best move of every exact node. a repetition
+    // would go on forever, the line is never longer than the search
+    Move move;
+    while(line->length < std::min(depth, PV_MAX_LENGTH) && \
+          getHashMove(&move)){
+        line->moves[line->length++] = move;
+        makeMove(move);
+    }
+
+    for(uint8_t i = 0; i < line->length; i++){
+        undoLastMove();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::isExcludedRootMove(uint16_t packed)
+{
+    for(uint8_t i = 0; i < excludedRootCount; i++){
+        if(excludedRootMoves[i] == packed){
+            return true;
+        }
+    }
+
+    return false;
+}
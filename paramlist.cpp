@@ -0,0 +1,52 @@
+/*
+ * Parameter List - "name=value,name=value" runtime option strings
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "paramlist.h"
+
+#include <cstdlib>
+#include <cstring>
+
+/*---------------------------------------------------------------------------*/
+#define PARAM_PAIR_MAX_LEN 64
+
+/*---------------------------------------------------------------------------*/
+bool parseParamList(const char *spec, const paramSetter_t &set)
+{
+    if(spec == nullptr){
+        return false;
+    }
+
+    bool allValid = true;
+    const char *cursor = spec;
+    while(*cursor != '\0'){
+        const char *end = strchr(cursor, ',');
+        size_t len = end ? (size_t)(end - cursor) : strlen(cursor);
+
+        char pair[PARAM_PAIR_MAX_LEN];
+        if(len < sizeof(pair)){
+            memcpy(pair, cursor, len);
+            pair[len] = '\0';
+
+            char *eq = strchr(pair, '=');
+            if(eq != nullptr){
+                *eq = '\0';
+                if(!set(pair, atoi(eq + 1))){
+                    allValid = false;
+                }
+            } else if(len > 0){
+                allValid = false;
+            }
+        } else{
+            allValid = false;
+        }
+
+        cursor += len;
+        if(*cursor == ','){
+            cursor++;
+        }
+    }
+
+    return allValid;
+}
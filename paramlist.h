@@ -0,0 +1,20 @@
+/*
+ * Parameter List - "name=value,name=value" runtime option strings
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef PARAMLIST_H
+#define PARAMLIST_H
+
+#include <functional>
+
+/*---------------------------------------------------------------------------*/
+// a pair of the list, false if the name or the value is not taken
+typedef std::function<bool(const char *name, int value)> paramSetter_t;
+
+/*---------------------------------------------------------------------------*/
+// set is called for each pair in order. false if spec is null or a pair
+// is malformed or not taken, the other pairs are still set
+bool parseParamList(const char *spec, const paramSetter_t &set);
+
+#endif // PARAMLIST_H
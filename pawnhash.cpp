@@ -0,0 +1,169 @@
+/*
+ * Pawn Hash Table - cached pawn structure evaluation
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "pawnhash.h"
+#include "searchstats.h"
+
+#include <cstring>
+
+/*---------------------------------------------------------------------------*/
+#define FILE_A_MASK 0x0101010101010101ULL
+#define FILE_H_MASK (FILE_A_MASK << 7)
+#define SHELTER_MAX_RANK 3 // own pawns further than this give no cover
+
+/*---------------------------------------------------------------------------*/
+PawnHashTable &threadPawnHashTable()
+{
+    static thread_local PawnHashTable table;
+    return table;
+}
+
+/*---------------------------------------------------------------------------*/
+PawnHashTable::PawnHashTable()
+{
+    memset(entries, 0, sizeof(entries));
+    // key 0 with no pawns would falsely hit, make the empty slots invalid
+    for(uint32_t i = 0; i < PAWN_HASH_ENTRIES; i++){
+        entries[i].key = ~0ULL;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+const pawnEntry_t *PawnHashTable::probe(uint64_t key, uint64_t whitePawns, \
+                                        uint64_t blackPawns)
+{
+    pawnEntry_t *entry = &entries[key & (PAWN_HASH_ENTRIES - 1)];
+
+    STATS_INC(pawnProbes);
+    if(entry->key == key){
+        STATS_INC(pawnHits);
+        return entry;
+    }
+
+    evaluate(whitePawns, blackPawns, entry);
+    entry->key = key;
+
+    return entry;
+}
+
+/*---------------------------------------------------------------------------*/
+static uint64_t shiftForward(uint64_t bits, uint8_t side)
+{
+    return side == PAWN_SIDE_WHITE ? (bits << 8) : (bits >> 8);
+}
+
+/*---------------------------------------------------------------------------*/
+static uint64_t pawnAttacks(uint64_t pawns, uint8_t side)
+{
+    uint64_t forward = shiftForward(pawns, side);
+    return ((forward & ~FILE_A_MASK) >> 1) | ((forward & ~FILE_H_MASK) << 1);
+}
+
+/*---------------------------------------------------------------------------*/
+// all squares in front of the given ones, the squares excluded
+static uint64_t frontFill(uint64_t bits, uint8_t side)
+{
+    uint64_t fill = 0;
+    for(uint8_t i = 0; i < 7; i++){
+        bits = shiftForward(bits, side);
+        fill |= bits;
+    }
+    return fill;
+}
+
+/*---------------------------------------------------------------------------*/
+void PawnHashTable::evaluate(uint64_t whitePawns, uint64_t blackPawns, \
+                             pawnEntry_t *entry)
+{
+    uint64_t pawns[2];
+    pawns[PAWN_SIDE_BLACK] = blackPawns;
+    pawns[PAWN_SIDE_WHITE] = whitePawns;
+
+    int8_t terms[2][EVAL_PAWN_TERM_NUM];
+    memset(terms, 0, sizeof(terms));
+
+    for(uint8_t side = 0; side < 2; side++){
+        uint64_t own = pawns[side];
+
+        entry->attacks[side] = pawnAttacks(own, side);
+        entry->attackSpans[side] = frontFill(entry->attacks[side], side) | \
+                entry->attacks[side];
+        entry->passedFiles[side] = 0;
+        memset(entry->shelterRanks[side], 0, sizeof(entry->shelterRanks[side]));
+    }
+
+    for(uint8_t side = 0; side < 2; side++){
+        uint8_t enemy = side ^ 1;
+        uint64_t own = pawns[side];
+
+        for(uint8_t square = 0; square < 64; square++){
+            uint64_t bit = 1ULL << square;
+            if(!(own & bit)){
+                continue;
+            }
+
+            uint8_t x = square % 8;
+            uint8_t y = square / 8;
+            uint8_t relativeRank = (side == PAWN_SIDE_WHITE) ? y : (7 - y);
+            uint64_t file = FILE_A_MASK << x;
+            uint64_t adjacentFiles = ((file & ~FILE_A_MASK) >> 1) | \
+                    ((file & ~FILE_H_MASK) << 1);
+            uint64_t front = frontFill(bit, side);
+
+            if(entry->shelterRanks[side][x] == 0 || \
+               relativeRank < entry->shelterRanks[side][x]){
+                entry->shelterRanks[side][x] = relativeRank;
+            }
+
+            // doubled, counted once for each pawn behind another one
+            if(front & own){
+                terms[side][EVAL_PAWN_DOUBLED - EVAL_PAWN_TERM_FIRST]++;
+            }
+
+            uint64_t stop = shiftForward(bit, side);
+            if(!(own & adjacentFiles)){
+                terms[side][EVAL_PAWN_ISOLATED - EVAL_PAWN_TERM_FIRST]++;
+            } else if(!(entry->attackSpans[side] & stop) && \
+                      (entry->attacks[enemy] & stop)){
+                // no own pawn can guard its way and it can not advance
+                terms[side][EVAL_PAWN_BACKWARD - EVAL_PAWN_TERM_FIRST]++;
+            }
+
+            // no enemy pawn in front on its own or the adjacent files
+            uint64_t neighbours = bit | ((bit & ~FILE_A_MASK) >> 1) | \
+                    ((bit & ~FILE_H_MASK) << 1);
+            if(!(pawns[enemy] & frontFill(neighbours, side))){
+                // relative rank 1 .. 6 are the reachable ones
+                if(relativeRank > 0 && relativeRank < 7){
+                    terms[side][EVAL_PASSED_RANK2 - EVAL_PAWN_TERM_FIRST + \
+                            relativeRank - 1]++;
+                }
+                entry->passedFiles[side] |= (1 << x);
+            }
+        }
+    }
+
+    for(uint8_t i = 0; i < EVAL_PAWN_TERM_NUM; i++){
+        entry->terms[i] = terms[PAWN_SIDE_WHITE][i] - terms[PAWN_SIDE_BLACK][i];
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+int PawnHashTable::shelterHoles(const pawnEntry_t *entry, uint8_t side, \
+                                uint8_t kingX)
+{
+    int holes = 0;
+    uint8_t startX = kingX > 0 ? kingX - 1 : 0;
+    uint8_t endX = kingX < 7 ? kingX + 1 : 7;
+
+    for(uint8_t x = startX; x <= endX; x++){
+        uint8_t rank = entry->shelterRanks[side][x];
+        if(rank == 0 || rank > SHELTER_MAX_RANK){
+            holes++;
+        }
+    }
+
+    return holes;
+}
@@ -0,0 +1,56 @@
+/*
+ * Pawn Hash Table - cached pawn structure evaluation
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef PAWNHASH_H
+#define PAWNHASH_H
+
+#include "evalparams.h"
+
+#include <cstdint>
+
+/*---------------------------------------------------------------------------*/
+#define PAWN_HASH_ENTRIES 16384 // per thread, power of two
+#define PAWN_SIDE_BLACK   0
+#define PAWN_SIDE_WHITE   1
+
+// square bit of the pawn bitboards, a1 = 0, b1 = 1 .. h8 = 63
+#define PAWN_SQUARE_BIT(x, y) (1ULL << ((y) * 8 + (x)))
+
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    uint64_t key;
+    uint64_t attacks[2];     // squares attacked by pawns now
+    uint64_t attackSpans[2]; // squares pawns may attack while advancing
+    // white minus black counts, in EVAL_PAWN_TERM_FIRST order, the
+    // weights are applied on probe so the table does not depend on them
+    int8_t terms[EVAL_PAWN_TERM_NUM];
+    uint8_t passedFiles[2];  // file mask of passed pawns
+    // relative rank of the rearmost own pawn on each file, 0 if none
+    uint8_t shelterRanks[2][8];
+} pawnEntry_t;
+
+/*---------------------------------------------------------------------------*/
+class PawnHashTable
+{
+public:
+    PawnHashTable();
+
+    // fills the entry from the table or evaluates and caches it
+    const pawnEntry_t *probe(uint64_t key, uint64_t whitePawns, \
+                             uint64_t blackPawns);
+    static void evaluate(uint64_t whitePawns, uint64_t blackPawns, \
+                         pawnEntry_t *entry);
+    // king files without a close own pawn, for EVAL_PAWN_SHELTER
+    static int shelterHoles(const pawnEntry_t *entry, uint8_t side, \
+                            uint8_t kingX);
+private:
+    pawnEntry_t entries[PAWN_HASH_ENTRIES];
+};
+
+/*---------------------------------------------------------------------------*/
+// the table is small and searched hot, each thread keeps its own
+PawnHashTable &threadPawnHashTable();
+
+#endif // PAWNHASH_H
@@ -0,0 +1,641 @@
+/*
+ * PGN - streaming game reader, movetext tokenizer and game writer
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "pgn.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*---------------------------------------------------------------------------*/
+#define PGN_NOT_MARKER      -2
+#define PGN_MOVE_NUMBER_LEN 24 // "%zu. " of any size_t
+#define PGN_TT_SIZE_MB      1 // replay needs no search
+#define SECONDS_IN_MINUTE   60.0
+
+typedef struct {
+    uint64_t games;
+    uint64_t moves;
+    uint64_t complete; // every move of the game was decoded
+} pgnStats_t;
+
+/*---------------------------------------------------------------------------*/
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+/*---------------------------------------------------------------------------*/
+static bool isDelimiter(char c)
+{
+    return isSpace(c) || c == '{' || c == '(' || c == ')' || c == ';' || \
+            c == '$';
+}
+
+/*---------------------------------------------------------------------------*/
+static const char *skipLine(const char *p, const char *end)
+{
+    const char *newline = (const char *)memchr(p, '\n', end - p);
+    return newline ? newline + 1 : end;
+}
+
+/*---------------------------------------------------------------------------*/
+static const char *skipComment(const char *p, const char *end)
+{
+    const char *close = (const char *)memchr(p, '}', end - p);
+    return close ? close + 1 : end;
+}
+
+/*---------------------------------------------------------------------------*/
+static const char *skipVariation(const char *p, const char *end)
+{
+    int depth = 0;
+    while(p < end){
+        if(*p == '{'){
+            p = skipComment(p, end);
+            continue;
+        } else if(*p == ';'){
+            p = skipLine(p, end);
+            continue;
+        } else if(*p == '('){
+            depth++;
+        } else if(*p == ')' && --depth == 0){
+            return p + 1;
+        }
+        p++;
+    }
+
+    return end;
+}
+
+/*---------------------------------------------------------------------------*/
+// PGN_RESULT_* of the marker at p, PGN_NOT_MARKER if there is none
+static int8_t terminationMarker(const char *p, const char *end, \
+                                size_t *length)
+{
+    static const struct {
+        const char *text;
+        int8_t result;
+    } markers[] = {
+        { "1-0", PGN_RESULT_WHITE },
+        { "0-1", PGN_RESULT_BLACK },
+        { "1/2-1/2", PGN_RESULT_DRAW },
+        { "*", PGN_RESULT_UNKNOWN }
+    };
+
+    for(const auto &marker : markers){
+        size_t markerLength = strlen(marker.text);
+        if((size_t)(end - p) >= markerLength && \
+           memcmp(p, marker.text, markerLength) == 0 && \
+           (p + markerLength == end || isDelimiter(p[markerLength]))){
+            *length = markerLength;
+            return marker.result;
+        }
+    }
+
+    return PGN_NOT_MARKER;
+}
+
+/*---------------------------------------------------------------------------*/
+static const char *resultText(int8_t result)
+{
+    switch(result){
+        case PGN_RESULT_WHITE:
+            return "1-0";
+        case PGN_RESULT_BLACK:
+            return "0-1";
+        case PGN_RESULT_DRAW:
+            return "1/2-1/2";
+        default:
+            return "*";
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+PgnReader::PgnReader()
+{
+    map = nullptr;
+    mapSize = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+PgnReader::~PgnReader()
+{
+    close();
+}
+
+/*---------------------------------------------------------------------------*/
+bool PgnReader::open(const char *path)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0){
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size == 0){
+        ::close(fd);
+        return false;
+    }
+
+    mapSize = info.st_size;
+    map = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file
+
+    if(map == MAP_FAILED){
+        map = nullptr;
+        mapSize = 0;
+        return false;
+    }
+
+    // read front to back, let the kernel read ahead
+    madvise(map, mapSize, MADV_SEQUENTIAL);
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+void PgnReader::close()
+{
+    if(map != nullptr){
+        munmap(map, mapSize);
+    }
+
+    map = nullptr;
+    mapSize = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+const char *PgnReader::data() const
+{
+    return (const char *)map;
+}
+
+/*---------------------------------------------------------------------------*/
+size_t PgnReader::size() const
+{
+    return mapSize;
+}
+
+/*---------------------------------------------------------------------------*/
+PgnParser::PgnParser(const char *begin, const char *end)
+{
+    this->cursor = begin;
+    this->end = end;
+}
+
+/*---------------------------------------------------------------------------*/
+bool PgnParser::next(pgnGame_t *game)
+{
+    while(cursor < end && isSpace(*cursor)){
+        cursor++;
+    }
+    if(cursor >= end){
+        return false;
+    }
+
+    game->tags.data = cursor;
+    game->tags.length = 0;
+    while(cursor < end && *cursor == '['){
+        cursor = skipLine(cursor, end);
+        game->tags.length = cursor - game->tags.data;
+        while(cursor < end && isSpace(*cursor)){
+            cursor++;
+        }
+    }
+
+    // movetext up to the marker, or up to the next tag section
+    game->moves.data = cursor;
+    game->result = PGN_RESULT_UNKNOWN;
+    while(cursor < end){
+        char c = *cursor;
+        if(c == '{'){
+            cursor = skipComment(cursor, end);
+            continue;
+        } else if(c == ';'){
+            cursor = skipLine(cursor, end);
+            continue;
+        }
+
+        if(c == '[' && cursor > game->moves.data && cursor[-1] == '\n'){
+            break;
+        } else if((c == '1' || c == '0' || c == '*') && \
+                  (cursor == game->moves.data || isSpace(cursor[-1]) || \
+                   cursor[-1] == '}' || cursor[-1] == ')')){
+            size_t length;
+            int8_t result = terminationMarker(cursor, end, &length);
+            if(result != PGN_NOT_MARKER){
+                game->moves.length = cursor - game->moves.data;
+                game->result = result;
+                cursor += length;
+                return true;
+            }
+        }
+        cursor++;
+    }
+
+    game->moves.length = cursor - game->moves.data;
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+bool PgnParser::nextMove(const char **cursor, const char *end, pgnText_t *san)
+{
+    const char *p = *cursor;
+    while(p < end){
+        char c = *p;
+        if(isSpace(c) || c == '.' || c == '!' || c == '?' || c == ')'){
+            p++;
+            continue;
+        } else if(c == '{'){
+            p = skipComment(p, end);
+            continue;
+        } else if(c == ';'){
+            p = skipLine(p, end);
+            continue;
+        } else if(c == '('){
+            p = skipVariation(p, end);
+            continue;
+        } else if(c == '$'){
+            // numeric annotation glyph
+            p++;
+            while(p < end && *p >= '0' && *p <= '9'){
+                p++;
+            }
+            continue;
+        }
+
+        size_t length;
+        if(terminationMarker(p, end, &length) != PGN_NOT_MARKER){
+            *cursor = p + length;
+            return false;
+        }
+
+        const char *tokenEnd = p;
+        while(tokenEnd < end && !isDelimiter(*tokenEnd)){
+            tokenEnd++;
+        }
+
+        // move numbers, "12." or "12...", castling may be written "0-0"
+        if(c >= '0' && c <= '9' && \
+           !(tokenEnd - p >= 3 && p[0] == '0' && p[1] == '-')){
+            while(p < tokenEnd && *p >= '0' && *p <= '9'){
+                p++;
+            }
+            continue;
+        }
+
+        san->data = p;
+        san->length = tokenEnd - p;
+        *cursor = tokenEnd;
+        return true;
+    }
+
+    *cursor = p;
+    return false;
+}
+
+/*---------------------------------------------------------------------------*/
+bool PgnParser::findTag(const pgnGame_t *game, const char *name, \
+                        pgnText_t *value)
+{
+    size_t nameLength = strlen(name);
+    const char *p = game->tags.data;
+    const char *end = p + game->tags.length;
+
+    while(p < end){
+        const char *lineEnd = skipLine(p, end);
+        if(*p == '[' && (size_t)(lineEnd - p) > nameLength + 1 && \
+           memcmp(p + 1, name, nameLength) == 0 && \
+           isSpace(p[nameLength + 1])){
+            const char *open = (const char *)memchr(p, '"', lineEnd - p);
+            const char *close = open;
+            do{
+                close = open ? (const char *)memchr(close + 1, '"', \
+                                                    lineEnd - close - 1) \
+                             : nullptr;
+            } while(close != nullptr && close[-1] == '\\');
+
+            if(open != nullptr && close != nullptr){
+                value->data = open + 1;
+                value->length = close - open - 1;
+                return true;
+            }
+        }
+        p = lineEnd;
+    }
+
+    return false;
+}
+
+/*---------------------------------------------------------------------------*/
+const char *PgnParser::gameStart(const char *from, const char *begin, \
+                                 const char *end)
+{
+    if(from <= begin){
+        return begin;
+    }
+
+    // a tag line which does not follow another tag line
+    const char *p = from - 1;
+    while(p < end){
+        const char *newline = (const char *)memchr(p, '\n', end - p);
+        if(newline == nullptr || newline + 1 >= end){
+            break;
+        }
+
+        if(newline[1] == '['){
+            const char *lineStart = newline;
+            while(lineStart > begin && lineStart[-1] != '\n'){
+                lineStart--;
+            }
+            while(lineStart < newline && isSpace(*lineStart)){
+                lineStart++;
+            }
+            if(*lineStart != '['){
+                return newline + 1;
+            }
+        }
+        p = newline + 1;
+    }
+
+    return end;
+}
+
+/*---------------------------------------------------------------------------*/
+std::vector<const char *> PgnParser::splitRanges(const char *begin, \
+                                                 const char *end, \
+                                                 unsigned parts)
+{
+    std::vector<const char *> bounds;
+    for(unsigned i = 0; i < parts; i++){
+        bounds.push_back(gameStart(begin + (end - begin) / parts * i, \
+                                   begin, end));
+    }
+    bounds.push_back(end);
+
+    return bounds;
+}
+
+/*---------------------------------------------------------------------------*/
+PgnRecorder::PgnRecorder()
+{
+    clear();
+}
+
+/*---------------------------------------------------------------------------*/
+void PgnRecorder::clear()
+{
+    static const char *roster[][2] = {
+        { "Event", "?" }, { "Site", "?" }, { "Date", "????.??.??" },
+        { "Round", "?" }, { "White", "?" }, { "Black", "?" },
+        { "Result", "*" }
+    };
+
+    tags.clear();
+    for(const auto &tag : roster){
+        tags.push_back(std::make_pair(tag[0], tag[1]));
+    }
+    moves.clear();
+    result = PGN_RESULT_UNKNOWN;
+}
+
+/*---------------------------------------------------------------------------*/
+void PgnRecorder::setTag(const char *name, const char *value)
+{
+    for(size_t i = 0; i < tags.size(); i++){
+        if(tags[i].first == name){
+            tags[i].second = value;
+            return;
+        }
+    }
+
+    tags.push_back(std::make_pair(name, value));
+}
+
+/*---------------------------------------------------------------------------*/
+void PgnRecorder::addMove(const char *san)
+{
+    moves.push_back(san);
+}
+
+/*---------------------------------------------------------------------------*/
+void PgnRecorder::removeLastMove()
+{
+    if(!moves.empty()){
+        moves.pop_back();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void PgnRecorder::setResult(int8_t result)
+{
+    this->result = result;
+    setTag("Result", resultText(result));
+}
+
+/*---------------------------------------------------------------------------*/
+size_t PgnRecorder::moveCount() const
+{
+    return moves.size();
+}
+
+/*---------------------------------------------------------------------------*/
+std::string PgnRecorder::text() const
+{
+    std::string out;
+    for(size_t i = 0; i < tags.size(); i++){
+        out += "[" + tags[i].first + " \"";
+        for(char c : tags[i].second){
+            if(c == '"' || c == '\\'){
+                out += '\\';
+            }
+            out += c;
+        }
+        out += "\"]\n";
+    }
+    out += "\n";
+
+    // movetext wrapped at the line width, the marker ends it
+    size_t lineLength = 0;
+    for(size_t i = 0; i <= moves.size(); i++){
+        std::string token;
+        if(i == moves.size()){
+            token = resultText(result);
+        } else if(i % 2 == 0){
+            char number[PGN_MOVE_NUMBER_LEN];
+            snprintf(number, sizeof(number), "%zu. ", i / 2 + 1);
+            token = number + moves[i];
+        } else{
+            token = moves[i];
+        }
+
+        if(lineLength > 0 && lineLength + 1 + token.size() > PGN_LINE_WIDTH){
+            out += "\n";
+            lineLength = 0;
+        } else if(lineLength > 0){
+            out += " ";
+            lineLength++;
+        }
+        out += token;
+        lineLength += token.size();
+    }
+    out += "\n\n";
+
+    return out;
+}
+
+/*---------------------------------------------------------------------------*/
+PgnWriter::PgnWriter()
+{
+    file = nullptr;
+}
+
+/*---------------------------------------------------------------------------*/
+PgnWriter::~PgnWriter()
+{
+    close();
+}
+
+/*---------------------------------------------------------------------------*/
+bool PgnWriter::open(const char *path, bool append)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if(file != nullptr){
+        fclose(file);
+    }
+    file = fopen(path, append ? "a" : "w");
+
+    return file != nullptr;
+}
+
+/*---------------------------------------------------------------------------*/
+void PgnWriter::close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if(file != nullptr){
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+bool PgnWriter::write(const PgnRecorder &game)
+{
+    std::string text = game.text();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return file != nullptr && \
+            fwrite(text.data(), 1, text.size(), file) == text.size();
+}
+
+/*---------------------------------------------------------------------------*/
+static void replayRange(const char *begin, const char *end, bool replay, \
+                        pgnStats_t *stats)
+{
+    ChessEngine engine(PGN_TT_SIZE_MB);
+    PgnParser parser(begin, end);
+    pgnGame_t game;
+
+    while(parser.next(&game)){
+        stats->games++;
+        engine.resetPosition();
+
+        const char *cursor = game.moves.data;
+        const char *movesEnd = cursor + game.moves.length;
+        pgnText_t san;
+        bool complete = true;
+        while(PgnParser::nextMove(&cursor, movesEnd, &san)){
+            Move move;
+            uint8_t promotionType;
+            if(replay){
+                if(!engine.sanToMove(san.data, san.length, &move, \
+                                     &promotionType)){
+                    complete = false; // castling, en passant or illegal
+                    break;
+                }
+                engine.playMove(move, promotionType, false);
+            }
+            stats->moves++;
+        }
+
+        if(complete && replay){
+            stats->complete++;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+int pgnMain(int argc, char *argv[])
+{
+    unsigned threads = 0;
+    bool replay = true;
+    const char *path = nullptr;
+
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "-t") == 0 && i + 1 < argc){
+            threads = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-n") == 0){
+            replay = false;
+        } else{
+            path = argv[i];
+        }
+    }
+
+    PgnReader reader;
+    if(path == nullptr || !reader.open(path)){
+        fprintf(stderr, "usage: pgn [-t threads] [-n] file\n");
+        return 1;
+    }
+    if(threads == 0){
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::chrono::steady_clock::time_point start = \
+            std::chrono::steady_clock::now();
+
+    std::vector<const char *> bounds = PgnParser::splitRanges(\
+                reader.data(), reader.data() + reader.size(), threads);
+
+    std::vector<pgnStats_t> stats(threads);
+    std::vector<std::thread> workers;
+    for(unsigned i = 0; i < threads; i++){
+        memset(&stats[i], 0, sizeof(pgnStats_t));
+        workers.push_back(std::thread(replayRange, bounds[i], bounds[i + 1], \
+                                      replay, &stats[i]));
+    }
+
+    pgnStats_t total;
+    memset(&total, 0, sizeof(total));
+    for(unsigned i = 0; i < threads; i++){
+        workers[i].join();
+        total.games += stats[i].games;
+        total.moves += stats[i].moves;
+        total.complete += stats[i].complete;
+    }
+
+    double seconds = std::chrono::duration<double>(\
+                std::chrono::steady_clock::now() - start).count();
+    double megabytes = reader.size() / BYTES_IN_MB;
+    fprintf(stderr, "%llu games, %llu moves, %llu fully replayed\n", \
+            (unsigned long long)total.games, \
+            (unsigned long long)total.moves, \
+            (unsigned long long)total.complete);
+    fprintf(stderr, "%.1f MB in %.3f s, %.0f MB/s, %.0f games/min\n", \
+            megabytes, seconds, seconds > 0.0 ? megabytes / seconds : 0.0, \
+            seconds > 0.0 ? total.games / seconds * SECONDS_IN_MINUTE : 0.0);
+
+    return 0;
+}
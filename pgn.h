@@ -0,0 +1,130 @@
+/*
+ * PGN - streaming game reader, movetext tokenizer and game writer
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef PGN_H
+#define PGN_H
+
+#include "chessengine.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+#define PGN_RESULT_BLACK   -1
+#define PGN_RESULT_DRAW    0
+#define PGN_RESULT_WHITE   1
+#define PGN_RESULT_UNKNOWN 2 // "*" or no termination marker
+
+#define PGN_LINE_WIDTH 79 // movetext lines are wrapped before this
+
+#define BYTES_IN_MB (1024.0 * 1024.0) // for the reports of the tools
+
+/*---------------------------------------------------------------------------*/
+// a piece of the mapped file, nothing is copied
+typedef struct {
+    const char *data;
+    size_t length;
+} pgnText_t;
+
+typedef struct {
+    pgnText_t tags;  // tag pair lines, "[Name \"value\"]"
+    pgnText_t moves; // movetext without the termination marker
+    int8_t result;   // PGN_RESULT_*
+} pgnGame_t;
+
+/*---------------------------------------------------------------------------*/
+// whole file mapped read only, games are parsed in place
+class PgnReader
+{
+public:
+    PgnReader();
+    ~PgnReader();
+
+    bool open(const char *path);
+    void close();
+    const char *data() const;
+    size_t size() const;
+private:
+    void *map;
+    size_t mapSize;
+};
+
+/*---------------------------------------------------------------------------*/
+// walks the games of a range, ranges starting at gameStart() can be
+// parsed by separate threads
+class PgnParser
+{
+public:
+    PgnParser(const char *begin, const char *end);
+
+    bool next(pgnGame_t *game);
+
+    // next SAN token of the movetext, numbers, comments, variations and
+    // annotations are skipped. false at the end of the movetext
+    static bool nextMove(const char **cursor, const char *end, \
+                         pgnText_t *san);
+    static bool findTag(const pgnGame_t *game, const char *name, \
+                        pgnText_t *value);
+    // first tag section at or after from, end if there is none
+    static const char *gameStart(const char *from, const char *begin, \
+                                 const char *end);
+    // parts + 1 bounds of equal byte ranges, each moved forward to the
+    // start of a game. a range may be empty
+    static std::vector<const char *> splitRanges(const char *begin, \
+                                                 const char *end, \
+                                                 unsigned parts);
+private:
+    const char *cursor;
+    const char *end;
+};
+
+/*---------------------------------------------------------------------------*/
+// moves of one game from the start position, written as export format
+class PgnRecorder
+{
+public:
+    PgnRecorder();
+
+    void clear();
+    // the seven tag roster is always written, other tags follow it
+    void setTag(const char *name, const char *value);
+    void addMove(const char *san);
+    void removeLastMove();
+    void setResult(int8_t result);
+    size_t moveCount() const;
+    std::string text() const;
+private:
+    std::vector<std::pair<std::string, std::string> > tags;
+    std::vector<std::string> moves;
+    int8_t result;
+};
+
+/*---------------------------------------------------------------------------*/
+// games are appended whole, shared by the generator threads
+class PgnWriter
+{
+public:
+    PgnWriter();
+    ~PgnWriter();
+
+    bool open(const char *path, bool append = false);
+    void close();
+    bool write(const PgnRecorder &game);
+private:
+    std::mutex mutex;
+    FILE *file;
+};
+
+/*---------------------------------------------------------------------------*/
+// "pgn [-t threads] [-n] file", replays every game through the SAN
+// decoder, -n only tokenizes
+int pgnMain(int argc, char *argv[]);
+
+#endif // PGN_H
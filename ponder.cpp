@@ -0,0 +1,86 @@
+/*
+ * Ponder - background search on the opponent's time
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "ponder.h"
+#include "tracer.h"
+
+/*---------------------------------------------------------------------------*/
+Ponder::Ponder(TranspositionTable *sharedTable) : engine(sharedTable)
+{
+    expectedKey = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+Ponder::~Ponder()
+{
+    stop();
+}
+
+/*---------------------------------------------------------------------------*/
+void Ponder::start(const packedPosition_t *position, const uint64_t *keys, \
+                   uint32_t keyCount, uint16_t clock, Move predicted, \
+                   int depth)
+{
+    stop();
+
+    if(!engine.unpackPosition(position)){
+        return;
+    }
+    // the predicted move adds its own key and clock on top
+    engine.setRuleHistory(keys, keyCount, clock);
+
+    // only the boxes are taken, the piece fields are of the other engine
+    Move move;
+    move.setPacked(predicted.packed());
+    engine.playMove(move);
+
+    expectedKey = engine.positionKey();
+    engine.stopSearch(false);
+    worker = std::thread(run, &engine, depth);
+}
+
+/*---------------------------------------------------------------------------*/
+void Ponder::stop()
+{
+    if(worker.joinable()){
+        engine.stopSearch();
+        worker.join();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+bool Ponder::matches(uint64_t key)
+{
+    return worker.joinable() && key == expectedKey;
+}
+
+/*---------------------------------------------------------------------------*/
+Move Ponder::wait()
+{
+    if(worker.joinable()){
+        worker.join();
+    }
+
+    return engine.getBestMove();
+}
+
+/*---------------------------------------------------------------------------*/
+void Ponder::setLearningFile(LearningFile *file)
+{
+    engine.setLearningFile(file);
+}
+
+/*---------------------------------------------------------------------------*/
+void Ponder::setTreeRecorder(TreeRecorder *recorder)
+{
+    engine.setTreeRecorder(recorder);
+}
+
+/*---------------------------------------------------------------------------*/
+void Ponder::run(ChessEngine *engine, int depth)
+{
+    TRACE_SCOPE("ponder");
+    engine->search(depth);
+}
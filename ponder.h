@@ -0,0 +1,46 @@
+/*
+ * Ponder - background search on the opponent's time
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef PONDER_H
+#define PONDER_H
+
+#include "chessengine.h"
+
+#include <cstdint>
+#include <thread>
+
+/*---------------------------------------------------------------------------*/
+// the predicted reply is played on an engine of its own and the answer
+// is searched while the opponent thinks. the table is shared with the
+// playing engine, so a stopped search still warms up the next one. the
+// playing engine must not search while this one runs
+class Ponder
+{
+public:
+    explicit Ponder(TranspositionTable *sharedTable);
+    ~Ponder();
+
+    // position is the one the predicted move is played in, keys and clock
+    // are its game for the draw rules (see ChessEngine::setRuleHistory)
+    void start(const packedPosition_t *position, const uint64_t *keys, \
+               uint32_t keyCount, uint16_t clock, Move predicted, int depth);
+    // abandons the search, what it stored in the table stays
+    void stop();
+    // the running search is of the position with this key
+    bool matches(uint64_t key);
+    // lets the search finish, its best move
+    Move wait();
+    // not while a search runs
+    void setLearningFile(LearningFile *file);
+    void setTreeRecorder(TreeRecorder *recorder);
+private:
+    static void run(ChessEngine *engine, int depth);
+
+    ChessEngine engine;
+    std::thread worker;
+    uint64_t expectedKey;
+};
+
+#endif // PONDER_H
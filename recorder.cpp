@@ -0,0 +1,460 @@
+/*
+ * Tree Recorder - visited search nodes kept in a binary file for analysis
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "recorder.h"
+#include "chessengine.h"
+#include "stack.cpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*---------------------------------------------------------------------------*/
+static const char *reasonNames[RECORD_REASON_NUM] = {
+    "low", "exact", "high", "table", "futility", "null", "leaf", "nomoves", \
+    "aborted", "draw", "matedistance"
+};
+
+/*---------------------------------------------------------------------------*/
+TreeRecorder::TreeRecorder()
+{
+    fd = -1;
+    maxPly = RECORD_DEFAULT_MAX_PLY;
+    run = 0;
+    writerCount = 0;
+    budget = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+TreeRecorder::~TreeRecorder()
+{
+    close();
+}
+
+/*---------------------------------------------------------------------------*/
+bool TreeRecorder::open(const char *path, int maxPly, uint64_t maxNodes)
+{
+    close();
+
+    int headerFd = path ? ::open(path, O_RDWR | O_CREAT, 0644) : -1;
+    if(headerFd < 0){
+        return false;
+    }
+
+    // the run number is taken under the lock, other processes may open
+    // the file at the same time
+    recordHeader_t header;
+    bool valid = flock(headerFd, LOCK_EX) == 0;
+    ssize_t length = valid ? pread(headerFd, &header, sizeof(header), 0) : -1;
+    if(length == 0){
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, RECORD_MAGIC, RECORD_MAGIC_LENGTH);
+        header.nodeSize = sizeof(recordNode_t);
+    } else if(length != sizeof(header) || \
+              memcmp(header.magic, RECORD_MAGIC, RECORD_MAGIC_LENGTH) != 0 || \
+              header.nodeSize != sizeof(recordNode_t) || \
+              header.runCount >= UINT16_MAX){
+        valid = false;
+    }
+    if(valid){
+        header.runCount++;
+        valid = pwrite(headerFd, &header, sizeof(header), 0) == \
+                sizeof(header);
+    }
+    ::close(headerFd); // unlocks
+
+    // appended nodes never overwrite the ones of other writers
+    fd = valid ? ::open(path, O_WRONLY | O_APPEND) : -1;
+    if(fd < 0){
+        return false;
+    }
+
+    this->maxPly = std::min(std::max(maxPly, 0), (int)UINT8_MAX);
+    run = header.runCount;
+    writerCount = 0;
+    budget = maxNodes;
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+void TreeRecorder::close()
+{
+    if(fd >= 0){
+        ::close(fd);
+    }
+
+    fd = -1;
+}
+
+/*---------------------------------------------------------------------------*/
+bool TreeRecorder::isOpen() const
+{
+    return fd >= 0;
+}
+
+/*---------------------------------------------------------------------------*/
+int TreeRecorder::getMaxPly() const
+{
+    return maxPly;
+}
+
+/*---------------------------------------------------------------------------*/
+uint16_t TreeRecorder::getRun() const
+{
+    return run;
+}
+
+/*---------------------------------------------------------------------------*/
+uint16_t TreeRecorder::addWriter()
+{
+    return writerCount++;
+}
+
+/*---------------------------------------------------------------------------*/
+bool TreeRecorder::write(const recordNode_t *nodes, size_t count)
+{
+    if(fd < 0){
+        return false;
+    }
+
+    uint64_t left = budget.load();
+    uint64_t taken;
+    do{
+        taken = std::min((uint64_t)count, left);
+    } while(!budget.compare_exchange_weak(left, left - taken));
+
+    // one write per buffer, the mutex keeps the buffers of the threads
+    // whole on file systems without atomic appends
+    if(taken > 0){
+        std::lock_guard<std::mutex> lock(writeMutex);
+        size_t size = taken * sizeof(recordNode_t);
+        if(::write(fd, nodes, size) != (ssize_t)size){
+            budget = 0;
+            return false;
+        }
+    }
+
+    return taken == count;
+}
+
+/*---------------------------------------------------------------------------*/
+RecordWriter::RecordWriter(TreeRecorder *recorder)
+{
+    this->recorder = recorder;
+    writer = recorder->addWriter();
+    maxPly = recorder->getMaxPly();
+    nextNode = 0;
+    count = 0;
+    path[0] = RECORD_NO_PARENT;
+}
+
+/*---------------------------------------------------------------------------*/
+RecordWriter::~RecordWriter()
+{
+    flush();
+}
+
+/*---------------------------------------------------------------------------*/
+int RecordWriter::getMaxPly() const
+{
+    return maxPly;
+}
+
+/*---------------------------------------------------------------------------*/
+uint32_t RecordWriter::enter(int ply)
+{
+    path[ply] = nextNode;
+    return nextNode++;
+}
+
+/*---------------------------------------------------------------------------*/
+uint32_t RecordWriter::parentOf(int ply) const
+{
+    return ply > 0 ? path[ply - 1] : RECORD_NO_PARENT;
+}
+
+/*---------------------------------------------------------------------------*/
+void RecordWriter::add(recordNode_t &node)
+{
+    node.run = recorder->getRun();
+    node.writer = writer;
+    buffer[count++] = node;
+    if(count == RECORD_BUFFER_NODES){
+        flush();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void RecordWriter::flush()
+{
+    // the nodes still open when the budget runs out are lost, their
+    // recorded children are orphans
+    if(count > 0 && !recorder->write(buffer, count)){
+        maxPly = -1;
+    }
+    count = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::setTreeRecorder(TreeRecorder *recorder)
+{
+    delete recordWriter;
+    recordWriter = recorder != nullptr ? new RecordWriter(recorder) : nullptr;
+}
+
+/*---------------------------------------------------------------------------*/
+int ChessEngine::recordNode(int depth, int ply, int alpha, int beta, \
+                            bool allowNull)
+{
+    recordNode_t node;
+    memset(&node, 0, sizeof(node));
+    node.node = recordWriter->enter(ply);
+    node.parent = recordWriter->parentOf(ply);
+    node.move = RECORD_NO_MOVE;
+    Move last;
+    if(ply > 0 && allowNull && movePool->peek(&last)){
+        node.move = last.packed();
+    }
+    node.depth = (int8_t)std::min(std::max(depth, INT8_MIN), INT8_MAX);
+    node.ply = ply;
+    node.alpha = alpha;
+    node.beta = beta;
+
+    node.score = searchNode(depth, ply, alpha, beta, allowNull);
+    node.reason = nodeReason;
+    recordWriter->add(node);
+    // the tree of each iteration is on file when it is finished
+    if(ply == 0){
+        recordWriter->flush();
+    }
+
+    return node.score;
+}
+
+/*---------------------------------------------------------------------------*/
+// the reader, children are found by the writer and id of their parent
+typedef struct {
+    const recordNode_t *nodes;
+    size_t count;
+    std::vector<uint32_t> byParent; // indexes by run, writer and parent
+    std::vector<uint32_t> roots;    // in file order
+} recordIndex_t;
+
+/*---------------------------------------------------------------------------*/
+static uint64_t writerKey(const recordNode_t &node)
+{
+    return ((uint64_t)node.run << 16) | node.writer;
+}
+
+/*---------------------------------------------------------------------------*/
+static void buildIndex(recordIndex_t *index)
+{
+    const recordNode_t *nodes = index->nodes;
+    for(uint32_t i = 0; i < index->count; i++){
+        if(nodes[i].parent == RECORD_NO_PARENT){
+            index->roots.push_back(i);
+        } else{
+            index->byParent.push_back(i);
+        }
+    }
+
+    // children in the order they were entered
+    std::sort(index->byParent.begin(), index->byParent.end(), \
+              [nodes](uint32_t a, uint32_t b){
+        if(writerKey(nodes[a]) != writerKey(nodes[b])){
+            return writerKey(nodes[a]) < writerKey(nodes[b]);
+        }
+        return nodes[a].parent != nodes[b].parent ? \
+                    nodes[a].parent < nodes[b].parent : \
+                    nodes[a].node < nodes[b].node;
+    });
+}
+
+/*---------------------------------------------------------------------------*/
+static std::pair<std::vector<uint32_t>::const_iterator, \
+                 std::vector<uint32_t>::const_iterator>
+findChildren(const recordIndex_t &index, const recordNode_t &parent)
+{
+    const recordNode_t *nodes = index.nodes;
+    auto before = [nodes](uint32_t a, const recordNode_t &parent){
+        return writerKey(nodes[a]) != writerKey(parent) ? \
+                    writerKey(nodes[a]) < writerKey(parent) : \
+                    nodes[a].parent < parent.node;
+    };
+    auto after = [nodes](const recordNode_t &parent, uint32_t a){
+        return writerKey(parent) != writerKey(nodes[a]) ? \
+                    writerKey(parent) < writerKey(nodes[a]) : \
+                    parent.node < nodes[a].parent;
+    };
+    return std::make_pair(std::lower_bound(index.byParent.begin(), \
+                                           index.byParent.end(), parent, \
+                                           before), \
+                          std::upper_bound(index.byParent.begin(), \
+                                           index.byParent.end(), parent, \
+                                           after));
+}
+
+/*---------------------------------------------------------------------------*/
+static void moveToText(uint16_t move, char *text)
+{
+    if(move == RECORD_NO_MOVE){
+        strcpy(text, "-");
+        return;
+    }
+
+    // from x, from y, to x, to y in 3 bits each, see Move::packed()
+    snprintf(text, 5, "%c%c%c%c", 'a' + ((move >> 9) & 7), \
+             '1' + ((move >> 6) & 7), 'a' + ((move >> 3) & 7), \
+             '1' + (move & 7));
+}
+
+/*---------------------------------------------------------------------------*/
+static void printNode(const recordNode_t &node, int indent)
+{
+    char move[5];
+    moveToText(node.move, move);
+    printf("%*s%s depth %d [%d,%d] %d %s\n", indent * 2, "", move, \
+           node.depth, node.alpha, node.beta, node.score, \
+           node.reason < RECORD_REASON_NUM ? reasonNames[node.reason] : "?");
+}
+
+/*---------------------------------------------------------------------------*/
+static void printTree(const recordIndex_t &index, const recordNode_t &node, \
+                      int indent, int plies)
+{
+    printNode(node, indent);
+    if(plies == 0){
+        return;
+    }
+
+    auto children = findChildren(index, node);
+    for(auto i = children.first; i != children.second; i++){
+        printTree(index, index.nodes[*i], indent + 1, plies - 1);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+int recordMain(int argc, char *argv[])
+{
+    bool valid = argc >= 3 && (strcmp(argv[1], "info") == 0 || \
+                               strcmp(argv[1], "roots") == 0 || \
+                               strcmp(argv[1], "tree") == 0);
+    bool tree = valid && strcmp(argv[1], "tree") == 0;
+    size_t rootIndex = 0;
+    const char *rootMove = nullptr;
+    int plies = -1; // the whole subtree
+    if(valid && tree){
+        valid = argc >= 4;
+        rootIndex = valid ? strtoul(argv[3], nullptr, 10) : 0;
+        for(int i = 4; valid && i < argc; i++){
+            if(strcmp(argv[i], "-p") == 0 && i + 1 < argc){
+                plies = atoi(argv[++i]);
+            } else if(rootMove == nullptr && strlen(argv[i]) == 4){
+                rootMove = argv[i];
+            } else{
+                valid = false;
+            }
+        }
+    } else if(valid){
+        valid = argc == 3;
+    }
+    if(!valid){
+        fprintf(stderr, "usage: record info file\n"
+                        "       record roots file\n"
+                        "       record tree file root [move] [-p plies]\n");
+        return 1;
+    }
+
+    int fd = ::open(argv[2], O_RDONLY);
+    struct stat info;
+    recordHeader_t *header = nullptr;
+    if(fd >= 0 && fstat(fd, &info) == 0 && \
+       info.st_size >= (off_t)sizeof(recordHeader_t)){
+        void *map = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        header = map != MAP_FAILED ? (recordHeader_t *)map : nullptr;
+    }
+    if(fd >= 0){
+        ::close(fd); // the mapping keeps the file
+    }
+    if(header == nullptr || \
+       memcmp(header->magic, RECORD_MAGIC, RECORD_MAGIC_LENGTH) != 0 || \
+       header->nodeSize != sizeof(recordNode_t)){
+        fprintf(stderr, "%s is not a record file\n", argv[2]);
+        return 1;
+    }
+
+    // a buffer cut by a crash leaves a partial node at the end
+    recordIndex_t index;
+    index.nodes = (const recordNode_t *)(header + 1);
+    index.count = (info.st_size - sizeof(recordHeader_t)) / \
+            sizeof(recordNode_t);
+    buildIndex(&index);
+
+    if(strcmp(argv[1], "info") == 0){
+        size_t reasons[RECORD_REASON_NUM] = { 0 };
+        std::vector<uint64_t> writers;
+        for(size_t i = 0; i < index.count; i++){
+            const recordNode_t &node = index.nodes[i];
+            writers.push_back(writerKey(node));
+            if(node.reason < RECORD_REASON_NUM){
+                reasons[node.reason]++;
+            }
+        }
+        std::sort(writers.begin(), writers.end());
+        writers.erase(std::unique(writers.begin(), writers.end()), \
+                      writers.end());
+        printf("runs %u writers %zu nodes %zu roots %zu\n", \
+               header->runCount, writers.size(), index.count, \
+               index.roots.size());
+        for(uint8_t i = 0; i < RECORD_REASON_NUM; i++){
+            printf("%s %zu\n", reasonNames[i], reasons[i]);
+        }
+    } else if(strcmp(argv[1], "roots") == 0){
+        for(size_t i = 0; i < index.roots.size(); i++){
+            const recordNode_t &root = index.nodes[index.roots[i]];
+            auto children = findChildren(index, root);
+            printf("%zu run %u writer %u moves %zu ", i, root.run, \
+                   root.writer, (size_t)(children.second - children.first));
+            printNode(root, 0);
+        }
+    } else if(rootIndex >= index.roots.size()){
+        fprintf(stderr, "there are %zu roots\n", index.roots.size());
+        return 1;
+    } else{
+        const recordNode_t &root = index.nodes[index.roots[rootIndex]];
+        if(rootMove == nullptr){
+            printTree(index, root, 0, plies);
+            return 0;
+        }
+
+        auto children = findChildren(index, root);
+        bool found = false;
+        for(auto i = children.first; i != children.second; i++){
+            char move[5];
+            moveToText(index.nodes[*i].move, move);
+            if(strcmp(move, rootMove) == 0){
+                // a move searched again shows each of its searches
+                printTree(index, index.nodes[*i], 0, plies);
+                found = true;
+            }
+        }
+        if(!found){
+            fprintf(stderr, "%s is not searched at root %zu\n", rootMove, \
+                    rootIndex);
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * Tree Recorder - visited search nodes kept in a binary file for analysis
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+/*---------------------------------------------------------------------------*/
+#define RECORD_FILE_ENV          "AI_CHESS_RECORD_FILE"
+#define RECORD_MAX_PLY_ENV       "AI_CHESS_RECORD_MAX_PLY"
+#define RECORD_MAX_NODES_ENV     "AI_CHESS_RECORD_MAX_NODES"
+#define RECORD_MAGIC             "AICREC01"
+#define RECORD_MAGIC_LENGTH      8
+#define RECORD_DEFAULT_MAX_PLY   4        // deeper nodes are not recorded
+#define RECORD_DEFAULT_MAX_NODES 10000000 // per opening of the file, 320MB
+#define RECORD_BUFFER_NODES      4096     // of a writer, written at once
+#define RECORD_NO_PARENT         0xFFFFFFFF
+#define RECORD_NO_MOVE           0        // a1a1 is never played
+
+// how a node was left
+#define RECORD_FAIL_LOW          0 // no move above alpha, an upper bound
+#define RECORD_EXACT             1
+#define RECORD_FAIL_HIGH         2 // a move reached beta, a lower bound
+#define RECORD_TABLE             3 // bound of the table or the learning file
+#define RECORD_REVERSE_FUTILITY  4
+#define RECORD_NULL_MOVE         5
+#define RECORD_LEAF              6 // quiescence score at depth 0
+#define RECORD_NO_MOVES          7 // mate or stalemate
+#define RECORD_ABORTED           8 // stopped or out of time, not a score
+#define RECORD_DRAW              9 // repetition or fifty move rule
+#define RECORD_MATE_DISTANCE     10 // a shorter mate is already known
+#define RECORD_REASON_NUM        11
+
+/*---------------------------------------------------------------------------*/
+// 32 bytes, the file is the header followed by the nodes. writers append
+// whole buffers, so the nodes of one writer are in order but mixed with
+// the ones of the others
+typedef struct {
+    char magic[RECORD_MAGIC_LENGTH];
+    uint32_t nodeSize;
+    uint32_t runCount; // openings of the file, each one is a run
+    uint8_t reserved[16];
+} recordHeader_t;
+
+// a node is written when it is left, after its children
+typedef struct {
+    uint32_t node;   // per writer, in the order the nodes are entered
+    uint32_t parent; // RECORD_NO_PARENT at the root
+    uint16_t run;    // opening of the file which wrote it
+    uint16_t writer; // engine of the run
+    uint16_t move;   // Move::packed() leading here, RECORD_NO_MOVE at the
+                     // root and after a null move
+    int8_t depth;    // left to search, extensions not included
+    uint8_t ply;
+    int32_t alpha;   // window it was entered with, relative to the side
+    int32_t beta;    // to move like the score
+    int32_t score;
+    uint8_t reason;  // RECORD_*
+    uint8_t reserved[3];
+} recordNode_t;
+
+static_assert(sizeof(recordHeader_t) == 32, "record header is 32 bytes");
+static_assert(sizeof(recordNode_t) == 32, "record node is 32 bytes");
+
+/*---------------------------------------------------------------------------*/
+// the file shared by the writers of a process, nodes are only appended so
+// it may also be shared with other processes. the node budget is taken
+// from when a buffer is written, a writer stops recording once it is spent
+class TreeRecorder
+{
+public:
+    TreeRecorder();
+    ~TreeRecorder();
+
+    // created if it does not exist, the nodes of the run are appended
+    bool open(const char *path, int maxPly = RECORD_DEFAULT_MAX_PLY, \
+              uint64_t maxNodes = RECORD_DEFAULT_MAX_NODES);
+    void close();
+    bool isOpen() const;
+    int getMaxPly() const;
+    uint16_t getRun() const;
+
+    uint16_t addWriter();
+    // the part within the budget is written, false once it is spent
+    bool write(const recordNode_t *nodes, size_t count);
+private:
+    int fd;
+    int maxPly;
+    uint16_t run;
+    std::atomic<uint16_t> writerCount;
+    std::atomic<uint64_t> budget; // nodes left
+    std::mutex writeMutex;
+};
+
+/*---------------------------------------------------------------------------*/
+// the nodes of one engine, so searches on several threads do not share a
+// buffer. node ids and the parents of the current line are kept here
+class RecordWriter
+{
+public:
+    explicit RecordWriter(TreeRecorder *recorder);
+    ~RecordWriter(); // flushes
+
+    // -1 once the budget is spent, nothing is recorded then
+    int getMaxPly() const;
+    // the id of the entered node, the parent of the next ply
+    uint32_t enter(int ply);
+    uint32_t parentOf(int ply) const;
+    void add(recordNode_t &node);
+    void flush();
+private:
+    TreeRecorder *recorder;
+    uint16_t writer;
+    int maxPly;
+    uint32_t nextNode;
+    uint32_t path[UINT8_MAX + 1]; // node ids by ply
+    size_t count;
+    recordNode_t buffer[RECORD_BUFFER_NODES];
+};
+
+/*---------------------------------------------------------------------------*/
+// "record info file", "record roots file" and "record tree file root
+// [move] [-p plies]", the root is an index of the roots list and the move
+// is a root move like "e2e4"
+int recordMain(int argc, char *argv[]);
+
+#endif // RECORDER_H
@@ -0,0 +1,233 @@
+/*
+ * Standard Algebraic Notation - move text of the engine moves
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "chessengine.h"
+
+#include <cstdlib>
+#include <cstring>
+
+/*---------------------------------------------------------------------------*/
+// indexed by piece type
+const char sanPieceLetters[] = { 'B', 'K', 'N', 'P', 'Q', 'R' };
+
+/*---------------------------------------------------------------------------*/
+static int8_t sanPieceType(char letter)
+{
+    for(uint8_t i = 0; i < sizeof(sanPieceLetters); i++){
+        if(sanPieceLetters[i] == letter && i != PIECE_PAWN){
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*---------------------------------------------------------------------------*/
+void ChessEngine::moveToSan(Move move, char *san, uint8_t promotionType)
+{
+    int8_t index = boardInfo[move.from.x][move.from.y].index;
+    ChessPiece &piece = chessPieces[index];
+    bool capture = boardInfo[move.to.x][move.to.y].index >= 0;
+    bool side = piece.side();
+    char *out = san;
+
+    if(piece.type() == PIECE_PAWN){
+        if(capture){
+            *out++ = 'a' + move.from.x;
+        }
+    } else{
+        *out++ = sanPieceLetters[piece.type()];
+
+        // other pieces of the type which could go to the same box
+        bool ambiguous = false, sameFile = false, sameRank = false;
+        for(uint8_t i = sidePieceStart(side); \
+            i < sidePieceStart(side) + TOTAL_PIECE_NUM / 2; i++){
+            ChessPiece &other = chessPieces[i];
+            if(i == index || !other.onBoard() || \
+               other.type() != piece.type() || \
+               !canReach(other, move.to.x, move.to.y)){
+                continue;
+            }
+
+            Move alternative;
+            alternative.setPositions(other.x(), other.y(), move.to.x, \
+                                     move.to.y);
+            if(checkKingPressure(&alternative)){
+                ambiguous = true;
+                sameFile |= other.x() == move.from.x;
+                sameRank |= other.y() == move.from.y;
+            }
+        }
+
+        // the file is preferred, the rank if the file is shared
+        if(ambiguous && (!sameFile || sameRank)){
+            *out++ = 'a' + move.from.x;
+        }
+        if(ambiguous && sameFile){
+            *out++ = '1' + move.from.y;
+        }
+    }
+
+    if(capture){
+        *out++ = 'x';
+    }
+    *out++ = 'a' + move.to.x;
+    *out++ = '1' + move.to.y;
+
+    bool promotion = piece.type() == PIECE_PAWN && \
+            (move.to.y == 0 || move.to.y == BOARD_MATRIX_SIZE - 1);
+    if(promotion){
+        *out++ = '=';
+        *out++ = sanPieceLetters[promotionType];
+    }
+
+    // check and mate are seen on the board after the move
+    makeMove(move);
+    int8_t movedIndex = boardInfo[move.to.x][move.to.y].index;
+    if(promotion){
+        // the key names the position for the move cache, undo restores it
+        chessPieces[movedIndex].setType(promotionType);
+        computeHashKeys();
+    }
+    if(isInCheck()){
+        Move moves[MAX_MOVES_EACH_TURN];
+        *out++ = getAllMoves(moves) == 0 ? '#' : '+';
+    }
+    undoLastMove();
+
+    *out = '\0';
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::sanToMove(const char *san, size_t length, Move *move, \
+                            uint8_t *promotionType)
+{
+    // check, mate and annotation marks at the end carry no move data
+    while(length > 0 && strchr("+#!?", san[length - 1]) != nullptr){
+        length--;
+    }
+
+    // castling is not in the rules yet
+    if(length < 2 || san[0] == 'O' || san[0] == '0'){
+        return false;
+    }
+
+    uint8_t type = PIECE_PAWN;
+    size_t begin = 0;
+    if(sanPieceType(san[0]) >= 0){
+        type = sanPieceType(san[0]);
+        begin = 1;
+    }
+
+    // "e8=Q" and "e8Q" are both seen
+    int8_t promotion = -1;
+    if(type == PIECE_PAWN && length >= 2 && sanPieceType(san[length - 1]) \
+            >= 0){
+        promotion = sanPieceType(san[length - 1]);
+        length -= (san[length - 2] == '=') ? 2 : 1;
+    }
+    if(promotion == PIECE_KING || length < begin + 2){
+        return false;
+    }
+
+    int8_t toX = san[length - 2] - 'a';
+    int8_t toY = san[length - 1] - '1';
+    if(!BOARD_ON(toX, toY)){
+        return false;
+    }
+
+    // what is left between the letter and the box: file, rank and 'x'
+    int8_t fromX = -1, fromY = -1;
+    for(size_t i = begin; i < length - 2; i++){
+        if(san[i] >= 'a' && san[i] <= 'h'){
+            fromX = san[i] - 'a';
+        } else if(san[i] >= '1' && san[i] <= '8'){
+            fromY = san[i] - '1';
+        } else if(san[i] != 'x' && san[i] != ':' && san[i] != '-'){
+            return false;
+        }
+    }
+
+    uint8_t found = 0;
+    for(uint8_t i = sidePieceStart(movementSide); \
+        i < sidePieceStart(movementSide) + TOTAL_PIECE_NUM / 2; i++){
+        ChessPiece &piece = chessPieces[i];
+        if(!piece.onBoard() || piece.type() != type || \
+           (fromX >= 0 && piece.x() != fromX) || \
+           (fromY >= 0 && piece.y() != fromY) || \
+           !canReach(piece, toX, toY)){
+            continue;
+        }
+
+        Move candidate;
+        candidate.setPositions(piece.x(), piece.y(), toX, toY);
+        if(checkKingPressure(&candidate)){
+            *move = candidate;
+            found++;
+        }
+    }
+
+    *promotionType = promotion >= 0 ? promotion : PIECE_QUEEN;
+    return found == 1;
+}
+
+/*---------------------------------------------------------------------------*/
+bool ChessEngine::canReach(ChessPiece &piece, uint8_t x, uint8_t y)
+{
+    int8_t target = boardInfo[x][y].index;
+    if(target >= 0 && chessPieces[target].side() == piece.side()){
+        return false;
+    }
+
+    int8_t dx = x - piece.x();
+    int8_t dy = y - piece.y();
+    switch(piece.type()){
+        case PIECE_KING:
+            return (dx || dy) && abs(dx) <= 1 && abs(dy) <= 1;
+        case PIECE_KNIGHT:
+            return (abs(dx) == 1 && abs(dy) == 2) || \
+                    (abs(dx) == 2 && abs(dy) == 1);
+        case PIECE_PAWN:
+        {
+            int8_t direction = pawnDirection(piece.side());
+            if(target >= 0){
+                return abs(dx) == 1 && dy == direction;
+            }
+            if(dx != 0){
+                return false; // no en passant yet
+            }
+
+            return dy == direction || \
+                    (dy == 2 * direction && \
+                     piece.y() == pawnStartRank(piece.side()) && \
+                     boardInfo[x][piece.y() + direction].index == -1);
+        }
+        default:
+            break;
+    }
+
+    // sliders, the direction has to suit the piece and the way be empty
+    bool diagonal = abs(dx) == abs(dy) && dx != 0;
+    bool straight = (dx == 0) != (dy == 0);
+    if((piece.type() == PIECE_BISHOP && !diagonal) || \
+       (piece.type() == PIECE_ROOK && !straight) || \
+       (piece.type() == PIECE_QUEEN && !diagonal && !straight)){
+        return false;
+    }
+
+    int8_t stepX = (dx > 0) - (dx < 0);
+    int8_t stepY = (dy > 0) - (dy < 0);
+    int8_t currentX = piece.x() + stepX;
+    int8_t currentY = piece.y() + stepY;
+    while(currentX != x || currentY != y){
+        if(boardInfo[currentX][currentY].index >= 0){
+            return false;
+        }
+        currentX += stepX;
+        currentY += stepY;
+    }
+
+    return true;
+}
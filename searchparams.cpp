@@ -0,0 +1,120 @@
+/*
+ * Search Parameters - runtime switches for selective search
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "searchparams.h"
+#include "chesspiece.h"
+#include "paramlist.h"
+
+#include <QDebug>
+
+#include <cmath>
+#include <cstring>
+
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    const char *name;
+    int SearchParams::*value;
+} searchParamEntry_t;
+
+static const searchParamEntry_t searchParamEntries[] = {
+    { "nullMove", &SearchParams::nullMove },
+    { "nullMoveMinDepth", &SearchParams::nullMoveMinDepth },
+    { "nullMoveReduction", &SearchParams::nullMoveReduction },
+    { "nullMoveDepthDivisor", &SearchParams::nullMoveDepthDivisor },
+    { "lmr", &SearchParams::lmr },
+    { "lmrMinDepth", &SearchParams::lmrMinDepth },
+    { "lmrMinMoves", &SearchParams::lmrMinMoves },
+    { "lmrBase", &SearchParams::lmrBase },
+    { "lmrDivisor", &SearchParams::lmrDivisor },
+    { "reverseFutility", &SearchParams::reverseFutility },
+    { "reverseFutilityDepth", &SearchParams::reverseFutilityDepth },
+    { "reverseFutilityMargin", &SearchParams::reverseFutilityMargin },
+    { "futility", &SearchParams::futility },
+    { "futilityDepth", &SearchParams::futilityDepth },
+    { "futilityMargin", &SearchParams::futilityMargin },
+    { "checkExtension", &SearchParams::checkExtension }
+};
+
+/*---------------------------------------------------------------------------*/
+SearchParams::SearchParams()
+{
+    nullMove = 1;
+    nullMoveMinDepth = 3;
+    nullMoveReduction = 2;
+    nullMoveDepthDivisor = 4;
+
+    lmr = 1;
+    lmrMinDepth = 3;
+    lmrMinMoves = 3;
+    lmrBase = 75;
+    lmrDivisor = 225;
+
+    reverseFutility = 1;
+    reverseFutilityDepth = 3;
+    reverseFutilityMargin = 2 * PIECE_POINT_SCALE;
+
+    futility = 1;
+    futilityDepth = 2;
+    futilityMargin = 2 * PIECE_POINT_SCALE;
+
+    checkExtension = 1;
+
+    initReductions();
+}
+
+/*---------------------------------------------------------------------------*/
+bool SearchParams::parse(const char *spec)
+{
+    return parseParamList(spec, [this](const char *name, int value){
+        return set(name, value);
+    });
+}
+
+/*---------------------------------------------------------------------------*/
+bool SearchParams::set(const char *name, int value)
+{
+    for(const searchParamEntry_t &entry : searchParamEntries){
+        if(strcmp(entry.name, name) == 0){
+            this->*entry.value = value;
+            initReductions();
+            return true;
+        }
+    }
+
+    qDebug() << "Unknown search parameter:" << name;
+    return false;
+}
+
+/*---------------------------------------------------------------------------*/
+void SearchParams::initReductions()
+{
+    double base = lmrBase / 100.0;
+    double divisor = lmrDivisor > 0 ? (lmrDivisor / 100.0) : 1.0;
+
+    for(int depth = 0; depth < LMR_TABLE_DEPTH; depth++){
+        for(int move = 0; move < LMR_TABLE_MOVES; move++){
+            if(depth == 0 || move == 0){
+                lmrTable[depth][move] = 0;
+                continue;
+            }
+
+            double r = base + std::log(depth) * std::log(move) / divisor;
+            lmrTable[depth][move] = r > 0 ? (uint8_t)r : 0;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+uint8_t SearchParams::reduction(int depth, int moveNumber) const
+{
+    if(depth >= LMR_TABLE_DEPTH){
+        depth = LMR_TABLE_DEPTH - 1;
+    }
+    if(moveNumber >= LMR_TABLE_MOVES){
+        moveNumber = LMR_TABLE_MOVES - 1;
+    }
+
+    return lmrTable[depth][moveNumber];
+}
@@ -0,0 +1,53 @@
+/*
+ * Search Parameters - runtime switches for selective search
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef SEARCHPARAMS_H
+#define SEARCHPARAMS_H
+
+#include <cstdint>
+
+/*---------------------------------------------------------------------------*/
+#define SEARCH_PARAMS_ENV    "AI_CHESS_SEARCH_PARAMS"
+#define LMR_TABLE_DEPTH      64
+#define LMR_TABLE_MOVES      128
+
+/*---------------------------------------------------------------------------*/
+// margins are in rating units, a pawn is PIECE_POINT_PAWN * PIECE_POINT_SCALE
+class SearchParams
+{
+public:
+    SearchParams();
+
+    // "name=value,name=value", unknown names are reported and skipped
+    bool parse(const char *spec);
+    bool set(const char *name, int value);
+    void initReductions();
+    uint8_t reduction(int depth, int moveNumber) const;
+
+    int nullMove;             // 0 disables
+    int nullMoveMinDepth;
+    int nullMoveReduction;    // R = base + depth / nullMoveDepthDivisor
+    int nullMoveDepthDivisor;
+
+    int lmr;                  // 0 disables
+    int lmrMinDepth;
+    int lmrMinMoves;          // moves searched before reducing
+    int lmrBase;              // percent
+    int lmrDivisor;           // percent
+
+    int reverseFutility;      // 0 disables
+    int reverseFutilityDepth;
+    int reverseFutilityMargin;
+
+    int futility;             // 0 disables
+    int futilityDepth;
+    int futilityMargin;
+
+    int checkExtension;       // plies added when side to move is in check
+private:
+    uint8_t lmrTable[LMR_TABLE_DEPTH][LMR_TABLE_MOVES];
+};
+
+#endif // SEARCHPARAMS_H
@@ -0,0 +1,223 @@
+/*
+ * Search Statistics - per-thread counters for the engine
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "searchstats.h"
+
+#include <cmath>
+
+/*---------------------------------------------------------------------------*/
+#define NS_IN_MS  1000000.0
+#define NS_IN_SEC 1000000000.0
+
+/*---------------------------------------------------------------------------*/
+SearchStats &threadSearchStats()
+{
+    static thread_local SearchStats stats;
+    return stats;
+}
+
+/*---------------------------------------------------------------------------*/
+SearchStats::SearchStats()
+{
+    clear();
+}
+
+/*---------------------------------------------------------------------------*/
+void SearchStats::clear()
+{
+    nodes = 0;
+    qnodes = 0;
+    ttProbes = 0;
+    ttHits = 0;
+    learningHits = 0;
+    betaCutoffs = 0;
+    firstMoveCutoffs = 0;
+    pawnProbes = 0;
+    pawnHits = 0;
+
+    nullMoveCutoffs = 0;
+    reverseFutilityPrunes = 0;
+    futilityPrunes = 0;
+    lmrReductions = 0;
+    lmrResearches = 0;
+    checkExtensions = 0;
+
+    movegenNs = 0;
+    evalNs = 0;
+    makeUnmakeNs = 0;
+    totalNs = 0;
+
+    iterationCount = 0;
+    iterationStartNodes = 0;
+    searchStart = std::chrono::steady_clock::now();
+    iterationStart = searchStart;
+}
+
+/*---------------------------------------------------------------------------*/
+void SearchStats::merge(const SearchStats &other)
+{
+    nodes += other.nodes;
+    qnodes += other.qnodes;
+    ttProbes += other.ttProbes;
+    ttHits += other.ttHits;
+    learningHits += other.learningHits;
+    betaCutoffs += other.betaCutoffs;
+    firstMoveCutoffs += other.firstMoveCutoffs;
+    pawnProbes += other.pawnProbes;
+    pawnHits += other.pawnHits;
+
+    nullMoveCutoffs += other.nullMoveCutoffs;
+    reverseFutilityPrunes += other.reverseFutilityPrunes;
+    futilityPrunes += other.futilityPrunes;
+    lmrReductions += other.lmrReductions;
+    lmrResearches += other.lmrResearches;
+    checkExtensions += other.checkExtensions;
+
+    movegenNs += other.movegenNs;
+    evalNs += other.evalNs;
+    makeUnmakeNs += other.makeUnmakeNs;
+
+    // threads search the same iterations, wall time is the longest one
+    if(other.totalNs > totalNs){
+        totalNs = other.totalNs;
+    }
+
+    for(uint8_t i = 0; i < other.iterationCount; i++){
+        if(i < iterationCount){
+            iterations[i].nodes += other.iterations[i].nodes;
+            if(other.iterations[i].timeNs > iterations[i].timeNs){
+                iterations[i].timeNs = other.iterations[i].timeNs;
+            }
+        } else{
+            iterations[iterationCount++] = other.iterations[i];
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void SearchStats::beginIteration(uint8_t depth)
+{
+    if(iterationCount >= STATS_MAX_ITERATIONS){
+        return;
+    }
+
+    iterations[iterationCount].depth = depth;
+    iterationStartNodes = nodes + qnodes;
+    iterationStart = std::chrono::steady_clock::now();
+}
+
+/*---------------------------------------------------------------------------*/
+void SearchStats::endIteration()
+{
+    if(iterationCount >= STATS_MAX_ITERATIONS){
+        return;
+    }
+
+    std::chrono::steady_clock::time_point now = \
+            std::chrono::steady_clock::now();
+
+    iterations[iterationCount].nodes = nodes + qnodes - iterationStartNodes;
+    iterations[iterationCount].timeNs = std::chrono::duration_cast\
+            <std::chrono::nanoseconds>(now - iterationStart).count();
+    iterationCount++;
+
+    totalNs = std::chrono::duration_cast<std::chrono::nanoseconds>\
+            (now - searchStart).count();
+}
+
+/*---------------------------------------------------------------------------*/
+double SearchStats::branchingFactor(uint8_t iteration) const
+{
+    if(iteration >= iterationCount || iterations[iteration].nodes == 0){
+        return 0.0;
+    }
+
+    // ratio to the previous iteration if exist, else the depth-th root
+    if(iteration > 0 && iterations[iteration - 1].nodes != 0){
+        return (double)iterations[iteration].nodes / \
+                iterations[iteration - 1].nodes;
+    }
+
+    if(iterations[iteration].depth == 0){
+        return 0.0;
+    }
+
+    return std::pow((double)iterations[iteration].nodes, \
+                    1.0 / iterations[iteration].depth);
+}
+
+/*---------------------------------------------------------------------------*/
+QString SearchStats::toJson() const
+{
+    uint64_t allNodes = nodes + qnodes;
+    double nps = totalNs ? (allNodes * NS_IN_SEC / totalNs) : 0.0;
+    double firstMoveRate = betaCutoffs ? \
+            ((double)firstMoveCutoffs / betaCutoffs) : 0.0;
+    double ttHitRate = ttProbes ? ((double)ttHits / ttProbes) : 0.0;
+    double pawnHitRate = pawnProbes ? ((double)pawnHits / pawnProbes) : 0.0;
+
+    QString json = "{";
+    json.append("\"nodes\":").append(QString::number(nodes))
+        .append(",\"qnodes\":").append(QString::number(qnodes))
+        .append(",\"nps\":").append(QString::number(nps, 'f', 0))
+        .append(",\"ttProbes\":").append(QString::number(ttProbes))
+        .append(",\"ttHits\":").append(QString::number(ttHits))
+        .append(",\"ttHitRate\":").append(QString::number(ttHitRate, 'f', 4))
+        .append(",\"learningHits\":").append(QString::number(learningHits))
+        .append(",\"pawnProbes\":").append(QString::number(pawnProbes))
+        .append(",\"pawnHits\":").append(QString::number(pawnHits))
+        .append(",\"pawnHitRate\":")
+        .append(QString::number(pawnHitRate, 'f', 4))
+        .append(",\"betaCutoffs\":").append(QString::number(betaCutoffs))
+        .append(",\"firstMoveCutoffs\":")
+        .append(QString::number(firstMoveCutoffs))
+        .append(",\"firstMoveCutoffRate\":")
+        .append(QString::number(firstMoveRate, 'f', 4));
+
+    json.append(",\"pruning\":{")
+        .append("\"nullMoveCutoffs\":")
+        .append(QString::number(nullMoveCutoffs))
+        .append(",\"reverseFutilityPrunes\":")
+        .append(QString::number(reverseFutilityPrunes))
+        .append(",\"futilityPrunes\":")
+        .append(QString::number(futilityPrunes))
+        .append(",\"lmrReductions\":")
+        .append(QString::number(lmrReductions))
+        .append(",\"lmrResearches\":")
+        .append(QString::number(lmrResearches))
+        .append(",\"checkExtensions\":")
+        .append(QString::number(checkExtensions))
+        .append("}");
+
+    json.append(",\"timeMs\":{")
+        .append("\"movegen\":")
+        .append(QString::number(movegenNs / NS_IN_MS, 'f', 3))
+        .append(",\"eval\":")
+        .append(QString::number(evalNs / NS_IN_MS, 'f', 3))
+        .append(",\"makeUnmake\":")
+        .append(QString::number(makeUnmakeNs / NS_IN_MS, 'f', 3))
+        .append(",\"total\":")
+        .append(QString::number(totalNs / NS_IN_MS, 'f', 3))
+        .append("}");
+
+    json.append(",\"iterations\":[");
+    for(uint8_t i = 0; i < iterationCount; i++){
+        if(i != 0){
+            json.append(",");
+        }
+        json.append("{\"depth\":")
+            .append(QString::number(iterations[i].depth))
+            .append(",\"nodes\":")
+            .append(QString::number(iterations[i].nodes))
+            .append(",\"timeMs\":")
+            .append(QString::number(iterations[i].timeNs / NS_IN_MS, 'f', 3))
+            .append(",\"ebf\":")
+            .append(QString::number(branchingFactor(i), 'f', 3))
+            .append("}");
+    }
+    json.append("]}");
+
+    return json;
+}
@@ -0,0 +1,103 @@
+/*
+ * Search Statistics - per-thread counters for the engine
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef SEARCHSTATS_H
+#define SEARCHSTATS_H
+
+#include <QString>
+
+#include <chrono>
+#include <cstdint>
+
+/*---------------------------------------------------------------------------*/
+#define STATS_MAX_ITERATIONS 64
+
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    uint8_t depth;
+    uint64_t nodes;
+    uint64_t timeNs;
+} iterationStats_t;
+
+/*---------------------------------------------------------------------------*/
+class SearchStats
+{
+public:
+    SearchStats();
+    void clear();
+    void merge(const SearchStats &other);
+
+    void beginIteration(uint8_t depth);
+    void endIteration();
+    double branchingFactor(uint8_t iteration) const;
+
+    QString toJson() const;
+
+    uint64_t nodes;
+    uint64_t qnodes;
+    uint64_t ttProbes;
+    uint64_t ttHits;
+    uint64_t learningHits; // table misses found in the learning file
+    uint64_t betaCutoffs;
+    uint64_t firstMoveCutoffs;
+    uint64_t pawnProbes;
+    uint64_t pawnHits;
+
+    // selective search
+    uint64_t nullMoveCutoffs;
+    uint64_t reverseFutilityPrunes;
+    uint64_t futilityPrunes;
+    uint64_t lmrReductions;
+    uint64_t lmrResearches;
+    uint64_t checkExtensions;
+
+    // time spent in each phase in nanoseconds
+    uint64_t movegenNs;
+    uint64_t evalNs;
+    uint64_t makeUnmakeNs;
+    uint64_t totalNs;
+
+    iterationStats_t iterations[STATS_MAX_ITERATIONS];
+    uint8_t iterationCount;
+private:
+    std::chrono::steady_clock::time_point searchStart;
+    std::chrono::steady_clock::time_point iterationStart;
+    uint64_t iterationStartNodes;
+};
+
+/*---------------------------------------------------------------------------*/
+// each search thread counts into its own instance, no locking needed
+SearchStats &threadSearchStats();
+
+/*---------------------------------------------------------------------------*/
+#ifdef SEARCH_STATS
+class ScopedStatsTimer
+{
+public:
+    explicit ScopedStatsTimer(uint64_t *counter) : counter(counter), \
+        start(std::chrono::steady_clock::now()) {}
+    ~ScopedStatsTimer()
+    {
+        (*counter) += std::chrono::duration_cast<std::chrono::nanoseconds>\
+                (std::chrono::steady_clock::now() - start).count();
+    }
+private:
+    uint64_t *counter;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define STATS_CONCAT_(a, b)  a##b
+#define STATS_CONCAT(a, b)   STATS_CONCAT_(a, b)
+#define STATS_INC(field)     (threadSearchStats().field++)
+#define STATS_TIMER(field)   ScopedStatsTimer STATS_CONCAT(statsTimer, \
+                                 __LINE__)(&threadSearchStats().field)
+#define STATS_CALL(call)     (threadSearchStats().call)
+#else
+#define STATS_INC(field)     ((void)0)
+#define STATS_TIMER(field)   ((void)0)
+#define STATS_CALL(call)     ((void)0)
+#endif
+
+#endif // SEARCHSTATS_H
@@ -0,0 +1,253 @@
+/*
+ * Self Play - headless games producing labelled training positions
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "selfplay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+#define SELFPLAY_SEED_STEP 0x9E3779B97F4A7C15ULL // spreads the worker seeds
+
+static_assert(TRAINING_RESULT_WHITE == PGN_RESULT_WHITE && \
+              TRAINING_RESULT_DRAW == PGN_RESULT_DRAW && \
+              TRAINING_RESULT_BLACK == PGN_RESULT_BLACK, \
+              "game results are shared by the records and the PGN");
+
+/*---------------------------------------------------------------------------*/
+SelfPlay::SelfPlay(const selfPlayConfig_t &config, TrainingWriter *writer, \
+                   PgnWriter *pgnWriter)
+{
+    this->config = config;
+    if(this->config.threads == 0){
+        this->config.threads = std::max(1u, \
+                std::thread::hardware_concurrency());
+    }
+
+    this->writer = writer;
+    this->pgnWriter = pgnWriter;
+    this->nextGame = 0;
+    this->games = 0;
+    this->positions = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+void SelfPlay::run()
+{
+    std::vector<std::thread> workers;
+    for(unsigned i = 0; i < config.threads; i++){
+        workers.push_back(std::thread(&SelfPlay::worker, this, i));
+    }
+
+    for(size_t i = 0; i < workers.size(); i++){
+        workers[i].join();
+    }
+
+    writer->flush();
+}
+
+/*---------------------------------------------------------------------------*/
+uint64_t SelfPlay::gameCount() const
+{
+    return games;
+}
+
+/*---------------------------------------------------------------------------*/
+uint64_t SelfPlay::positionCount() const
+{
+    return positions;
+}
+
+/*---------------------------------------------------------------------------*/
+void SelfPlay::worker(unsigned index)
+{
+    ChessEngine engine(SELFPLAY_TT_SIZE_MB);
+    uint64_t random = config.seed + (index + 1) * SELFPLAY_SEED_STEP;
+    trainingRecord_t records[SELFPLAY_MAX_PLY];
+    PgnRecorder pgn;
+    std::string player = "AI Chess depth " + std::to_string(config.depth);
+
+    uint32_t game;
+    while((game = nextGame++) < config.games){
+        uint16_t count = 0;
+        pgn.clear();
+        playGame(&engine, &random, records, &count, \
+                 pgnWriter ? &pgn : nullptr);
+
+        // the game is written as a whole once its result is known
+        writer->write(records, count);
+        if(pgnWriter != nullptr){
+            pgn.setTag("Event", "AI Chess self-play");
+            pgn.setTag("Round", std::to_string(game + 1).c_str());
+            pgn.setTag("White", player.c_str());
+            pgn.setTag("Black", player.c_str());
+            pgnWriter->write(pgn);
+        }
+        games++;
+        positions += count;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+int8_t SelfPlay::playGame(ChessEngine *engine, uint64_t *random, \
+                          trainingRecord_t *records, uint16_t *count, \
+                          PgnRecorder *pgn)
+{
+    std::mt19937_64 rng(*random);
+    (*random) = rng();
+
+    engine->resetPosition();
+    engine->clearTranspositionTable();
+
+    // odd or even number of random plies, both sides get varied openings
+    uint16_t randomPlies = SELFPLAY_RANDOM_PLIES + rng() % 2;
+    uint8_t decisivePlies = 0;
+    int8_t result = TRAINING_RESULT_DRAW;
+    char san[SAN_MAX_LENGTH];
+
+    for(uint16_t ply = 0; ply < SELFPLAY_MAX_PLY; ply++){
+        Move moves[MAX_MOVES_EACH_TURN];
+        uint8_t moveCount = engine->getAllMoves(moves);
+        bool side = engine->sideToMove();
+        bool inCheck = engine->isInCheck();
+
+        if(moveCount == 0){
+            // checkmate or stalemate
+            if(inCheck){
+                result = side == SIDE_WHITE ? TRAINING_RESULT_BLACK : \
+                                              TRAINING_RESULT_WHITE;
+            }
+            break;
+        }
+        if(engine->isDrawByRule()){
+            break;
+        }
+
+        if(ply < randomPlies){
+            Move move = moves[rng() % moveCount];
+            if(pgn != nullptr){
+                engine->moveToSan(move, san);
+                pgn->addMove(san);
+            }
+            engine->playMove(move);
+            continue;
+        }
+
+        int score = engine->search(config.depth);
+        Move best = engine->getBestMove();
+
+        // quiet positions only, captures and checks are not settled
+        packedPosition_t position;
+        engine->packPosition(&position);
+        bool capture = position.board.occupancy & \
+                BOARD_SQUARE_BIT(best.to.x, best.to.y);
+        if(!inCheck && !capture){
+            trainingRecord_t *record = &records[(*count)++];
+            int whiteScore = side == SIDE_WHITE ? score : -score;
+            record->board = position.board;
+            record->score = std::max(-INT16_MAX, std::min(INT16_MAX, \
+                                                           whiteScore));
+            record->ply = ply;
+            record->side = side;
+            record->reserved[0] = 0;
+            record->reserved[1] = 0;
+        }
+
+        // material is the adjudication measure, the positional terms
+        // are too noisy for it
+        int material = engine->materialRating();
+        if(abs(material) >= SELFPLAY_RESIGN_SCORE){
+            if(++decisivePlies >= SELFPLAY_RESIGN_PLIES){
+                result = material > 0 ? TRAINING_RESULT_WHITE : \
+                                        TRAINING_RESULT_BLACK;
+                break;
+            }
+        } else{
+            decisivePlies = 0;
+        }
+
+        if(pgn != nullptr){
+            engine->moveToSan(best, san);
+            pgn->addMove(san);
+        }
+        engine->playMove(best);
+    }
+
+    for(uint16_t i = 0; i < *count; i++){
+        records[i].result = result;
+    }
+    if(pgn != nullptr){
+        pgn->setResult(result);
+    }
+
+    return result;
+}
+
+/*---------------------------------------------------------------------------*/
+int selfPlayMain(int argc, char *argv[])
+{
+    selfPlayConfig_t config;
+    config.depth = SELFPLAY_DEFAULT_DEPTH;
+    config.threads = 0;
+    config.games = SELFPLAY_DEFAULT_GAMES;
+    config.seed = std::chrono::steady_clock::now().time_since_epoch().count();
+    config.recordsPerFile = TRAINING_RECORDS_PER_FILE;
+    const char *prefix = nullptr;
+    const char *pgnPath = nullptr;
+
+    for(int i = 1; i < argc; i++){
+        bool hasValue = i + 1 < argc;
+        if(strcmp(argv[i], "-d") == 0 && hasValue){
+            config.depth = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-t") == 0 && hasValue){
+            config.threads = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-g") == 0 && hasValue){
+            config.games = strtoul(argv[++i], nullptr, 10);
+        } else if(strcmp(argv[i], "-n") == 0 && hasValue){
+            config.recordsPerFile = strtoull(argv[++i], nullptr, 10);
+        } else if(strcmp(argv[i], "-s") == 0 && hasValue){
+            config.seed = strtoull(argv[++i], nullptr, 10);
+        } else if(strcmp(argv[i], "-p") == 0 && hasValue){
+            pgnPath = argv[++i];
+        } else{
+            prefix = argv[i];
+        }
+    }
+
+    if(prefix == nullptr || config.depth < 1){
+        fprintf(stderr, "usage: datagen [-d depth] [-t threads] [-g games] "
+                        "[-n recordsPerFile] [-s seed] [-p pgnFile] prefix\n");
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point start = \
+            std::chrono::steady_clock::now();
+
+    PgnWriter pgnWriter;
+    if(pgnPath != nullptr && !pgnWriter.open(pgnPath)){
+        fprintf(stderr, "%s can not be written\n", pgnPath);
+        return 1;
+    }
+
+    TrainingWriter writer(prefix, config.recordsPerFile);
+    SelfPlay selfPlay(config, &writer, pgnPath ? &pgnWriter : nullptr);
+    selfPlay.run();
+
+    double seconds = std::chrono::duration<double>(\
+                std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%llu games, %llu positions in %u files, %.1f s, "
+                    "%.0f positions/s\n", \
+            (unsigned long long)selfPlay.gameCount(), \
+            (unsigned long long)selfPlay.positionCount(), \
+            writer.fileCount(), seconds, \
+            seconds > 0.0 ? selfPlay.positionCount() / seconds : 0.0);
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+/*
+ * Self Play - headless games producing labelled training positions
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef SELFPLAY_H
+#define SELFPLAY_H
+
+#include "pgn.h"
+#include "trainingdata.h"
+
+#include <atomic>
+#include <cstdint>
+
+/*---------------------------------------------------------------------------*/
+#define SELFPLAY_DEFAULT_DEPTH  4
+#define SELFPLAY_DEFAULT_GAMES  1000
+#define SELFPLAY_RANDOM_PLIES   8    // random opening moves, varies games
+#define SELFPLAY_MAX_PLY        400  // longer games are drawn
+#define SELFPLAY_RESIGN_SCORE   800  // material units, 8 pawns
+#define SELFPLAY_RESIGN_PLIES   4    // plies the balance has to stay above
+#define SELFPLAY_TT_SIZE_MB     4
+
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    int depth;
+    unsigned threads;  // 0 uses all cores
+    uint32_t games;
+    uint64_t seed;
+    uint64_t recordsPerFile;
+} selfPlayConfig_t;
+
+/*---------------------------------------------------------------------------*/
+class SelfPlay
+{
+public:
+    // games are also written as PGN when pgnWriter is given
+    SelfPlay(const selfPlayConfig_t &config, TrainingWriter *writer, \
+             PgnWriter *pgnWriter = nullptr);
+
+    void run();
+    uint64_t gameCount() const;
+    uint64_t positionCount() const;
+private:
+    void worker(unsigned index);
+    int8_t playGame(ChessEngine *engine, uint64_t *random, \
+                    trainingRecord_t *records, uint16_t *count, \
+                    PgnRecorder *pgn);
+
+    selfPlayConfig_t config;
+    TrainingWriter *writer;
+    PgnWriter *pgnWriter;
+    std::atomic<uint32_t> nextGame;
+    std::atomic<uint64_t> games;
+    std::atomic<uint64_t> positions;
+};
+
+/*---------------------------------------------------------------------------*/
+// "datagen [-d depth] [-t threads] [-g games] [-n recordsPerFile]
+// [-s seed] [-p pgnFile] prefix"
+int selfPlayMain(int argc, char *argv[]);
+
+#endif // SELFPLAY_H
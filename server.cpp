@@ -0,0 +1,738 @@
+/*
+ * Game Server - many game sessions over a line protocol on one engine pool
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*---------------------------------------------------------------------------*/
+#define SERVER_LISTEN_BACKLOG 128
+#define SERVER_READ_SIZE      4096
+#define SERVER_MAX_DEPTH      32
+
+/*---------------------------------------------------------------------------*/
+static bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/*---------------------------------------------------------------------------*/
+static std::vector<std::string> splitWords(const std::string &line)
+{
+    std::vector<std::string> words;
+    size_t begin = 0;
+    while(begin < line.size()){
+        size_t end = line.find_first_of(" \t\r", begin);
+        if(end == std::string::npos){
+            end = line.size();
+        }
+        if(end > begin){
+            words.push_back(line.substr(begin, end - begin));
+        }
+        begin = end + 1;
+    }
+
+    return words;
+}
+
+/*---------------------------------------------------------------------------*/
+GameServer::GameServer(const serverConfig_t &config)
+    : config(config)
+    , table(config.memoryMb)
+    , moveChecker(&table)
+    , pool(config.threads, config.pinned)
+{
+    for(unsigned i = 0; i < pool.size(); i++){
+        engines.push_back(std::unique_ptr<ChessEngine>(new ChessEngine(\
+                                                           &table)));
+    }
+
+    listenFd = -1;
+    wakePipe[0] = wakePipe[1] = -1;
+    running = false;
+    nextSession = 1;
+    searching = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+GameServer::~GameServer()
+{
+    while(!clients.empty()){
+        dropClient(clients.begin()->first);
+    }
+
+    if(listenFd >= 0){
+        close(listenFd);
+        if(config.socketPath != nullptr){
+            unlink(config.socketPath);
+        }
+    }
+    if(wakePipe[0] >= 0){
+        close(wakePipe[0]);
+        close(wakePipe[1]);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+bool GameServer::listen()
+{
+    if(config.learningPath != nullptr){
+        if(!learning.open(config.learningPath)){
+            fprintf(stderr, "%s is not a learning file\n", \
+                    config.learningPath);
+            return false;
+        }
+        for(size_t i = 0; i < engines.size(); i++){
+            engines[i]->setLearningFile(&learning);
+        }
+    }
+    if(config.recordPath != nullptr){
+        if(!recorder.open(config.recordPath, config.recordMaxPly)){
+            fprintf(stderr, "%s is not a record file\n", config.recordPath);
+            return false;
+        }
+        for(size_t i = 0; i < engines.size(); i++){
+            engines[i]->setTreeRecorder(&recorder);
+        }
+    }
+
+    if(pipe(wakePipe) != 0 || !setNonBlocking(wakePipe[0]) || \
+       !setNonBlocking(wakePipe[1])){
+        perror("pipe");
+        return false;
+    }
+
+    if(config.socketPath != nullptr){
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if(strlen(config.socketPath) >= sizeof(address.sun_path)){
+            fprintf(stderr, "%s is too long\n", config.socketPath);
+            return false;
+        }
+        strcpy(address.sun_path, config.socketPath);
+
+        unlink(config.socketPath); // left over by a previous run
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(listenFd < 0 || \
+           bind(listenFd, (sockaddr *)&address, sizeof(address)) != 0){
+            perror(config.socketPath);
+            return false;
+        }
+    } else{
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(config.port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // local only
+        if(config.address != nullptr && \
+           inet_pton(AF_INET, config.address, &address.sin_addr) != 1){
+            fprintf(stderr, "%s is not an IPv4 address\n", config.address);
+            return false;
+        }
+
+        int reuse = 1;
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        if(listenFd < 0 || setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, \
+                                      &reuse, sizeof(reuse)) != 0 || \
+           bind(listenFd, (sockaddr *)&address, sizeof(address)) != 0){
+            perror("bind");
+            return false;
+        }
+    }
+
+    if(::listen(listenFd, SERVER_LISTEN_BACKLOG) != 0 || \
+       !setNonBlocking(listenFd)){
+        perror("listen");
+        return false;
+    }
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+void GameServer::run()
+{
+    std::vector<pollfd> fds;
+    std::vector<int> dropped;
+    running = true;
+
+    while(running){
+        fds.clear();
+        fds.push_back({ wakePipe[0], POLLIN, 0 });
+        fds.push_back({ listenFd, POLLIN, 0 });
+        for(auto it = clients.begin(); it != clients.end(); ++it){
+            short events = POLLIN;
+            if(!it->second.output.empty()){
+                events |= POLLOUT;
+            }
+            fds.push_back({ it->first, events, 0 });
+        }
+
+        if(poll(fds.data(), fds.size(), -1) < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+
+        if(fds[0].revents & POLLIN){
+            char buffer[SERVER_READ_SIZE];
+            while(read(wakePipe[0], buffer, sizeof(buffer)) > 0){
+                // only wakes up
+            }
+            finishSearches();
+        }
+        if(fds[1].revents & POLLIN){
+            acceptClients();
+        }
+
+        dropped.clear();
+        for(size_t i = 2; i < fds.size(); i++){
+            int fd = fds[i].fd;
+            bool alive = true;
+            if(fds[i].revents & (POLLIN | POLLHUP | POLLERR)){
+                alive = readClient(fd);
+            }
+            if(alive && (fds[i].revents & POLLOUT)){
+                alive = writeClient(fd);
+            }
+
+            auto client = clients.find(fd);
+            if(!alive || (client != clients.end() && \
+                          client->second.closing && \
+                          client->second.output.empty())){
+                dropped.push_back(fd);
+            }
+        }
+
+        for(size_t i = 0; i < dropped.size(); i++){
+            dropClient(dropped[i]);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void GameServer::stop()
+{
+    running = false;
+    if(wakePipe[1] >= 0){
+        ssize_t written = write(wakePipe[1], "s", 1);
+        (void)written; // a full pipe wakes up anyway
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void GameServer::acceptClients()
+{
+    while(true){
+        int fd = accept(listenFd, nullptr, nullptr);
+        if(fd < 0){
+            return; // EAGAIN, all are taken
+        }
+
+        if(!setNonBlocking(fd)){
+            close(fd);
+            continue;
+        }
+
+        serverClient_t &client = clients[fd];
+        client.input.clear();
+        client.output.clear();
+        client.closing = false;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+bool GameServer::readClient(int fd)
+{
+    char buffer[SERVER_READ_SIZE];
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    if(length <= 0){
+        return length < 0 && (errno == EAGAIN || errno == EINTR);
+    }
+
+    serverClient_t &client = clients[fd];
+    client.input.append(buffer, length);
+
+    size_t begin = 0, end;
+    while(!client.closing && \
+          (end = client.input.find('\n', begin)) != std::string::npos){
+        std::string line = client.input.substr(begin, end - begin);
+        begin = end + 1;
+        handleLine(fd, line);
+    }
+    client.input.erase(0, begin);
+
+    if(client.input.size() > SERVER_MAX_LINE){
+        reply(fd, "error line too long");
+        client.closing = true;
+    }
+
+    // the reply may have dropped it
+    return clients.count(fd) > 0;
+}
+
+/*---------------------------------------------------------------------------*/
+bool GameServer::writeClient(int fd)
+{
+    serverClient_t &client = clients[fd];
+    while(!client.output.empty()){
+        ssize_t length = write(fd, client.output.data(), client.output.size());
+        if(length < 0){
+            return errno == EAGAIN || errno == EINTR;
+        }
+        client.output.erase(0, length);
+    }
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+void GameServer::dropClient(int fd)
+{
+    // running searches of its sessions finish, their results are thrown
+    for(auto it = sessions.begin(); it != sessions.end();){
+        if(it->second.client == fd){
+            it = sessions.erase(it);
+        } else{
+            ++it;
+        }
+    }
+
+    clients.erase(fd);
+    close(fd);
+}
+
+/*---------------------------------------------------------------------------*/
+void GameServer::reply(int fd, const std::string &text)
+{
+    serverClient_t &client = clients[fd];
+    client.output += text;
+    client.output += '\n';
+
+    // a client which does not read is not allowed to fill the memory
+    if(client.output.size() > SERVER_MAX_OUTPUT){
+        client.output.clear();
+        client.closing = true;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+serverSession_t *GameServer::findSession(\
+        int fd, const std::vector<std::string> &words, uint32_t *id)
+{
+    if(words.size() < 2){
+        reply(fd, "error " + words[0] + " needs a session");
+        return nullptr;
+    }
+
+    *id = strtoul(words[1].c_str(), nullptr, 10);
+    auto session = sessions.find(*id);
+    if(session == sessions.end() || session->second.client != fd){
+        reply(fd, "error " + words[1] + " unknown session");
+        return nullptr;
+    }
+
+    return &session->second;
+}
+
+/*---------------------------------------------------------------------------*/
+void GameServer::handleLine(int fd, const std::string &line)
+{
+    std::vector<std::string> words = splitWords(line);
+    if(words.empty()){
+        return;
+    }
+
+    const std::string &command = words[0];
+    if(command == "quit"){
+        clients[fd].closing = true;
+        return;
+    } else if(command == "stats"){
+        reply(fd, "stats " + std::to_string(sessions.size()) + " " + \
+              std::to_string(searching) + " " + \
+              std::to_string(pool.pending()) + " " + \
+              std::to_string(pool.size()));
+        return;
+    } else if(command == "new"){
+        if(sessions.size() >= SERVER_MAX_SESSIONS){
+            reply(fd, "error too many sessions");
+            return;
+        }
+
+        uint32_t id = nextSession++;
+        serverSession_t &session = sessions[id];
+        moveChecker.resetPosition();
+        moveChecker.packPosition(&session.position);
+        session.client = fd;
+        session.unlimited = words.size() > 1 && words[1] == "unlimited";
+        session.remainingMs = words.size() > 1 ? \
+                strtoul(words[1].c_str(), nullptr, 10) : config.budgetMs;
+        session.busy = false;
+        reply(fd, "session " + std::to_string(id));
+        return;
+    }
+
+    uint32_t id;
+    serverSession_t *session = nullptr;
+    if(command == "position" || command == "move" || command == "go" || \
+       command == "analyze" || command == "scout" || command == "close"){
+        session = findSession(fd, words, &id);
+        if(session == nullptr){
+            return;
+        }
+    } else{
+        reply(fd, "error unknown command " + command);
+        return;
+    }
+
+    std::string prefix = " " + words[1];
+    if(command == "close"){
+        sessions.erase(id); // a running search is thrown when it ends
+        reply(fd, "ok" + prefix);
+        return;
+    } else if(session->busy){
+        reply(fd, "error" + prefix + " busy");
+        return;
+    }
+
+    if(command == "position"){
+        packedPosition_t position;
+        // the fen is the rest of the line after the session
+        size_t fen = line.find(words[1], line.find(command) + \
+                               command.size()) + words[1].size();
+        fen = line.find_first_not_of(" \t", fen);
+        if(words.size() == 3 && words[2] == "startpos"){
+            moveChecker.resetPosition();
+            moveChecker.packPosition(&session->position);
+        } else if(fen != std::string::npos && \
+                  ChessEngine::fenToPosition(line.c_str() + fen, &position) \
+                  && moveChecker.unpackPosition(&position)){
+            session->position = position;
+        } else{
+            reply(fd, "error" + prefix + " invalid position");
+            return;
+        }
+        reply(fd, "ok" + prefix);
+    } else if(command == "move"){
+        Move move;
+        uint8_t promotionType;
+        if(words.size() < 3 || \
+           !moveChecker.unpackPosition(&session->position) || \
+           !moveChecker.sanToMove(words[2].c_str(), words[2].size(), \
+                                  &move, &promotionType)){
+            reply(fd, "error" + prefix + " illegal move");
+            return;
+        }
+
+        moveChecker.playMove(move, promotionType, false);
+        moveChecker.packPosition(&session->position);
+        reply(fd, "ok" + prefix);
+    } else{
+        serverJob_t job;
+        job.type = command == "go" ? SERVER_JOB_GO : \
+                command == "analyze" ? SERVER_JOB_ANALYZE : SERVER_JOB_SCOUT;
+        job.depth = words.size() > 2 ? atoi(words[2].c_str()) : config.depth;
+        job.lineCount = 1;
+        job.bound = 0;
+        if(job.type == SERVER_JOB_ANALYZE && words.size() > 3){
+            job.lineCount = atoi(words[3].c_str());
+        } else if(job.type == SERVER_JOB_ANALYZE){
+            job.lineCount = SERVER_DEFAULT_PV_LINES;
+        } else if(job.type == SERVER_JOB_SCOUT && words.size() == 5){
+            job.bound = atoi(words[3].c_str());
+        }
+
+        // the root moves to search, all of them if none is given
+        bool known = moveChecker.unpackPosition(&session->position);
+        bool legal = job.type != SERVER_JOB_SCOUT || words.size() == 5;
+        size_t first = job.type == SERVER_JOB_GO ? words.size() : 4;
+        for(size_t i = first; known && legal && i < words.size(); i++){
+            Move move;
+            uint8_t promotionType;
+            legal = moveChecker.sanToMove(words[i].c_str(), words[i].size(), \
+                                          &move, &promotionType);
+            job.rootMoves.push_back(move.packed());
+        }
+
+        Move moves[MAX_MOVES_EACH_TURN];
+        if(!legal){
+            reply(fd, "error" + prefix + " illegal move");
+        } else if(job.depth < 1 || job.depth > SERVER_MAX_DEPTH){
+            reply(fd, "error" + prefix + " invalid depth");
+        } else if(job.lineCount < 1 || job.lineCount > MULTIPV_MAX_LINES){
+            reply(fd, "error" + prefix + " invalid line count");
+        } else if(!known || moveChecker.getAllMoves(moves) == 0){
+            reply(fd, "error" + prefix + " no legal moves");
+        } else{
+            startSearch(id, session, job);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void GameServer::startSearch(uint32_t id, serverSession_t *session, \
+                             const serverJob_t &job)
+{
+    // an empty budget still gets the first iteration, it is never cut.
+    // no time searches to the depth
+    uint32_t timeMs = session->unlimited ? 0 : \
+            std::max(1u, std::min(config.moveTimeMs, session->remainingMs));
+    packedPosition_t position = session->position;
+
+    session->busy = true;
+    searching++;
+    pool.submit([this, id, position, job, timeMs](unsigned worker){
+        if(job.type == SERVER_JOB_ANALYZE){
+            analyze(worker, id, position, job, timeMs);
+        } else if(job.type == SERVER_JOB_SCOUT){
+            scout(worker, id, position, job, timeMs);
+        } else{
+            search(worker, id, position, job, timeMs);
+        }
+    });
+}
+
+/*---------------------------------------------------------------------------*/
+void GameServer::search(unsigned worker, uint32_t id, \
+                        packedPosition_t position, const serverJob_t &job, \
+                        uint32_t timeMs)
+{
+    std::chrono::steady_clock::time_point start = \
+            std::chrono::steady_clock::now();
+    ChessEngine &engine = *engines[worker];
+
+    serverResult_t result;
+    result.session = id;
+    result.done = true;
+    result.played = true;
+    engine.unpackPosition(&position);
+    int score = engine.search(job.depth, timeMs);
+
+    char san[SAN_MAX_LENGTH];
+    Move move = engine.getBestMove();
+    engine.moveToSan(move, san);
+    engine.playMove(move, PIECE_QUEEN, false);
+    engine.packPosition(&result.position);
+    result.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(\
+                std::chrono::steady_clock::now() - start).count();
+    result.text = "bestmove " + std::to_string(id) + " " + san + " " + \
+            std::to_string(score) + " " + std::to_string(result.elapsedMs);
+
+    pushResult(result);
+}
+
+/*---------------------------------------------------------------------------*/
+void GameServer::analyze(unsigned worker, uint32_t id, \
+                         packedPosition_t position, const serverJob_t &job, \
+                         uint32_t timeMs)
+{
+    std::chrono::steady_clock::time_point start = \
+            std::chrono::steady_clock::now();
+    ChessEngine &engine = *engines[worker];
+
+    serverResult_t result;
+    result.session = id;
+    result.done = false;
+    result.played = false;
+    result.position = position;
+    result.elapsedMs = 0;
+    engine.unpackPosition(&position);
+
+    // each line is sent as soon as its pass is done
+    pvLine_t lines[MULTIPV_MAX_LINES];
+    engine.searchMultiPv(job.depth, job.lineCount, lines, \
+                         [&](const pvLine_t &line){
+        char text[PV_MAX_LENGTH * SAN_MAX_LENGTH];
+        engine.lineToSan(line, text, sizeof(text));
+        result.text = "pv " + std::to_string(id) + " " + \
+                std::to_string(line.depth) + " " + \
+                std::to_string(line.rank) + " " + \
+                std::to_string(line.score) + " " + text;
+        pushResult(result);
+    }, timeMs, job.rootMoves.empty() ? nullptr : job.rootMoves.data(), \
+       job.rootMoves.size());
+
+    result.done = true;
+    result.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(\
+                std::chrono::steady_clock::now() - start).count();
+    result.text = "done " + std::to_string(id) + " " + \
+            std::to_string(result.elapsedMs);
+    pushResult(result);
+}
+
+/*---------------------------------------------------------------------------*/
+void GameServer::scout(unsigned worker, uint32_t id, \
+                       packedPosition_t position, const serverJob_t &job, \
+                       uint32_t timeMs)
+{
+    std::chrono::steady_clock::time_point start = \
+            std::chrono::steady_clock::now();
+    ChessEngine &engine = *engines[worker];
+
+    serverResult_t result;
+    result.session = id;
+    result.done = true;
+    result.played = false;
+    result.position = position;
+    engine.unpackPosition(&position);
+
+    Move move;
+    move.setPacked(job.rootMoves[0]);
+    int completedDepth;
+    int score = engine.scoutRootMove(job.depth, move, job.bound, \
+                                     &completedDepth, timeMs);
+
+    result.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(\
+                std::chrono::steady_clock::now() - start).count();
+    result.text = "scout " + std::to_string(id) + " " + \
+            std::to_string(completedDepth) + " " + std::to_string(score) + \
+            " " + std::to_string(result.elapsedMs);
+    pushResult(result);
+}
+
+/*---------------------------------------------------------------------------*/
+void GameServer::pushResult(const serverResult_t &result)
+{
+    {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        results.push_back(result);
+    }
+
+    ssize_t written = write(wakePipe[1], "r", 1);
+    (void)written; // a full pipe wakes up anyway
+}
+
+/*---------------------------------------------------------------------------*/
+void GameServer::finishSearches()
+{
+    std::vector<serverResult_t> done;
+    {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        done.swap(results);
+    }
+
+    for(size_t i = 0; i < done.size(); i++){
+        const serverResult_t &result = done[i];
+        if(result.done){
+            searching--;
+        }
+
+        // closed while searching
+        auto it = sessions.find(result.session);
+        if(it == sessions.end()){
+            continue;
+        }
+
+        serverSession_t &session = it->second;
+        if(result.done){
+            session.busy = false;
+            session.remainingMs -= std::min(session.remainingMs, \
+                                            result.elapsedMs);
+        }
+        if(result.played){
+            session.position = result.position;
+        }
+        reply(session.client, result.text);
+        writeClient(session.client);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+static GameServer *runningServer = nullptr;
+
+static void stopServer(int signal)
+{
+    (void)signal;
+    if(runningServer != nullptr){
+        runningServer->stop();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+int serverMain(int argc, char *argv[])
+{
+    serverConfig_t config;
+    config.socketPath = nullptr;
+    config.address = nullptr;
+    config.port = SERVER_DEFAULT_PORT;
+    config.threads = 0;
+    config.pinned = false;
+    config.memoryMb = SERVER_DEFAULT_MEMORY;
+    config.learningPath = nullptr;
+    config.recordPath = nullptr;
+    config.recordMaxPly = RECORD_DEFAULT_MAX_PLY;
+    config.depth = SERVER_DEFAULT_DEPTH;
+    config.budgetMs = SERVER_DEFAULT_BUDGET_MS;
+    config.moveTimeMs = SERVER_DEFAULT_MOVE_MS;
+
+    for(int i = 1; i < argc; i++){
+        bool hasValue = i + 1 < argc;
+        if(strcmp(argv[i], "-u") == 0 && hasValue){
+            config.socketPath = argv[++i];
+        } else if(strcmp(argv[i], "-i") == 0 && hasValue){
+            config.address = argv[++i];
+        } else if(strcmp(argv[i], "-p") == 0 && hasValue){
+            config.port = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-t") == 0 && hasValue){
+            config.threads = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-a") == 0){
+            config.pinned = true;
+        } else if(strcmp(argv[i], "-m") == 0 && hasValue){
+            config.memoryMb = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-l") == 0 && hasValue){
+            config.learningPath = argv[++i];
+        } else if(strcmp(argv[i], "-r") == 0 && hasValue){
+            config.recordPath = argv[++i];
+        } else if(strcmp(argv[i], "-x") == 0 && hasValue){
+            config.recordMaxPly = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-d") == 0 && hasValue){
+            config.depth = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-b") == 0 && hasValue){
+            config.budgetMs = strtoul(argv[++i], nullptr, 10);
+        } else if(strcmp(argv[i], "-s") == 0 && hasValue){
+            config.moveTimeMs = strtoul(argv[++i], nullptr, 10);
+        } else{
+            fprintf(stderr, "usage: server [-u socketPath] [-i address] "
+                            "[-p port] [-t threads] [-a] [-m MB] [-l file] "
+                            "[-r file] [-x recordPlies] [-d depth] "
+                            "[-b budgetMs] [-s moveMs]\n");
+            return 1;
+        }
+    }
+
+    GameServer server(config);
+    if(!server.listen()){
+        return 1;
+    }
+
+    // a client gone while its reply is written is only an error code
+    signal(SIGPIPE, SIG_IGN);
+    runningServer = &server;
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+
+    server.run();
+
+    runningServer = nullptr;
+    return 0;
+}
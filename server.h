@@ -0,0 +1,171 @@
+/*
+ * Game Server - many game sessions over a line protocol on one engine pool
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "chessengine.h"
+#include "threadpool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+#define SERVER_DEFAULT_PORT      7390
+#define SERVER_DEFAULT_DEPTH     5
+#define SERVER_DEFAULT_MEMORY    256    // MB, one table for all sessions
+#define SERVER_DEFAULT_BUDGET_MS 600000 // thinking time of a session
+#define SERVER_DEFAULT_MOVE_MS   2000   // at most for one move
+#define SERVER_DEFAULT_PV_LINES  3      // of "analyze"
+#define SERVER_MAX_SESSIONS      100000
+#define SERVER_MAX_LINE          512
+#define SERVER_MAX_OUTPUT        (1 << 20) // unread bytes, then dropped
+
+#define SERVER_JOB_GO      0
+#define SERVER_JOB_ANALYZE 1
+#define SERVER_JOB_SCOUT   2
+
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    const char *socketPath; // unix socket, TCP if null
+    const char *address;    // IPv4 address of TCP, localhost if null
+    uint16_t port;
+    unsigned threads;       // 0 uses all cores
+    bool pinned;            // workers stay on their cores
+    uint32_t memoryMb;
+    const char *learningPath; // shared learning file, none if null
+    const char *recordPath;   // tree recorder file, none if null
+    int recordMaxPly;
+    int depth;              // default of "go"
+    uint32_t budgetMs;      // default of "new"
+    uint32_t moveTimeMs;
+} serverConfig_t;
+
+// 48 bytes, the game is kept as a snapshot, engines are only borrowed
+// by the searches
+typedef struct {
+    packedPosition_t position;
+    int client;           // the connection owning the session
+    uint32_t remainingMs; // thinking time left
+    bool busy;            // a search is queued or running
+    bool unlimited;       // no budget nor move time, the depth ends searches
+} serverSession_t;
+
+// what a search is asked for
+typedef struct {
+    uint8_t type; // SERVER_JOB_*
+    int depth;
+    int lineCount; // of an analysis
+    int bound;     // of a scout
+    std::vector<uint16_t> rootMoves; // Move::packed(), all if empty
+} serverJob_t;
+
+// a reply made by a search, sent by the socket thread
+typedef struct {
+    uint32_t session;
+    bool done;   // the last reply of the search, the session is free
+    bool played; // "go", the position is the one after the move
+    packedPosition_t position;
+    uint32_t elapsedMs;
+    std::string text;
+} serverResult_t;
+
+typedef struct {
+    std::string input;  // up to the next newline
+    std::string output; // not yet accepted by the socket
+    bool closing;
+} serverClient_t;
+
+/*---------------------------------------------------------------------------*/
+// one thread does all socket work and keeps the sessions. searches run on
+// the pool, at most one per session, in the order they were asked for.
+// replies are written as searches make them, clients never wait on each
+// other. analysis streams the best k lines of every iteration as they are
+// found and leaves the position as it is. moves after k restrict the
+// root to them. scout searches one root move with the null window above
+// bound, a score above it means the move is better (see cluster.h), with
+// the depth of its last finished iteration. an unlimited session has no
+// budget and its searches are not cut by the time of a move:
+//
+//   new [budgetMs|unlimited] -> session <id>
+//   position <id> startpos   -> ok <id>
+//   position <id> <fen>      -> ok <id>
+//   move <id> <san>          -> ok <id>
+//   go <id> [depth]          -> bestmove <id> <san> <score> <ms>
+//   analyze <id> [depth] [k] [san]...
+//                            -> pv <id> <depth> <rank> <score> <san>...
+//                               ... done <id> <ms>
+//   scout <id> <depth> <bound> <san>
+//                            -> scout <id> <depth> <score> <ms>
+//   close <id>               -> ok <id>
+//   stats                    -> stats <sessions> <searching> <queued> ...
+//   quit
+//
+// failures are answered as "error [<id>] <reason>"
+class GameServer
+{
+public:
+    explicit GameServer(const serverConfig_t &config);
+    ~GameServer();
+
+    bool listen();
+    void run(); // until stop()
+    void stop(); // async signal safe
+private:
+    void acceptClients();
+    bool readClient(int fd);
+    bool writeClient(int fd);
+    void dropClient(int fd);
+    void reply(int fd, const std::string &text);
+    void handleLine(int fd, const std::string &line);
+    serverSession_t *findSession(int fd, \
+                                 const std::vector<std::string> &words, \
+                                 uint32_t *id);
+    void startSearch(uint32_t id, serverSession_t *session, \
+                     const serverJob_t &job);
+    void search(unsigned worker, uint32_t id, packedPosition_t position, \
+                const serverJob_t &job, uint32_t timeMs);
+    void analyze(unsigned worker, uint32_t id, packedPosition_t position, \
+                 const serverJob_t &job, uint32_t timeMs);
+    void scout(unsigned worker, uint32_t id, packedPosition_t position, \
+               const serverJob_t &job, uint32_t timeMs);
+    void pushResult(const serverResult_t &result);
+    void finishSearches();
+
+    serverConfig_t config;
+    TranspositionTable table; // bounded, shared by all searches
+    LearningFile learning;    // kept between runs, shared by all searches
+    TreeRecorder recorder;    // each engine writes through its own buffer
+    std::vector<std::unique_ptr<ChessEngine> > engines; // one per worker
+    ChessEngine moveChecker; // of the socket thread, never searches
+
+    int listenFd;
+    int wakePipe[2]; // searches and stop() wake the socket thread
+    std::atomic<bool> running;
+
+    std::unordered_map<int, serverClient_t> clients;
+    std::unordered_map<uint32_t, serverSession_t> sessions;
+    uint32_t nextSession;
+    uint32_t searching;
+
+    std::mutex resultMutex;
+    std::vector<serverResult_t> results;
+
+    // last, so its workers are gone before the engines
+    ThreadPool pool;
+};
+
+/*---------------------------------------------------------------------------*/
+// "server [-u socketPath] [-i address] [-p port] [-t threads] [-a] [-m MB]
+// [-l file] [-r file] [-x recordPlies] [-d depth] [-b budgetMs]
+// [-s moveMs]", -a pins the workers, -r records the searched trees
+int serverMain(int argc, char *argv[]);
+
+#endif // SERVER_H
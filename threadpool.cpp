@@ -0,0 +1,143 @@
+/*
+ * Thread Pool - work stealing task queues shared by many producers
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "threadpool.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*---------------------------------------------------------------------------*/
+ThreadPool::ThreadPool(unsigned threadCount, bool pinned)
+{
+    if(threadCount == 0){
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    queued = 0;
+    nextQueue = 0;
+    stopping = false;
+
+    for(unsigned i = 0; i < threadCount; i++){
+        queues.push_back(std::unique_ptr<taskQueue_t>(new taskQueue_t));
+    }
+    this->pinned = pinned;
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned i = 0; i < threadCount; i++){
+        threads.push_back(std::thread(&ThreadPool::worker, this, i));
+        if(pinned){
+            this->pinned = pinThread(threads.back(), i % cores) && \
+                    this->pinned;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+
+    for(size_t i = 0; i < threads.size(); i++){
+        threads[i].join();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void ThreadPool::submit(task_t task)
+{
+    // round robin, stealing evens out what the tasks cost
+    taskQueue_t &queue = *queues[nextQueue++ % queues.size()];
+    {
+        // counted under the queue lock, before the task can be taken
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+        queued++;
+    }
+
+    // a worker between its check and its wait holds the sleep lock, taking
+    // it here makes sure that worker is waiting before it is woken
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeUp.notify_one();
+}
+
+/*---------------------------------------------------------------------------*/
+unsigned ThreadPool::size() const
+{
+    return threads.size();
+}
+
+/*---------------------------------------------------------------------------*/
+bool ThreadPool::isPinned() const
+{
+    return pinned;
+}
+
+/*---------------------------------------------------------------------------*/
+size_t ThreadPool::pending() const
+{
+    return queued;
+}
+
+/*---------------------------------------------------------------------------*/
+void ThreadPool::worker(unsigned index)
+{
+    while(true){
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeUp.wait(lock, [this]{ return stopping || queued > 0; });
+            if(stopping){
+                return;
+            }
+        }
+
+        task_t task;
+        if(take(index, &task)){
+            task(index);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+bool ThreadPool::take(unsigned index, task_t *task)
+{
+    // own queue first, then the others starting from the next one
+    for(size_t i = 0; i < queues.size(); i++){
+        taskQueue_t &queue = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.tasks.empty()){
+            *task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*---------------------------------------------------------------------------*/
+bool pinThread(std::thread &thread, unsigned core)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(set), \
+                                  &set) == 0;
+#else
+    (void)thread;
+    (void)core;
+    return false;
+#endif
+}
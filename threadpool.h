@@ -0,0 +1,63 @@
+/*
+ * Thread Pool - work stealing task queues shared by many producers
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+// tasks are spread over one queue per worker. a worker takes its own
+// tasks first and steals from the others when it runs dry, the oldest
+// task of a queue always goes first so no task waits behind later ones
+class ThreadPool
+{
+public:
+    // the index of the worker running the task, for per worker state
+    typedef std::function<void(unsigned worker)> task_t;
+
+    // 0 uses all cores. pinned workers stay on core index % cores, their
+    // caches and the table pages they touched stay near them
+    explicit ThreadPool(unsigned threadCount = 0, bool pinned = false);
+    ~ThreadPool(); // running tasks are finished, queued ones dropped
+
+    void submit(task_t task);
+    unsigned size() const;
+    bool isPinned() const;
+    size_t pending() const; // queued, not yet running
+private:
+    typedef struct {
+        std::mutex mutex;
+        std::deque<task_t> tasks;
+    } taskQueue_t;
+
+    void worker(unsigned index);
+    bool take(unsigned index, task_t *task);
+
+    std::vector<std::unique_ptr<taskQueue_t> > queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> queued;
+    std::atomic<unsigned> nextQueue;
+    bool pinned;
+
+    // idle workers sleep here
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    bool stopping;
+};
+
+/*---------------------------------------------------------------------------*/
+// false where threads can not be pinned
+bool pinThread(std::thread &thread, unsigned core);
+
+#endif // THREADPOOL_H
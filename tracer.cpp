@@ -0,0 +1,202 @@
+/*
+ * Tracer - scoped timeline events in Chrome trace-event format
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "tracer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/*---------------------------------------------------------------------------*/
+#define TRACE_MARKER_MAX_LEN 128
+
+static const char *traceMarkerPaths[] = {
+    "/sys/kernel/tracing/trace_marker",
+    "/sys/kernel/debug/tracing/trace_marker"
+};
+
+/*---------------------------------------------------------------------------*/
+static TraceBuffer *traceBuffers[TRACE_MAX_THREADS];
+static std::atomic<uint32_t> traceBufferCount(0);
+
+static std::atomic<bool> markersEnabled(false);
+static int markerFd = -1;
+static std::once_flag markerOnce;
+
+static const std::chrono::steady_clock::time_point traceEpoch = \
+        std::chrono::steady_clock::now();
+
+/*---------------------------------------------------------------------------*/
+TraceBuffer::TraceBuffer(uint32_t tid) : head(0), tid(tid)
+{
+}
+
+/*---------------------------------------------------------------------------*/
+void TraceBuffer::push(const char *name, uint64_t startNs, \
+                       uint64_t durationNs, int32_t arg)
+{
+    uint64_t offset = head.load(std::memory_order_relaxed);
+    traceEvent_t &event = events[offset % TRACE_BUFFER_SIZE];
+
+    event.name = name;
+    event.startNs = startNs;
+    event.durationNs = durationNs;
+    event.arg = arg;
+
+    // publish the slot after it is written
+    head.store(offset + 1, std::memory_order_release);
+}
+
+/*---------------------------------------------------------------------------*/
+uint64_t Tracer::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>\
+            (std::chrono::steady_clock::now() - traceEpoch).count();
+}
+
+/*---------------------------------------------------------------------------*/
+TraceBuffer *Tracer::threadBuffer()
+{
+    static thread_local TraceBuffer *buffer = nullptr;
+    if(buffer != nullptr){
+        return buffer;
+    }
+
+    uint32_t slot = traceBufferCount.fetch_add(1, std::memory_order_acq_rel);
+    if(slot >= TRACE_MAX_THREADS){
+        traceBufferCount.store(TRACE_MAX_THREADS);
+        return nullptr; // too many threads, this one is not traced
+    }
+
+    // never freed, events must outlive the thread for dumping
+    buffer = new TraceBuffer(slot + 1);
+    traceBuffers[slot] = buffer;
+
+    return buffer;
+}
+
+/*---------------------------------------------------------------------------*/
+bool Tracer::dump(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if(file == nullptr){
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    bool first = true;
+    uint32_t bufferCount = traceBufferCount.load(std::memory_order_acquire);
+    if(bufferCount > TRACE_MAX_THREADS){
+        bufferCount = TRACE_MAX_THREADS;
+    }
+
+    for(uint32_t i = 0; i < bufferCount; i++){
+        TraceBuffer *buffer = traceBuffers[i];
+        if(buffer == nullptr){
+            continue;
+        }
+
+        uint64_t end = buffer->head.load(std::memory_order_acquire);
+        uint64_t start = 0;
+        if(end > TRACE_BUFFER_SIZE){
+            start = end - TRACE_BUFFER_SIZE;
+        }
+
+        for(uint64_t j = start; j < end; j++){
+            const traceEvent_t &event = buffer->events[j % TRACE_BUFFER_SIZE];
+
+            // chrome expects microseconds
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d," \
+                    "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", first ? "" : ",", \
+                    event.name, (int)getpid(), buffer->tid, \
+                    event.startNs / 1000.0, event.durationNs / 1000.0);
+            if(event.arg != TRACE_NO_ARG){
+                fprintf(file, ",\"args\":{\"value\":%d}", event.arg);
+            }
+            fprintf(file, "}");
+            first = false;
+        }
+    }
+
+    fprintf(file, "]}\n");
+    fclose(file);
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+void Tracer::setMarkersEnabled(bool enabled)
+{
+    if(enabled){
+        std::call_once(markerOnce, [](){
+            for(const char *path : traceMarkerPaths){
+                markerFd = open(path, O_WRONLY | O_CLOEXEC);
+                if(markerFd >= 0){
+                    break;
+                }
+            }
+        });
+
+        if(markerFd < 0){
+            return; // tracefs not mounted or not permitted
+        }
+    }
+
+    markersEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+/*---------------------------------------------------------------------------*/
+void Tracer::marker(const char *name, bool begin)
+{
+    if(!markersEnabled.load(std::memory_order_relaxed)){
+        return;
+    }
+
+    char line[TRACE_MARKER_MAX_LEN];
+    int len;
+    if(begin){
+        len = snprintf(line, sizeof(line), "B|%d|%s\n", (int)getpid(), name);
+    } else{
+        len = snprintf(line, sizeof(line), "E|%d\n", (int)getpid());
+    }
+
+    if(len > 0){
+        ssize_t ret = write(markerFd, line, \
+                            (size_t)len < sizeof(line) ? len : sizeof(line));
+        (void)ret;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+ScopedTrace::ScopedTrace(const char *name, int32_t arg) : name(name), \
+    arg(arg), start(0)
+{
+    if(name == nullptr){
+        return; // disabled scope
+    }
+
+    start = Tracer::now();
+    Tracer::marker(name, true);
+}
+
+/*---------------------------------------------------------------------------*/
+ScopedTrace::~ScopedTrace()
+{
+    if(name == nullptr){
+        return;
+    }
+
+    uint64_t end = Tracer::now();
+    Tracer::marker(name, false);
+
+    TraceBuffer *buffer = Tracer::threadBuffer();
+    if(buffer != nullptr){
+        buffer->push(name, start, end - start, arg);
+    }
+}
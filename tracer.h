@@ -0,0 +1,85 @@
+/*
+ * Tracer - scoped timeline events in Chrome trace-event format
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <cstdint>
+
+/*---------------------------------------------------------------------------*/
+#define TRACE_BUFFER_SIZE 65536 // events kept per thread, oldest overwritten
+#define TRACE_MAX_THREADS 64
+#define TRACE_OUTPUT_FILE "ai-chess-trace.json"
+#define TRACE_NO_ARG      INT32_MIN
+
+// move as decimal digits from.x from.y to.x to.y, E2-E4 -> 4143
+#define TRACE_MOVE_ARG(move) ((move).from.x * 1000 + (move).from.y * 100 + \
+                              (move).to.x * 10 + (move).to.y)
+
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    const char *name; // must point to a string literal
+    uint64_t startNs;
+    uint64_t durationNs;
+    int32_t arg;
+} traceEvent_t;
+
+/*---------------------------------------------------------------------------*/
+// single producer ring, only the owner thread writes into it
+class TraceBuffer
+{
+public:
+    explicit TraceBuffer(uint32_t tid);
+    void push(const char *name, uint64_t startNs, uint64_t durationNs, \
+              int32_t arg);
+
+    traceEvent_t events[TRACE_BUFFER_SIZE];
+    std::atomic<uint64_t> head;
+    uint32_t tid;
+};
+
+/*---------------------------------------------------------------------------*/
+class Tracer
+{
+public:
+    static uint64_t now();
+    static TraceBuffer *threadBuffer();
+    static bool dump(const char *path = TRACE_OUTPUT_FILE);
+
+    // ftrace/atrace style markers which perf and perfetto can record
+    static void setMarkersEnabled(bool enabled);
+    static void marker(const char *name, bool begin);
+};
+
+/*---------------------------------------------------------------------------*/
+// records the lifetime of the scope, a nullptr name disables the scope
+class ScopedTrace
+{
+public:
+    explicit ScopedTrace(const char *name, int32_t arg = TRACE_NO_ARG);
+    ~ScopedTrace();
+private:
+    const char *name;
+    int32_t arg;
+    uint64_t start;
+};
+
+/*---------------------------------------------------------------------------*/
+#ifdef SEARCH_TRACE
+#define TRACE_CONCAT_(a, b)          a##b
+#define TRACE_CONCAT(a, b)           TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name)            ScopedTrace TRACE_CONCAT(scopedTrace, \
+                                         __LINE__)(name)
+#define TRACE_SCOPE_ARG(name, arg)   ScopedTrace TRACE_CONCAT(scopedTrace, \
+                                         __LINE__)(name, arg)
+#define TRACE_DUMP()                 Tracer::dump()
+#else
+#define TRACE_SCOPE(name)            ((void)0)
+#define TRACE_SCOPE_ARG(name, arg)   ((void)0)
+#define TRACE_DUMP()                 ((void)0)
+#endif
+
+#endif // TRACER_H
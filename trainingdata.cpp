@@ -0,0 +1,257 @@
+/*
+ * Training Data - packed labelled positions, buffered writer and reader
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "trainingdata.h"
+
+#include <QDebug>
+
+#include <chrono>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*---------------------------------------------------------------------------*/
+#define TRAINING_FILE_NAME_LENGTH 16
+#define BYTES_IN_MB               (1024.0 * 1024.0)
+
+/*---------------------------------------------------------------------------*/
+TrainingWriter::TrainingWriter(const char *prefix, uint64_t recordsPerFile)
+{
+    this->prefix = prefix;
+    this->file = nullptr;
+    this->fileIndex = 0;
+    this->recordsPerFile = recordsPerFile ? recordsPerFile : \
+                                            TRAINING_RECORDS_PER_FILE;
+    this->recordsInFile = 0;
+    this->totalRecords = 0;
+
+    this->buffer = new trainingRecord_t[TRAINING_BUFFER_RECORDS];
+    this->bufferCount = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+TrainingWriter::~TrainingWriter()
+{
+    flush();
+    if(file != nullptr){
+        fclose(file);
+    }
+    delete [] buffer;
+}
+
+/*---------------------------------------------------------------------------*/
+bool TrainingWriter::write(const trainingRecord_t *records, size_t count)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for(size_t i = 0; i < count; i++){
+        buffer[bufferCount++] = records[i];
+        if(bufferCount == TRAINING_BUFFER_RECORDS && !flushLocked()){
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+bool TrainingWriter::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    bool ok = flushLocked();
+    if(file != nullptr){
+        fflush(file);
+    }
+
+    return ok;
+}
+
+/*---------------------------------------------------------------------------*/
+uint64_t TrainingWriter::recordCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return totalRecords + bufferCount;
+}
+
+/*---------------------------------------------------------------------------*/
+uint32_t TrainingWriter::fileCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return fileIndex;
+}
+
+/*---------------------------------------------------------------------------*/
+bool TrainingWriter::flushLocked()
+{
+    size_t offset = 0;
+
+    // the buffer is split where a file reaches its record limit
+    while(offset < bufferCount){
+        if((file == nullptr || recordsInFile >= recordsPerFile) && \
+           !rotate()){
+            return false;
+        }
+
+        size_t count = bufferCount - offset;
+        if(count > recordsPerFile - recordsInFile){
+            count = recordsPerFile - recordsInFile;
+        }
+
+        if(fwrite(&buffer[offset], sizeof(trainingRecord_t), count, file) \
+                != count){
+            qDebug() << "Training data write failed!";
+            return false;
+        }
+
+        offset += count;
+        recordsInFile += count;
+        totalRecords += count;
+    }
+
+    bufferCount = 0;
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+bool TrainingWriter::rotate()
+{
+    if(file != nullptr){
+        fclose(file);
+    }
+
+    char name[TRAINING_FILE_NAME_LENGTH];
+    snprintf(name, sizeof(name), ".%04u", fileIndex++);
+    std::string path = prefix + name + TRAINING_FILE_SUFFIX;
+
+    file = fopen(path.c_str(), "wb");
+    recordsInFile = 0;
+    if(file == nullptr){
+        qDebug() << "Training data file can not be opened:" << path.c_str();
+        return false;
+    }
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+TrainingReader::TrainingReader()
+{
+    map = nullptr;
+    mapSize = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+TrainingReader::~TrainingReader()
+{
+    close();
+}
+
+/*---------------------------------------------------------------------------*/
+bool TrainingReader::open(const char *path)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0){
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || \
+       info.st_size < (off_t)sizeof(trainingRecord_t)){
+        ::close(fd);
+        return false;
+    }
+
+    mapSize = info.st_size;
+    map = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file
+
+    if(map == MAP_FAILED){
+        map = nullptr;
+        mapSize = 0;
+        return false;
+    }
+
+    // read front to back, let the kernel read ahead
+    madvise(map, mapSize, MADV_SEQUENTIAL);
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+void TrainingReader::close()
+{
+    if(map != nullptr){
+        munmap(map, mapSize);
+    }
+
+    map = nullptr;
+    mapSize = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+const trainingRecord_t *TrainingReader::records() const
+{
+    return (const trainingRecord_t *)map;
+}
+
+/*---------------------------------------------------------------------------*/
+size_t TrainingReader::count() const
+{
+    return mapSize / sizeof(trainingRecord_t); // partial tail is ignored
+}
+
+/*---------------------------------------------------------------------------*/
+int trainingInfoMain(int argc, char *argv[])
+{
+    if(argc < 2){
+        fprintf(stderr, "usage: datainfo file...\n");
+        return 1;
+    }
+
+    uint64_t results[3] = { 0, 0, 0 };
+    uint64_t total = 0;
+    int64_t scoreSum = 0;
+    std::chrono::steady_clock::time_point start = \
+            std::chrono::steady_clock::now();
+
+    for(int i = 1; i < argc; i++){
+        TrainingReader reader;
+        if(!reader.open(argv[i])){
+            fprintf(stderr, "%s can not be read\n", argv[i]);
+            continue;
+        }
+
+        const trainingRecord_t *records = reader.records();
+        size_t count = reader.count();
+        for(size_t j = 0; j < count; j++){
+            int8_t result = records[j].result;
+            if(result >= TRAINING_RESULT_BLACK && \
+               result <= TRAINING_RESULT_WHITE){
+                results[result - TRAINING_RESULT_BLACK]++;
+            }
+            scoreSum += records[j].score;
+        }
+        total += count;
+    }
+
+    double seconds = std::chrono::duration<double>(\
+                std::chrono::steady_clock::now() - start).count();
+    double megabytes = total * sizeof(trainingRecord_t) / BYTES_IN_MB;
+
+    printf("records %llu white %llu draw %llu black %llu mean score %.1f\n", \
+           (unsigned long long)total, \
+           (unsigned long long)results[TRAINING_RESULT_WHITE + 1], \
+           (unsigned long long)results[TRAINING_RESULT_DRAW + 1], \
+           (unsigned long long)results[TRAINING_RESULT_BLACK + 1], \
+           total ? (double)scoreSum / total : 0.0);
+    printf("read %.1f MB in %.3f s, %.0f MB/s\n", megabytes, seconds, \
+           seconds > 0.0 ? megabytes / seconds : 0.0);
+
+    return 0;
+}
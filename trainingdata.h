@@ -0,0 +1,89 @@
+/*
+ * Training Data - packed labelled positions, buffered writer and reader
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef TRAININGDATA_H
+#define TRAININGDATA_H
+
+#include "chessengine.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+/*---------------------------------------------------------------------------*/
+#define TRAINING_BUFFER_RECORDS   32768    // 1 MB written at once
+#define TRAINING_RECORDS_PER_FILE 33554432 // 1 GB files by default
+#define TRAINING_FILE_SUFFIX      ".bin"
+
+#define TRAINING_RESULT_BLACK -1
+#define TRAINING_RESULT_DRAW  0
+#define TRAINING_RESULT_WHITE 1
+
+/*---------------------------------------------------------------------------*/
+// 32 bytes, files are plain arrays of these in host byte order
+typedef struct {
+    packedBoard_t board;
+    int16_t score;   // search score, white relative
+    uint16_t ply;
+    int8_t result;   // TRAINING_RESULT_*
+    uint8_t side;    // side to move
+    uint8_t reserved[2];
+} trainingRecord_t;
+
+static_assert(sizeof(trainingRecord_t) == 32, "training record is 32 bytes");
+
+/*---------------------------------------------------------------------------*/
+// shared by the generator threads, each game is appended as a whole
+class TrainingWriter
+{
+public:
+    TrainingWriter(const char *prefix, \
+                   uint64_t recordsPerFile = TRAINING_RECORDS_PER_FILE);
+    ~TrainingWriter();
+
+    bool write(const trainingRecord_t *records, size_t count);
+    bool flush();
+    uint64_t recordCount();
+    uint32_t fileCount();
+private:
+    bool flushLocked();
+    bool rotate();
+
+    std::mutex mutex;
+    std::string prefix;
+    FILE *file;
+    uint32_t fileIndex;
+    uint64_t recordsPerFile;
+    uint64_t recordsInFile;
+    uint64_t totalRecords;
+
+    trainingRecord_t *buffer;
+    size_t bufferCount;
+};
+
+/*---------------------------------------------------------------------------*/
+// whole file mapped read only, records are used in place
+class TrainingReader
+{
+public:
+    TrainingReader();
+    ~TrainingReader();
+
+    bool open(const char *path);
+    void close();
+    const trainingRecord_t *records() const;
+    size_t count() const;
+private:
+    void *map;
+    size_t mapSize;
+};
+
+/*---------------------------------------------------------------------------*/
+// "datainfo file...", result counts and read speed of the files
+int trainingInfoMain(int argc, char *argv[]);
+
+#endif // TRAININGDATA_H
@@ -0,0 +1,225 @@
+/*
+ * Transposition Table - hash of searched positions
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "transposition.h"
+#include "paramlist.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+
+/*---------------------------------------------------------------------------*/
+#define TT_SCORE_SHIFT 32
+#define TT_MOVE_SHIFT  16
+#define TT_DEPTH_SHIFT 8
+
+/*---------------------------------------------------------------------------*/
+uint64_t ttPackEntry(int score, uint16_t move, int8_t depth, uint8_t flag)
+{
+    return ((uint64_t)(uint32_t)score << TT_SCORE_SHIFT) | \
+            ((uint64_t)move << TT_MOVE_SHIFT) | \
+            ((uint64_t)(uint8_t)depth << TT_DEPTH_SHIFT) | flag;
+}
+
+/*---------------------------------------------------------------------------*/
+void ttUnpackEntry(uint64_t data, ttEntry_t *entry)
+{
+    entry->score = (int32_t)(uint32_t)(data >> TT_SCORE_SHIFT);
+    entry->move = (uint16_t)(data >> TT_MOVE_SHIFT);
+    entry->depth = (int8_t)(uint8_t)(data >> TT_DEPTH_SHIFT);
+    entry->flag = (uint8_t)data;
+}
+
+/*---------------------------------------------------------------------------*/
+// unknown names and values are ignored, the option stays on
+static void parseOptions(const char *spec, ttOptions_t *options)
+{
+    options->hugePages = true;
+    options->parallelClear = true;
+    options->prefetch = true;
+
+    parseParamList(spec, [options](const char *name, int value){
+        if(strcmp(name, "hugePages") == 0){
+            options->hugePages = value != 0;
+        } else if(strcmp(name, "parallelClear") == 0){
+            options->parallelClear = value != 0;
+        } else if(strcmp(name, "prefetch") == 0){
+            options->prefetch = value != 0;
+        } else{
+            return false;
+        }
+        return true;
+    });
+}
+
+/*---------------------------------------------------------------------------*/
+TranspositionTable::TranspositionTable(size_t sizeMb)
+{
+    size_t bytes = sizeMb * 1024 * 1024;
+    parseOptions(getenv(TT_OPTIONS_ENV), &options);
+
+    // round down to a power of two so the index is a mask
+    entryCount = 1;
+    while(entryCount * 2 * sizeof(ttSlot_t) <= bytes){
+        entryCount *= 2;
+    }
+
+    allocate(entryCount * sizeof(ttSlot_t));
+    clear();
+}
+
+/*---------------------------------------------------------------------------*/
+TranspositionTable::~TranspositionTable()
+{
+    if(map != nullptr){
+        munmap(map, mapSize);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void TranspositionTable::allocate(size_t bytes)
+{
+    // a probe is a TLB miss on 4 KB pages once the table is large, one
+    // 2 MB page covers 512 times as much
+    bool huge = options.hugePages && bytes >= TT_HUGE_PAGE_SIZE;
+    hugePageBacked = false;
+    map = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    // the reserved pool, usually empty unless vm.nr_hugepages is set
+    if(huge){
+        mapSize = (bytes + TT_HUGE_PAGE_SIZE - 1) & ~(TT_HUGE_PAGE_SIZE - 1);
+        map = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, \
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        hugePageBacked = map != MAP_FAILED;
+    }
+#endif
+
+    if(map == MAP_FAILED){
+        // transparent huge pages need an aligned range, the ends are cut
+        size_t align = huge ? TT_HUGE_PAGE_SIZE : 0;
+        mapSize = bytes + align;
+        map = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, \
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(map == MAP_FAILED){
+            qDebug() << "Transposition table allocation failed!";
+            exit(-1);
+        }
+
+        if(align > 0){
+            uintptr_t start = (uintptr_t)map;
+            uintptr_t aligned = (start + align - 1) & ~(uintptr_t)(align - 1);
+            if(aligned > start){
+                munmap(map, aligned - start);
+            }
+            if(aligned + bytes < start + mapSize){
+                munmap((void *)(aligned + bytes), \
+                       start + mapSize - aligned - bytes);
+            }
+            map = (void *)aligned;
+            mapSize = bytes;
+        }
+
+#ifdef MADV_HUGEPAGE
+        if(huge){
+            madvise(map, mapSize, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    entries = (ttSlot_t *)map;
+}
+
+/*---------------------------------------------------------------------------*/
+bool TranspositionTable::probe(uint64_t key, ttEntry_t *entry)
+{
+    ttSlot_t *slot = &entries[key & (entryCount - 1)];
+    uint64_t data = slot->data.load(std::memory_order_relaxed);
+    uint64_t check = slot->check.load(std::memory_order_relaxed);
+    if((check ^ data) != key){
+        return false;
+    }
+
+    ttUnpackEntry(data, entry);
+    entry->key = key;
+    return entry->flag != TT_FLAG_NONE;
+}
+
+/*---------------------------------------------------------------------------*/
+void TranspositionTable::store(uint64_t key, int depth, int score, \
+                               uint8_t flag, uint16_t move)
+{
+    ttSlot_t *slot = &entries[key & (entryCount - 1)];
+    ttEntry_t old;
+    bool same = probe(key, &old);
+
+    // keep the deeper result of the same position
+    if(same && old.depth > depth && flag != TT_FLAG_EXACT){
+        return;
+    }
+
+    // a bound without a move should not erase the known best move
+    if(same && move == TT_NO_MOVE){
+        move = old.move;
+    }
+
+    uint64_t data = ttPackEntry(score, move, depth, flag);
+    slot->data.store(data, std::memory_order_relaxed);
+    slot->check.store(key ^ data, std::memory_order_relaxed);
+}
+
+/*---------------------------------------------------------------------------*/
+void TranspositionTable::clear()
+{
+    size_t threadCount = 1;
+    if(options.parallelClear && \
+       entryCount * sizeof(ttSlot_t) >= TT_PARALLEL_CLEAR_MB * 1024 * 1024){
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // the first write places a page on the node of the writing thread,
+    // cleared by all cores the table is spread over all nodes
+    std::vector<std::thread> workers;
+    size_t step = entryCount / threadCount;
+    for(size_t i = 1; i < threadCount; i++){
+        workers.push_back(std::thread(clearRange, entries, i * step, \
+                                      i + 1 < threadCount ? (i + 1) * step \
+                                                          : entryCount));
+    }
+    clearRange(entries, 0, threadCount > 1 ? step : entryCount);
+
+    for(size_t i = 0; i < workers.size(); i++){
+        workers[i].join();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+const ttOptions_t &TranspositionTable::getOptions() const
+{
+    return options;
+}
+
+/*---------------------------------------------------------------------------*/
+bool TranspositionTable::isHugePageBacked() const
+{
+    return hugePageBacked;
+}
+
+/*---------------------------------------------------------------------------*/
+void TranspositionTable::clearRange(ttSlot_t *entries, size_t begin, \
+                                    size_t end)
+{
+    // an empty word has no flag, it never reads as a hit
+    for(size_t i = begin; i < end; i++){
+        entries[i].data.store(0, std::memory_order_relaxed);
+        entries[i].check.store(0, std::memory_order_relaxed);
+    }
+}
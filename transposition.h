@@ -0,0 +1,97 @@
+/*
+ * Transposition Table - hash of searched positions
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*---------------------------------------------------------------------------*/
+#define TT_DEFAULT_SIZE_MB 16
+#define TT_NO_MOVE         0
+
+#define TT_OPTIONS_ENV       "AI_CHESS_TT_OPTIONS"
+#define TT_HUGE_PAGE_SIZE    (2 * 1024 * 1024)
+#define TT_PARALLEL_CLEAR_MB 64 // smaller tables are cleared by the caller
+
+#define TT_FLAG_NONE  0
+#define TT_FLAG_EXACT 1
+#define TT_FLAG_LOWER 2 // failed high, score is a lower bound
+#define TT_FLAG_UPPER 3 // failed low, score is an upper bound
+
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    uint64_t key;
+    int32_t score;
+    uint16_t move; // Move::packed()
+    int8_t depth;
+    uint8_t flag;
+} ttEntry_t;
+
+// what is kept in the table, the entry fields packed into one word and
+// the key xor that word. a slot torn by two threads writing at once
+// fails the key check and reads as a miss, so no lock is needed
+typedef struct {
+    std::atomic<uint64_t> check;
+    std::atomic<uint64_t> data;
+} ttSlot_t;
+
+// "hugePages=0,parallelClear=0,prefetch=0" in TT_OPTIONS_ENV, all of
+// them are on by default
+typedef struct {
+    bool hugePages;     // 2 MB pages, reserved ones first, then THP
+    bool parallelClear; // first touch on all cores, pages spread on nodes
+    bool prefetch;      // child slots are loaded while the move is made
+} ttOptions_t;
+
+/*---------------------------------------------------------------------------*/
+// the data word of a slot, also used by the learning file
+uint64_t ttPackEntry(int score, uint16_t move, int8_t depth, uint8_t flag);
+void ttUnpackEntry(uint64_t data, ttEntry_t *entry);
+
+/*---------------------------------------------------------------------------*/
+class TranspositionTable
+{
+public:
+    explicit TranspositionTable(size_t sizeMb = TT_DEFAULT_SIZE_MB);
+    ~TranspositionTable();
+
+    bool probe(uint64_t key, ttEntry_t *entry);
+    void store(uint64_t key, int depth, int score, uint8_t flag, \
+               uint16_t move);
+    void clear();
+    // the slot of the key is loaded to the cache, probe it a bit later
+    void prefetch(uint64_t key);
+    const ttOptions_t &getOptions() const;
+    bool isHugePageBacked() const; // from the reserved pool
+private:
+    void allocate(size_t bytes);
+    static void clearRange(ttSlot_t *entries, size_t begin, size_t end);
+
+    ttSlot_t *entries;
+    size_t entryCount; // power of two
+    void *map;
+    size_t mapSize;
+    bool hugePageBacked;
+    ttOptions_t options;
+};
+
+/*---------------------------------------------------------------------------*/
+inline void TranspositionTable::prefetch(uint64_t key)
+{
+#if defined(__GNUC__)
+    // gcc -O2 drops a prefetch which is the only work of a plain branch,
+    // the hint keeps it
+    if(__builtin_expect(options.prefetch, 1)){
+        __builtin_prefetch(&entries[key & (entryCount - 1)]);
+    }
+#else
+    (void)key;
+#endif
+}
+
+#endif // TRANSPOSITION_H
@@ -0,0 +1,334 @@
+/*
+ * Tuner - fits the evaluation weights to game results (Texel method)
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "tuner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+/*---------------------------------------------------------------------------*/
+#define TUNER_TT_SIZE_MB 1 // engines only unpack and evaluate
+
+#define ADAM_BETA1   0.9
+#define ADAM_BETA2   0.999
+#define ADAM_EPSILON 1e-8
+
+// per thread sums, the last slot carries the loss
+#define TUNER_SUM_NUM (EVAL_PARAM_NUM + 1)
+
+/*---------------------------------------------------------------------------*/
+static double sigmoid(double x)
+{
+    return 1.0 / (1.0 + std::exp(-x));
+}
+
+/*---------------------------------------------------------------------------*/
+static double entryEval(const tunerEntry_t &entry, const double *weights)
+{
+    double eval = 0.0;
+    for(uint8_t i = 0; i < EVAL_PARAM_NUM; i++){
+        eval += weights[i] * entry.features[i];
+    }
+
+    return eval;
+}
+
+/*---------------------------------------------------------------------------*/
+Tuner::Tuner(unsigned threadCount)
+{
+    if(threadCount == 0){
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    this->threadCount = threadCount;
+}
+
+/*---------------------------------------------------------------------------*/
+bool Tuner::load(const char *path)
+{
+    TrainingReader reader;
+    if(!reader.open(path)){
+        return false;
+    }
+
+    size_t count = reader.count();
+    size_t begin = entries.size();
+    size_t perThread = (count + threadCount - 1) / threadCount;
+    entries.resize(begin + count);
+
+    std::vector<std::thread> workers;
+    std::vector<size_t> valid(threadCount, 0);
+    for(unsigned i = 0; i < threadCount; i++){
+        size_t first = i * perThread;
+        if(first >= count){
+            break;
+        }
+
+        workers.push_back(std::thread(loadRange, reader.records() + first, \
+                                      std::min(perThread, count - first), \
+                                      &entries[begin + first], &valid[i]));
+    }
+
+    for(size_t i = 0; i < workers.size(); i++){
+        workers[i].join();
+    }
+
+    // valid entries are at the front of each range, close the gaps
+    size_t end = begin;
+    for(size_t i = 0; i < workers.size(); i++){
+        size_t first = begin + i * perThread;
+        if(first != end){
+            memmove(&entries[end], &entries[first], \
+                    valid[i] * sizeof(tunerEntry_t));
+        }
+        end += valid[i];
+    }
+    entries.resize(end);
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+size_t Tuner::positionCount() const
+{
+    return entries.size();
+}
+
+/*---------------------------------------------------------------------------*/
+void Tuner::loadRange(const trainingRecord_t *records, size_t count, \
+                      tunerEntry_t *entries, size_t *valid)
+{
+    ChessEngine engine(TUNER_TT_SIZE_MB);
+    int16_t features[EVAL_PARAM_NUM];
+
+    for(size_t i = 0; i < count; i++){
+        packedPosition_t position;
+        memset(&position, 0, sizeof(position));
+        position.board = records[i].board;
+        position.side = records[i].side;
+
+        if(records[i].result < TRAINING_RESULT_BLACK || \
+           records[i].result > TRAINING_RESULT_WHITE || \
+           !engine.unpackPosition(&position)){
+            continue;
+        }
+
+        tunerEntry_t *entry = &entries[(*valid)++];
+        engine.evalFeatures(features);
+        for(uint8_t j = 0; j < EVAL_PARAM_NUM; j++){
+            entry->features[j] = std::max<int16_t>(INT8_MIN, \
+                    std::min<int16_t>(INT8_MAX, features[j]));
+        }
+        entry->result = (records[i].result - TRAINING_RESULT_BLACK) / 2.0f;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+double Tuner::loss(const double *weights, double scale) const
+{
+    double sums[TUNER_SUM_NUM];
+    gradient(weights, scale, sums);
+
+    return entries.empty() ? 0.0 : sums[EVAL_PARAM_NUM] / entries.size();
+}
+
+/*---------------------------------------------------------------------------*/
+double Tuner::fitScale(const double *weights) const
+{
+    // the loss has one minimum along the scale, golden section search
+    const double ratio = (std::sqrt(5.0) - 1.0) / 2.0;
+    double low = TUNER_SCALE_MIN;
+    double high = TUNER_SCALE_MAX;
+    double left = high - ratio * (high - low);
+    double right = low + ratio * (high - low);
+    double leftLoss = loss(weights, left);
+    double rightLoss = loss(weights, right);
+
+    for(int i = 0; i < TUNER_SCALE_STEPS; i++){
+        if(leftLoss < rightLoss){
+            high = right;
+            right = left;
+            rightLoss = leftLoss;
+            left = high - ratio * (high - low);
+            leftLoss = loss(weights, left);
+        } else{
+            low = left;
+            left = right;
+            leftLoss = rightLoss;
+            right = low + ratio * (high - low);
+            rightLoss = loss(weights, right);
+        }
+    }
+
+    return (low + high) / 2.0;
+}
+
+/*---------------------------------------------------------------------------*/
+void Tuner::optimise(double *weights, double scale, int epochs, double rate)
+{
+    double moments[EVAL_PARAM_NUM] = { 0.0 };
+    double velocities[EVAL_PARAM_NUM] = { 0.0 };
+    double sums[TUNER_SUM_NUM];
+
+    if(entries.empty()){
+        return;
+    }
+
+    for(int epoch = 1; epoch <= epochs; epoch++){
+        gradient(weights, scale, sums);
+
+        double correction1 = 1.0 - std::pow(ADAM_BETA1, epoch);
+        double correction2 = 1.0 - std::pow(ADAM_BETA2, epoch);
+        for(uint8_t i = 0; i < EVAL_PARAM_NUM; i++){
+            double grad = 2.0 * scale * sums[i] / entries.size();
+            moments[i] = ADAM_BETA1 * moments[i] + (1.0 - ADAM_BETA1) * grad;
+            velocities[i] = ADAM_BETA2 * velocities[i] + \
+                    (1.0 - ADAM_BETA2) * grad * grad;
+            weights[i] -= rate * (moments[i] / correction1) / \
+                    (std::sqrt(velocities[i] / correction2) + ADAM_EPSILON);
+        }
+
+        if(epoch % TUNER_REPORT_EVERY == 0 || epoch == 1){
+            fprintf(stderr, "epoch %d loss %.6f\n", epoch, \
+                    sums[EVAL_PARAM_NUM] / entries.size());
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void Tuner::gradient(const double *weights, double scale, double *sums) const
+{
+    size_t count = entries.size();
+    size_t perThread = (count + threadCount - 1) / threadCount;
+    std::vector<double> partial(threadCount * TUNER_SUM_NUM, 0.0);
+
+    // each worker sums its own range, the ranges are added up after
+    std::vector<std::thread> workers;
+    for(unsigned t = 0; t < threadCount; t++){
+        size_t first = t * perThread;
+        if(first >= count){
+            break;
+        }
+
+        workers.push_back(std::thread(gradientRange, &entries[first], \
+                                      std::min(perThread, count - first), \
+                                      weights, scale, \
+                                      &partial[t * TUNER_SUM_NUM]));
+    }
+
+    for(size_t i = 0; i < workers.size(); i++){
+        workers[i].join();
+    }
+
+    for(uint8_t j = 0; j < TUNER_SUM_NUM; j++){
+        sums[j] = 0.0;
+        for(unsigned t = 0; t < threadCount; t++){
+            sums[j] += partial[t * TUNER_SUM_NUM + j];
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+void Tuner::gradientRange(const tunerEntry_t *entries, size_t count, \
+                          const double *weights, double scale, double *sums)
+{
+    for(size_t i = 0; i < count; i++){
+        double s = sigmoid(scale * entryEval(entries[i], weights));
+        double error = s - entries[i].result;
+        double slope = error * s * (1.0 - s);
+
+        for(uint8_t j = 0; j < EVAL_PARAM_NUM; j++){
+            sums[j] += slope * entries[i].features[j];
+        }
+        sums[EVAL_PARAM_NUM] += error * error;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+int tunerMain(int argc, char *argv[])
+{
+    unsigned threads = 0;
+    int epochs = TUNER_DEFAULT_EPOCHS;
+    double rate = TUNER_DEFAULT_RATE;
+    const char *output = nullptr;
+    std::vector<const char *> paths;
+
+    for(int i = 1; i < argc; i++){
+        bool hasValue = i + 1 < argc;
+        if(strcmp(argv[i], "-t") == 0 && hasValue){
+            threads = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-e") == 0 && hasValue){
+            epochs = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-r") == 0 && hasValue){
+            rate = atof(argv[++i]);
+        } else if(strcmp(argv[i], "-o") == 0 && hasValue){
+            output = argv[++i];
+        } else{
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if(paths.empty()){
+        fprintf(stderr, "usage: tune [-t threads] [-e epochs] [-r rate] "
+                        "[-o output] file...\n");
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point start = \
+            std::chrono::steady_clock::now();
+
+    Tuner tuner(threads);
+    for(size_t i = 0; i < paths.size(); i++){
+        if(!tuner.load(paths[i])){
+            fprintf(stderr, "%s can not be read\n", paths[i]);
+        }
+    }
+    if(tuner.positionCount() == 0){
+        fprintf(stderr, "no positions to tune on\n");
+        return 1;
+    }
+
+    // starts from the weights the engine would use
+    EvalParams params;
+    params.load(getenv(EVAL_PARAMS_FILE_ENV));
+    params.parse(getenv(EVAL_PARAMS_ENV));
+
+    double weights[EVAL_PARAM_NUM];
+    for(uint8_t i = 0; i < EVAL_PARAM_NUM; i++){
+        weights[i] = params.weights[i];
+    }
+
+    double scale = tuner.fitScale(weights);
+    fprintf(stderr, "%zu positions, scale %.6f, loss %.6f\n", \
+            tuner.positionCount(), scale, tuner.loss(weights, scale));
+
+    tuner.optimise(weights, scale, epochs, rate);
+
+    for(uint8_t i = 0; i < EVAL_PARAM_NUM; i++){
+        params.weights[i] = (int)std::lround(weights[i]);
+        printf("%s = %d\n", EvalParams::name(i), params.weights[i]);
+    }
+
+    double seconds = std::chrono::duration<double>(\
+                std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "loss %.6f, %.1f s\n", tuner.loss(weights, scale), \
+            seconds);
+
+    if(output != nullptr){
+        size_t length = strlen(output);
+        bool header = length > 2 && strcmp(output + length - 2, ".h") == 0;
+        if(!(header ? params.saveHeader(output) : params.save(output))){
+            fprintf(stderr, "%s can not be written\n", output);
+            return 1;
+        }
+    }
+
+    return 0;
+}
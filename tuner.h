@@ -0,0 +1,66 @@
+/*
+ * Tuner - fits the evaluation weights to game results (Texel method)
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef TUNER_H
+#define TUNER_H
+
+#include "evalparams.h"
+#include "trainingdata.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+#define TUNER_DEFAULT_EPOCHS 500
+#define TUNER_DEFAULT_RATE   1.0  // rating units per step, Adam scaled
+#define TUNER_SCALE_MIN      0.0001
+#define TUNER_SCALE_MAX      0.05
+#define TUNER_SCALE_STEPS    40   // golden section steps fitting the scale
+#define TUNER_REPORT_EVERY   50   // epochs between loss reports
+
+/*---------------------------------------------------------------------------*/
+// features of a position are computed once, the evaluation is linear in
+// the weights so every epoch is only dot products
+typedef struct {
+    int8_t features[EVAL_PARAM_NUM];
+    float result; // 0 black won, 0.5 draw, 1 white won
+} tunerEntry_t;
+
+/*---------------------------------------------------------------------------*/
+class Tuner
+{
+public:
+    explicit Tuner(unsigned threadCount = 0); // 0 uses all cores
+
+    // records of the file are appended, positions failing to unpack
+    // are skipped
+    bool load(const char *path);
+    size_t positionCount() const;
+
+    // mean squared error of sigmoid(scale * eval) against the results
+    double loss(const double *weights, double scale) const;
+    // scale of the sigmoid which fits the given weights best
+    double fitScale(const double *weights) const;
+    // Adam descent on the full set, weights are updated in place
+    void optimise(double *weights, double scale, int epochs, double rate);
+private:
+    void gradient(const double *weights, double scale, double *sums) const;
+    static void gradientRange(const tunerEntry_t *entries, size_t count, \
+                              const double *weights, double scale, \
+                              double *sums);
+    static void loadRange(const trainingRecord_t *records, size_t count, \
+                          tunerEntry_t *entries, size_t *valid);
+
+    unsigned threadCount;
+    std::vector<tunerEntry_t> entries;
+};
+
+/*---------------------------------------------------------------------------*/
+// "tune [-t threads] [-e epochs] [-r rate] [-o output] file...", output
+// ending in .h is written as evaldefaults.h, any other as a weight file
+int tunerMain(int argc, char *argv[]);
+
+#endif // TUNER_H
@@ -0,0 +1,41 @@
+/*
+ * Zobrist Hashing - random keys for incremental position hashing
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#include "zobrist.h"
+
+/*---------------------------------------------------------------------------*/
+uint64_t Zobrist::pieces[ZOBRIST_SIDE_NUM][ZOBRIST_TYPE_NUM]\
+                        [ZOBRIST_BOARD][ZOBRIST_BOARD];
+uint64_t Zobrist::side;
+bool Zobrist::initialized = Zobrist::init();
+
+/*---------------------------------------------------------------------------*/
+// splitmix64, small and good enough for hash keys
+static uint64_t nextRandom(uint64_t *state)
+{
+    uint64_t z = ((*state) += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/*---------------------------------------------------------------------------*/
+bool Zobrist::init()
+{
+    uint64_t state = ZOBRIST_SEED;
+
+    for(uint8_t s = 0; s < ZOBRIST_SIDE_NUM; s++){
+        for(uint8_t t = 0; t < ZOBRIST_TYPE_NUM; t++){
+            for(uint8_t x = 0; x < ZOBRIST_BOARD; x++){
+                for(uint8_t y = 0; y < ZOBRIST_BOARD; y++){
+                    pieces[s][t][x][y] = nextRandom(&state);
+                }
+            }
+        }
+    }
+    side = nextRandom(&state);
+
+    return true;
+}
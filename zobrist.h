@@ -0,0 +1,44 @@
+/*
+ * Zobrist Hashing - random keys for incremental position hashing
+ *
+ * Copyright (C) Kadir Yanık - <kdrynkk@gmail.com>, 2020
+ */
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+
+/*---------------------------------------------------------------------------*/
+#define ZOBRIST_SIDE_NUM  2
+#define ZOBRIST_TYPE_NUM  6 // PIECE_BISHOP .. PIECE_ROOK
+#define ZOBRIST_BOARD     8
+#define ZOBRIST_SEED      0x9E3779B97F4A7C15ULL // fixed, keys must be stable
+
+/*---------------------------------------------------------------------------*/
+class Zobrist
+{
+public:
+    static uint64_t pieceKey(bool side, uint8_t type, uint8_t x, uint8_t y);
+    static uint64_t sideKey();
+private:
+    static uint64_t pieces[ZOBRIST_SIDE_NUM][ZOBRIST_TYPE_NUM]\
+                          [ZOBRIST_BOARD][ZOBRIST_BOARD];
+    static uint64_t side;
+    static bool initialized;
+    static bool init();
+};
+
+/*---------------------------------------------------------------------------*/
+inline uint64_t Zobrist::pieceKey(bool side, uint8_t type, uint8_t x, \
+                                  uint8_t y)
+{
+    return pieces[side ? 1 : 0][type][x][y];
+}
+
+/*---------------------------------------------------------------------------*/
+inline uint64_t Zobrist::sideKey()
+{
+    return side;
+}
+
+#endif // ZOBRIST_H